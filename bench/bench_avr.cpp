@@ -0,0 +1,86 @@
+/**
+ * Program      bench_avr.cpp
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Cycle counts of the hot paths on the ATmega328P, meant to run
+ *              in simavr (pio run -e uno_bench -t simbench). Timer1 runs at
+ *              clk/1 and its overflows are counted, so every call is measured
+ *              in CPU cycles. One JSON object per function is printed, the 
+ *              extra script tools/simavr_bench.py collects them.
+ * 
+ * Remarks      simavr has no HX711: DOUT floats LOW, so getRawValue() never
+ *              waits and the figures are the pure CPU cost of clocking out
+ *              a sample. The firmware is included here with setup()/loop()
+ *              renamed, so doMenu() and myScale are the real ones.
+ */
+#define setup firmwareSetup
+#define loop  firmwareLoop
+#include "../src/loadCell.cpp"
+#undef setup
+#undef loop
+#include <avr/sleep.h>
+
+static volatile uint16_t t1Overflows = 0;
+
+ISR(TIMER1_OVF_vect)
+{
+  t1Overflows++;
+}
+
+static uint32_t cycles()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t t = TCNT1;
+  uint16_t o = t1Overflows;
+  if ((TIFR1 & _BV(TOV1)) && t < 0x8000) o++;   // overflow not yet serviced
+  SREG = sreg;
+  return (uint32_t)o << 16 | t;
+}
+
+template <typename F> void measure(const char *name, uint16_t calls, F f)
+{
+  uint32_t total = 0;
+  for (uint16_t i = 0; i < calls; i++)
+  {
+    Serial.flush();
+    uint32_t c0 = cycles();
+    f();
+    total += cycles() - c0;
+  }
+  Serial.flush();
+  Serial.print(F("{\"name\": \""));
+  Serial.print(name);
+  Serial.print(F("\", \"calls\": "));
+  Serial.print(calls);
+  Serial.print(F(", \"cycles_per_call\": "));
+  Serial.print(total / calls);
+  Serial.println(F("}"));
+}
+
+void setup()
+{
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);     // clk/1
+  TIMSK1 = _BV(TOIE1);
+  firmwareSetup();
+  Serial.println();
+
+  measure("getRawValue_ready",   100, [] { myScale.getRawValue(); });
+  measure("getAverageValue_16",    2, [] { myScale.getAverageValue(16); });
+  measure("getWeight_8",           2, [] { myScale.getWeight(8); });
+  measure("printEquation",        20, [] { myScale.printEquation(); });
+  measure("doMenu_unknown_key",   20, [] { doMenu(); });
+  Serial.println(F("{\"end\": true}"));
+  Serial.flush();
+
+  // sleeping with interrupts off makes simavr terminate
+  cli();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,192 @@
+/**
+ * Program      bench_host.cpp
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Benchmarks the acquisition, conversion and output hot paths
+ *              of the firmware on the host build. For every function it
+ *              reports the time per call on the Uno as modeled by the 
+ *              virtual clock (us and cycles at 16 MHz) and the host time.
+ *              It also measures the sample rate and the latency from a 
+ *              load step to the first correct weight on the display and
+ *              compares the MCU duty cycle and current of busy-waiting with
+ *              sleep-waiting for DOUT at 10 and 80 SPS.
+ *              Results are written as JSON, compare two runs with
+ *              tools/bench_compare.py.
+ * 
+ * Usage        pio run -e native_bench
+ *              .pio/build/native_bench/program [results.json]
+ */
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include "HX711_GSR.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+#ifndef SIM_PIN_DOUT
+#define SIM_PIN_DOUT    3
+#endif
+#ifndef SIM_PIN_PD_SCK
+#define SIM_PIN_PD_SCK  2
+#endif
+
+constexpr double F_CPU_MHZ = 16.0;
+constexpr double I_ACTIVE_MA = 9.0;    // ATmega328P at 16 MHz, 5 V, active
+constexpr double I_IDLE_MA   = 3.0;    // same in idle sleep (MCU only, no board)
+
+extern HX711_GSR myScale;
+void doMenu();
+
+static SimHX711    hx711(SIM_PIN_DOUT, SIM_PIN_PD_SCK);
+static SimLoadCell cell;
+static std::string out;     // serial output of the firmware
+
+struct Result { const char *name; uint32_t calls; double usPerCall; double hostNsPerCall; };
+struct Energy { uint8_t sps; WAIT_MODE mode; double duty; double mA; double mAhPerDay; };
+
+/**
+ * Wait for the next conversion without charging the firmware
+ */
+static void waitReady()
+{
+	while (hx711.pinRead(SIM_PIN_DOUT, SimCore::now()) == HIGH)
+		SimCore::advance(10000);
+}
+
+template <typename F> static Result measure(const char *name, uint32_t calls, bool atReady, F f)
+{
+	uint64_t virt = 0, host = 0;
+	for (uint32_t i = 0; i < calls; i++)
+	{
+		if (atReady) waitReady();
+		Serial.flush();
+		uint64_t v0 = SimCore::now();
+		auto h0 = std::chrono::steady_clock::now();
+		f();
+		host += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - h0).count();
+		virt += SimCore::now() - v0;
+	}
+	return { name, calls, virt / 1e3 / calls, (double)host / calls };
+}
+
+/**
+ * Samples per second a tight getRawValue() loop achieves: n samples span
+ * n - 1 intervals from the first to the last
+ */
+static double sampleRate(uint8_t sps, double seconds)
+{
+	hx711.setRate(sps);
+	waitReady();
+	uint64_t end = SimCore::now() + (uint64_t)(seconds * 1e9);
+	uint64_t first = 0, last = 0;
+	uint32_t n = 0;
+	while (SimCore::now() < end)
+	{
+		myScale.getRawValue();
+		last = SimCore::now();
+		if (n++ == 0) first = last;
+	}
+	hx711.setRate(10);
+	return n > 1 ? (n - 1) / ((last - first) * 1e-9) : 0.0;
+}
+
+/**
+ * Acquire continuously for a minute and account the time the MCU was awake
+ */
+static Energy energy(uint8_t sps, WAIT_MODE mode)
+{
+	hx711.setRate(sps);
+	myScale.set_waitMode(mode);
+	waitReady();
+	uint64_t t0 = SimCore::now(), slept0 = SimCore::sleptNs();
+	while (SimCore::now() - t0 < 60000000000ULL)
+		myScale.getRawValue();
+	double total = (double)(SimCore::now() - t0);
+	double duty  = 1.0 - (SimCore::sleptNs() - slept0) / total;
+	double mA    = duty * I_ACTIVE_MA + (1.0 - duty) * I_IDLE_MA;
+	myScale.set_waitMode(WAIT_MODE::BUSY);
+	hx711.setRate(10);
+	return { sps, mode, duty, mA, mA * 24.0 };
+}
+
+/**
+ * Load steps from 0 to grams, 'w' is pressed whenever the previous answer is 
+ * complete. Returns the time until the first weight within tol is displayed.
+ */
+static double loadToDisplayMs(double grams, double tol)
+{
+	cell.step(SimCore::now() * 1e-9, grams);
+	uint64_t tStep = SimCore::now();
+	while (SimCore::now() - tStep < 30000000000ULL)
+	{
+		out.clear();
+		Serial.inject("w");
+		doMenu();
+		Serial.flush();
+		const char *p = out.c_str();
+		while (*p && !strchr("-0123456789", *p)) p++;
+		if (*p && fabs(strtod(p, nullptr) - grams) <= tol)
+			return (SimCore::now() - tStep) * 1e-6;
+	}
+	return -1.0;
+}
+
+static void writeJson(FILE *f, Result *r, int nbr, double sps10, double sps80, double latency, Energy *e, int nbrE)
+{
+	fprintf(f, "{\n  \"target\": \"host\",\n  \"f_cpu_mhz\": %.0f,\n  \"functions\": {\n", F_CPU_MHZ);
+	for (int i = 0; i < nbr; i++)
+		fprintf(f, "    \"%s\": { \"calls\": %u, \"us_per_call\": %.2f, \"cycles_per_call\": %.0f, \"host_ns_per_call\": %.0f }%s\n",
+			r[i].name, r[i].calls, r[i].usPerCall, r[i].usPerCall * F_CPU_MHZ, r[i].hostNsPerCall, i < nbr - 1 ? "," : "");
+	fprintf(f, "  },\n  \"samples_per_s_10sps\": %.2f,\n  \"samples_per_s_80sps\": %.2f,\n", sps10, sps80);
+	fprintf(f, "  \"load_to_display_ms\": %.1f,\n  \"energy\": {\n", latency);
+	for (int i = 0; i < nbrE; i++)
+		fprintf(f, "    \"%s_%usps\": { \"duty_cycle\": %.4f, \"mA\": %.3f, \"mAh_per_day\": %.1f }%s\n",
+			e[i].mode == WAIT_MODE::BUSY ? "busy" : "sleep", e[i].sps, e[i].duty, e[i].mA, e[i].mAhPerDay, i < nbrE - 1 ? "," : "");
+	fprintf(f, "  }\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	Serial.setEcho(nullptr);
+	Serial.setSink([](uint8_t c, uint64_t) { out += (char)c; });
+	setup();
+
+	// calibrate from the model: 0 g and 500 g
+	myScale.set_wref(500);
+	myScale.set_v0(hx711.toCode(cell.volts(0), 1));
+	myScale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	myScale.calculateCoefficients();
+
+	Result r[] =
+	{
+		measure("getRawValue",          200, false, [] { myScale.getRawValue(); }),
+		measure("getRawValue_ready",    200, true,  [] { myScale.getRawValue(); }),
+		measure("getAverageValue_16",     5, false, [] { myScale.getAverageValue(16); }),
+		measure("getWeight_8",            5, false, [] { myScale.getWeight(8); }),
+		measure("printEquation",        200, false, [] { myScale.printEquation(); }),
+		measure("doMenu_unknown_key",   200, false, [] { Serial.inject("x"); doMenu(); }),
+		measure("doMenu_e",             200, false, [] { Serial.inject("e"); doMenu(); }),
+	};
+	int nbr = sizeof(r) / sizeof(r[0]);
+
+	double sps10 = sampleRate(10, 10.0);
+	double sps80 = sampleRate(80, 10.0);
+	double latency = loadToDisplayMs(500.0, 1.0);
+	Energy e[] = 
+	{ 
+		energy(10, WAIT_MODE::BUSY), energy(10, WAIT_MODE::SLEEP),
+		energy(80, WAIT_MODE::BUSY), energy(80, WAIT_MODE::SLEEP)
+	};
+
+	FILE *f = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (!f) 
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+	writeJson(f, r, nbr, sps10, sps80, latency, e, sizeof(e) / sizeof(e[0]));
+	if (f != stdout) fclose(f);
+	return 0;
+}
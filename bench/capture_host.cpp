@@ -0,0 +1,224 @@
+/**
+ * Program      capture_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Checks HX711_Capture on the host with the buffer size of the
+ *              Uno. A pull test at 80 SPS: the force rises to 750 g in
+ *              0.6 s, drops to 600 g while the specimen necks and breaks
+ *              0.1 s later. Then a compression test to -400 g with a
+ *              negative trigger level. The loop reads every conversion,
+ *              the capture runs in the sample handler; every conversion
+ *              must be in the buffer, with the pre-trigger history, and
+ *              the peak must be the largest sample. The binary dump is
+ *              decoded and compared to the samples the handler was given.
+ *              A pull test to 2500 g with auto ranging, beyond the range of
+ *              gain 128: samples above 24 bits are stored halved, the peak
+ *              must still be found and the dump match within one digit.
+ *              For comparison the peak of the same pull test when the loop
+ *              polls getWeight(8), the capture then counts the gaps.
+ *              Exit code 1 if a conversion is missing, the dump differs or
+ *              the peak is off by more than 1 % or one sample period.
+ *
+ * Usage        pio run -e native_capture
+ *              .pio/build/native_capture/program
+ */
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "HX711_Capture.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr uint16_t PRE = HX711_CAPTURE_SIZE / 4, POST = HX711_CAPTURE_SIZE - PRE;
+
+static SimHX711      hx711(PIN_DOUT, PIN_PD_SCK, 80);
+static SimLoadCell   cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR     scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Capture capture(scale);
+
+// what the sample handler was given
+static std::vector<int32_t>  fedRaw;
+static std::vector<uint32_t> fedTs;
+static std::vector<uint8_t>  dumped;
+static double handlerNs = 0.0;
+static uint32_t handlerCalls = 0;
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	fedRaw.push_back(raw);
+	fedTs.push_back(timestamp);
+	auto h0 = std::chrono::steady_clock::now();
+	capture.onSample(raw, timestamp);
+	handlerNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - h0).count();
+	handlerCalls++;
+}
+
+struct Result { bool complete; uint32_t missed; float peak; double truePeak; double peakErr; double peakDtMs; bool history; bool dumpOk; };
+
+/**
+ * Load profile starting 0.5 s from now, returns the time of the true peak [s]
+ */
+static double profile(double sign, double peak)
+{
+	double t0 = SimCore::now() * 1e-9 + 0.5;
+	cell.step(t0 - 0.5, 0.0);
+	cell.ramp(t0, t0 + 0.6, sign * peak);
+	cell.ramp(t0 + 0.6, t0 + 0.7, sign * peak * 0.8);
+	cell.step(t0 + 0.7, 0.0);
+	return t0 + 0.6;
+}
+
+/**
+ * Decode the binary dump and compare it to the capture and to the samples
+ * the handler saw
+ */
+static bool decode(const std::vector<uint8_t> &d)
+{
+	auto u16 = [&](size_t i) { return (uint16_t)(d[i] | d[i + 1] << 8); };
+	auto u32 = [&](size_t i) { return (uint32_t)d[i] | (uint32_t)d[i + 1] << 8 | (uint32_t)d[i + 2] << 16 | (uint32_t)d[i + 3] << 24; };
+	if (d.size() < 24 || memcmp(d.data(), "HXC2", 4) != 0) return false;
+	uint16_t count = u16(4);
+	size_t bitmap = 22u + 5u * count;
+	if (d.size() != bitmap + (count + 7u) / 8u + 2u) return false;
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < d.size() - 2; i++)
+	{
+		crc ^= (uint16_t)d[i] << 8;
+		for (int k = 0; k < 8; k++) crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+	}
+	if (crc != u16(d.size() - 2)) return false;
+	if (count != capture.getCount() || u16(6) != capture.getTriggerIndex() || u16(8) != capture.getGaps()) return false;
+	uint32_t t = u32(10);
+	size_t first = fedRaw.size() - count;			// the capture holds the last count samples
+	for (uint16_t i = 0; i < count; i++)
+	{
+		size_t p = 22 + 5 * i;
+		int32_t raw = (int32_t)((uint32_t)d[p + 2] << 24 | (uint32_t)d[p + 1] << 16 | (uint32_t)d[p] << 8) >> 8;
+		bool halved = d[bitmap + i / 8] >> (i % 8) & 1;
+		if (halved) raw *= 2;
+		if (i > 0) t += (uint32_t)(uint16_t)(u16(p + 3) - u16(p - 2)) << 2;
+		if (raw != (halved ? fedRaw[first + i] >> 1 << 1 : fedRaw[first + i]) || raw != capture.getRaw(i)) return false;
+		if (t != capture.getTimestamp(i) || (int32_t)(t - fedTs[first + i]) > 3 || (int32_t)(t - fedTs[first + i]) < -3) return false;
+	}
+	return true;
+}
+
+static Result test(double sign, double peak, float trigger)
+{
+	Result r = {};
+	double tPeak = profile(sign, peak);
+	fedRaw.clear();
+	fedTs.clear();
+	uint32_t missed0 = hx711.stats().samplesMissed;
+	uint32_t conv0 = 0;
+	capture.arm(trigger, PRE, POST);
+	while (!capture.isDone())
+	{
+		if (!scale.isReady())
+		{
+			SimCore::advance(50000);
+			continue;
+		}
+		scale.getRawValue();
+		if (fedRaw.size() == 1) conv0 = hx711.stats().conversions;
+	}
+	r.missed = hx711.stats().samplesMissed - missed0;
+	r.complete = r.missed == 0 && capture.getGaps() == 0 && capture.getCount() == PRE + POST
+		&& hx711.stats().conversions - conv0 + 1 == fedRaw.size();
+	r.history = capture.getTriggerIndex() == PRE;
+	for (uint16_t i = 0; i < capture.getTriggerIndex(); i++)
+		if (sign * (scale.get_m() * capture.getRaw(i) + scale.get_b()) >= fabs(trigger)) r.history = false;
+
+	// the peak must be the extreme of all samples
+	int32_t best = fedRaw[0];
+	for (int32_t v : fedRaw) if (sign > 0 ? v > best : v < best) best = v;
+	r.peak = capture.getPeak();
+	r.truePeak = sign * peak;
+	r.peakErr = r.peak - r.truePeak;
+	r.peakDtMs = ((int64_t)capture.getPeakTime() - (int64_t)(tPeak * 1e6)) / 1000.0;
+	bool extreme = fabs(r.peak - (scale.get_m() * best + scale.get_b())) < 1e-3;
+
+	dumped.clear();
+	capture.dump();
+	r.dumpOk = extreme && decode(dumped);
+	delay(500);
+	return r;
+}
+
+int main()
+{
+	Serial.begin(115200);
+	Serial.setEcho(nullptr);
+	Serial.setSink([](uint8_t c, uint64_t) { dumped.push_back(c); });
+	cell.seed(3);
+	cell.setNoise(0.2);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+	delay(500);
+
+	Result pull = test(1.0, 750.0, 50.0f);
+	Result comp = test(-1.0, 400.0, -50.0f);
+
+	// auto ranging, the gain ratio measured at 500 g
+	cell.step(SimCore::now() * 1e-9, 500.0);
+	delay(500);
+	scale.calibrateRange(16);
+	scale.set_autoRange(true);
+	Result wide = test(1.0, 2500.0, 50.0f);
+	int32_t wideMax = *std::max_element(fedRaw.begin(), fedRaw.end());
+	scale.set_autoRange(false);
+
+	// the same pull test read by getWeight(8) from the loop
+	profile(1.0, 750.0);
+	capture.arm(50.0f, PRE, POST);
+	double polledMax = 0.0;
+	uint64_t end = SimCore::now() + 3000000000ULL;
+	while (SimCore::now() < end) polledMax = fmax(polledMax, scale.getWeight(8));
+	uint16_t polledGaps = capture.getGaps();
+	capture.disarm();
+
+	bool ok = true;
+	const Result *res[] = { &pull, &comp };
+	const char *name[] = { "pull", "compression" };
+	printf("capture_size           = %u samples (%u before the trigger)\n", HX711_CAPTURE_SIZE, PRE);
+	printf("buffer_bytes           = %u\n", (unsigned)(5 * HX711_CAPTURE_SIZE + (HX711_CAPTURE_SIZE + 7) / 8));
+	printf("object_bytes_host      = %u\n", (unsigned)sizeof(HX711_Capture));
+	printf("dump_bytes             = %u\n", (unsigned)dumped.size());
+	printf("handler_host_ns        = %.1f\n", handlerNs / handlerCalls);
+	for (int k = 0; k < 2; k++)
+	{
+		const Result &r = *res[k];
+		char key[32];
+		snprintf(key, sizeof(key), "%s.complete", name[k]);
+		printf("%-22s = %d (missed %lu)\n", key, r.complete, (unsigned long)r.missed);
+		snprintf(key, sizeof(key), "%s.history", name[k]);
+		printf("%-22s = %d\n", key, r.history);
+		snprintf(key, sizeof(key), "%s.peak_g", name[k]);
+		printf("%-22s = %.2f (true %.1f)\n", key, r.peak, r.truePeak);
+		snprintf(key, sizeof(key), "%s.peak_dt_ms", name[k]);
+		printf("%-22s = %.1f\n", key, r.peakDtMs);
+		snprintf(key, sizeof(key), "%s.dump_ok", name[k]);
+		printf("%-22s = %d\n", key, r.dumpOk);
+		ok = ok && r.complete && r.history && r.dumpOk && fabs(r.peakErr) <= 0.01 * fabs(r.truePeak) && fabs(r.peakDtMs) <= 12.5;
+	}
+	printf("wide.max_raw           = %ld (fed %ld)\n", lround((wide.peak - scale.get_b()) / scale.get_m()), (long)wideMax);
+	printf("wide.peak_g            = %.2f (true %.1f)\n", wide.peak, wide.truePeak);
+	printf("wide.peak_dt_ms        = %.1f\n", wide.peakDtMs);
+	printf("wide.dump_ok           = %d\n", wide.dumpOk);
+	ok = ok && wide.dumpOk && fabs(wide.peakErr) <= 0.01 * fabs(wide.truePeak) && fabs(wide.peakDtMs) <= 12.5;
+	printf("polled.max_g           = %.2f\n", polledMax);
+	printf("polled.gaps            = %u\n", polledGaps);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+/**
+ * Program      capturefile_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Range queries on HX711_CaptureFile over 1e9 samples, 145
+ *              days at 80 SPS with a gap of 10 minutes every 2^20 samples,
+ *              weights in mg along a daily cycle with noise. First a small
+ *              capture is written in three sessions with a 2 hour gap in
+ *              it and checked against the samples in memory, the reader is
+ *              refreshed while it grows. Then the large capture is written
+ *              and 1000 random ranges per span of 1 s .. 1 week and 20 of
+ *              everything are aggregated with the index. Some of each span
+ *              are compared to a scan of the data file from its start, as
+ *              without an index.
+ *              Exit code 1 if an aggregate differs from the scan or the
+ *              samples in memory, or the 99th percentile of a query takes
+ *              more than 10 ms.
+ *
+ * Usage        pio run -e native_capturefile
+ *              .pio/build/native_capturefile/program [samples] [dir]
+ *              the capture takes 8 bytes per sample in dir (/tmp)
+ */
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "HX711_CaptureFile.h"
+
+constexpr int64_t  T0 = 1767225600000000LL;                      // 2026-01-01 [us]
+constexpr int64_t  INTERVAL = 12500, GAP = 600000000LL;          // [us]
+constexpr uint64_t GAP_EVERY = 1 << 20;
+
+static double seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t lcg = 49;
+static uint32_t random32()
+{
+	lcg = lcg * 1664525UL + 1013904223UL;
+	return lcg;
+}
+
+static void removeCapture(const std::string &base)
+{
+	unlink((base + ".hxd").c_str());
+	unlink((base + ".hxi").c_str());
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++) unlink((base + ".p" + std::to_string(k)).c_str());
+}
+
+static bool same(const HX711_Aggregate &a, const HX711_Aggregate &b)
+{
+	return a.count == b.count && a.sum == b.sum && a.min == b.min && a.max == b.max;
+}
+
+/**
+ * Without an index: all blocks from the start until one begins after to
+ */
+static HX711_Aggregate scan(HX711_CaptureReader &r, int64_t from, int64_t to)
+{
+	HX711_Aggregate a = { 0, 0, INT32_MAX, INT32_MIN };
+	static std::vector<int64_t> us(HX711_CAPTURE_BLOCK);
+	static std::vector<int32_t> v(HX711_CAPTURE_BLOCK);
+	const HX711_CaptureEntry *e = r.getEntries();
+	for (uint64_t b = 0; b < r.getBlocks() && e[b].first < to; b++)
+	{
+		size_t n = r.read(e[b].first, e[b].last + 1, us.data(), v.data(), us.size());
+		for (size_t i = 0; i < n; i++)
+		{
+			if (us[i] < from || us[i] >= to) continue;
+			a.count++;
+			a.sum += v[i];
+			a.min = std::min(a.min, v[i]);
+			a.max = std::max(a.max, v[i]);
+		}
+	}
+	if (a.count == 0) a.min = a.max = 0;
+	return a;
+}
+
+/**
+ * Three sessions with partial blocks and a gap beyond the 32 bit offsets
+ */
+static bool checkSessions(const std::string &base)
+{
+	removeCapture(base);
+	std::vector<int64_t> t;
+	std::vector<int32_t> v;
+	for (int i = 0; i < 10000; i++)
+	{
+		t.push_back(T0 + i * INTERVAL + (i >= 6000 ? 7200000000LL : 0));
+		v.push_back((int32_t)(random32() >> 8) - 8000000);
+	}
+	HX711_CaptureReader reader;
+	bool ok = true;
+	size_t cut[] = { 0, 4321, 6000, 10000 };
+	for (int s = 0; s < 3; s++)
+	{
+		HX711_CaptureWriter writer(1000);
+		ok = ok && writer.open(base.c_str());
+		for (size_t i = cut[s]; i < cut[s + 1]; i++) ok = ok && writer.append(t[i], v[i]);
+		ok = ok && !writer.append(t[0], 0);                  // older
+		writer.flush();
+		ok = ok && (s == 0 ? reader.open(base.c_str()) : reader.refresh()) && reader.getSamples() == cut[s + 1];
+	}
+	for (int q = 0; q < 200 && ok; q++)
+	{
+		size_t i = random32() % t.size(), j = i + random32() % (t.size() - i);
+		HX711_Aggregate e = { 0, 0, INT32_MAX, INT32_MIN };
+		for (size_t k = i; k < j; k++)
+		{
+			e.count++;
+			e.sum += v[k];
+			e.min = std::min(e.min, v[k]);
+			e.max = std::max(e.max, v[k]);
+		}
+		if (e.count == 0) e.min = e.max = 0;
+		ok = same(reader.aggregate(t[i], j < t.size() ? t[j] : t.back() + 1), e);
+	}
+	removeCapture(base);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t samples = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000000ULL;
+	std::string base = std::string(argc > 2 ? argv[2] : "/tmp") + "/capturefile_host";
+	bool ok = checkSessions(base + "_small");
+	printf("sessions_check         = %s\n", ok ? "ok" : "FAILED");
+
+	removeCapture(base);
+	HX711_CaptureWriter writer;
+	if (!writer.open(base.c_str()))
+	{
+		printf("cannot open %s\n", base.c_str());
+		return 1;
+	}
+	double t = seconds();
+	int64_t us = T0;
+	for (uint64_t i = 0; i < samples; i++)
+	{
+		double day = (us - T0) * (2.0 * M_PI / 86400e6);
+		int32_t mg = (int32_t)(200000.0 + 100000.0 * sin(day)) + (int32_t)(random32() >> 22) - 512;
+		writer.append(us, mg);
+		us += INTERVAL + ((i + 1) % GAP_EVERY == 0 ? GAP : 0);
+	}
+	writer.close();
+	double writeS = seconds() - t;
+
+	HX711_CaptureReader reader;
+	ok = ok && reader.open(base.c_str()) && reader.getSamples() == samples;
+	printf("samples                = %llu in %llu blocks, %.1f days\n", (unsigned long long)reader.getSamples(),
+		(unsigned long long)reader.getBlocks(), (reader.getLast() - reader.getFirst()) / 86400e6);
+	printf("file_bytes_per_sample  = %.3f (index %.4f)\n", (8.0 * HX711_CAPTURE_BLOCK + sizeof(HX711_CaptureEntry))
+		* reader.getBlocks() / samples, (double)sizeof(HX711_CaptureEntry) * reader.getBlocks() / samples);
+	printf("write_Msps             = %.1f (%.1f s)\n", samples / writeS * 1e-6, writeS);
+
+	struct Span { const char *name; int64_t us; int queries, scans; };
+	const Span spans[] = { { "1s", 1000000LL, 1000, 3 }, { "1min", 60000000LL, 1000, 3 }, { "1h", 3600000000LL, 1000, 3 },
+		{ "1d", 86400000000LL, 1000, 2 }, { "1w", 604800000000LL, 1000, 2 }, { "all", 0, 20, 1 } };
+	int64_t first = reader.getFirst(), last = reader.getLast() + 1;
+	for (const Span &s : spans)
+	{
+		int64_t span = s.us ? std::min(s.us, last - first) : last - first;
+		std::vector<double> lat;
+		double scanS = 0.0, count = 0.0;
+		int wrong = 0;
+		for (int q = 0; q < s.queries; q++)
+		{
+			int64_t from = first + (int64_t)((last - first - span) * (random32() / 4294967296.0));
+			t = seconds();
+			HX711_Aggregate a = reader.aggregate(from, from + span);
+			lat.push_back((seconds() - t) * 1e6);
+			count += a.count;
+			if (q < s.scans)
+			{
+				t = seconds();
+				HX711_Aggregate b = scan(reader, from, from + span);
+				scanS += seconds() - t;
+				if (!same(a, b)) wrong++;
+			}
+		}
+		std::sort(lat.begin(), lat.end());
+		double mean = 0.0;
+		for (double l : lat) mean += l / lat.size();
+		double p99 = lat[lat.size() * 99 / 100];
+		char key[32];
+		snprintf(key, sizeof(key), "query_%s_us", s.name);
+		printf("%-22s = mean %.1f, p99 %.1f (%.0f samples)\n", key, mean, p99, count / s.queries);
+		snprintf(key, sizeof(key), "scan_%s_ms", s.name);
+		printf("%-22s = %.1f, %d of %d differ\n", key, scanS * 1e3 / s.scans, wrong, s.scans);
+		ok = ok && wrong == 0 && p99 <= 10000.0;
+	}
+	reader.close();
+	removeCapture(base);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
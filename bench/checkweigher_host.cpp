@@ -0,0 +1,166 @@
+/**
+ * Program      checkweigher_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Throughput and accuracy of HX711_Checkweigher on synthetic
+ *              pulse trains at 80 SPS with the buffer size of the Uno.
+ *              Items of 50 to 500 g, 100 mm long, are spaced 500 mm on a
+ *              belt over a 250 mm platform. The load ramps up while an
+ *              item moves onto the platform, stays while it crosses and
+ *              ramps down while it leaves; each item bounces when it is
+ *              fully on (8 % of its weight at 18 Hz, decaying in 40 ms).
+ *              The belt adds 0.3 g of vibration at 7 Hz to 0.2 g of noise.
+ *              The belt speed sets the items per minute. Every result is
+ *              matched to the item on the platform at its timestamp.
+ *              Exit code 1 if an item is missed or counted twice, if an item
+ *              with a quality of 50 or more is off by more than 3 times
+ *              maxError (0.5 g), or if at 60 items/min the rms error
+ *              exceeds maxError or less than 95 % reach quality 50.
+ *
+ * Usage        pio run -e native_checkweigher
+ *              .pio/build/native_checkweigher/program
+ */
+#include <Arduino.h>
+#include <vector>
+#include "HX711_Checkweigher.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr double  PLATFORM = 0.25, LENGTH = 0.10, PITCH = 0.50;   // [m]
+constexpr float   MAX_ERROR = 0.5f, ENTER = 20.0f;                // [g]
+constexpr int     ITEMS = 100;
+
+static SimHX711    hx711(PIN_DOUT, PIN_PD_SCK, 80);
+static SimLoadCell cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR   scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Checkweigher checkweigher(scale);
+
+struct Truth { double tIn, tOn, tOff, tOut, grams; };
+static std::vector<Truth> items;
+static size_t bouncing = 0;             // item whose bounce is added
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	checkweigher.onSample(raw, timestamp);
+}
+
+static double bounce(double t)
+{
+	while (bouncing + 1 < items.size() && items[bouncing + 1].tOn <= t) bouncing++;
+	if (items.empty() || t < items[bouncing].tOn) return 0.0;
+	double dt = t - items[bouncing].tOn;
+	return 0.08 * items[bouncing].grams * sin(2.0 * M_PI * 18.0 * dt) * exp(-dt / 0.04);
+}
+
+static uint32_t lcg = 4711;
+static double random01()
+{
+	lcg = lcg * 1664525UL + 1013904223UL;
+	return (lcg >> 8) / 16777216.0;
+}
+
+struct Result { double ipm; int detected, missed, extra, good; double rms, maxErr, quality, goodMax; };
+
+static Result run(double speed)
+{
+	Result r = {};
+	r.ipm = 60.0 * speed / PITCH;
+	items.clear();
+	bouncing = 0;
+	double t = SimCore::now() * 1e-9 + 1.0;
+	cell.step(t - 1.0, 0.0);
+	for (int k = 0; k < ITEMS; k++)
+	{
+		Truth it = { t, t + LENGTH / speed, t + PLATFORM / speed, t + (PLATFORM + LENGTH) / speed, 50.0 + 450.0 * random01() };
+		cell.ramp(it.tIn, it.tOn, it.grams);
+		cell.ramp(it.tOff, it.tOut, 0.0);
+		items.push_back(it);
+		t += PITCH / speed;
+	}
+	checkweigher.start(ENTER, MAX_ERROR);
+	std::vector<int> hits(ITEMS, 0);
+	double sumSq = 0.0, sumQ = 0.0;
+	while (SimCore::now() * 1e-9 < t + 0.5)
+	{
+		if (!scale.isReady())
+		{
+			SimCore::advance(50000);
+			continue;
+		}
+		scale.getRawValue();
+		while (checkweigher.available())
+		{
+			HX711_Item item = checkweigher.getItem();
+			double ts = item.timestamp * 1e-6;
+			int k = 0;
+			while (k < ITEMS && !(ts >= items[k].tIn && ts <= items[k].tOut)) k++;
+			if (k == ITEMS || hits[k]++)
+			{
+				r.extra++;
+				continue;
+			}
+			double e = item.weight - items[k].grams;
+			r.detected++;
+			sumSq += e * e;
+			sumQ += item.quality;
+			r.maxErr = fmax(r.maxErr, fabs(e));
+			if (item.quality >= 50)
+			{
+				r.good++;
+				r.goodMax = fmax(r.goodMax, fabs(e));
+			}
+		}
+	}
+	checkweigher.stop();
+	for (int k = 0; k < ITEMS; k++) if (!hits[k]) r.missed++;
+	r.rms = r.detected ? sqrt(sumSq / r.detected) : 0.0;
+	r.quality = r.detected ? sumQ / r.detected : 0.0;
+	return r;
+}
+
+int main()
+{
+	cell.seed(11);
+	cell.setNoise(0.2);
+	cell.setVibration(0.3, 7.0);
+	hx711.setInput([](char chn, uint64_t ns)
+	{
+		return chn == 'A' ? cell.volts(ns) + cell.gramsToVolts(bounce(ns * 1e-9)) : 0.0;
+	});
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+
+	const double speeds[] = { 0.5, 1.0, 1.5, 2.0 };		// [m/s]
+	bool ok = true;
+	printf("item_samples_max       = %u\n", HX711_ITEM_SAMPLES);
+	printf("items_per_speed        = %d\n", ITEMS);
+	for (double v : speeds)
+	{
+		Result r = run(v);
+		char key[32];
+		snprintf(key, sizeof(key), "ipm_%.0f.detected", r.ipm);
+		printf("%-22s = %d (missed %d, extra %d)\n", key, r.detected, r.missed, r.extra);
+		snprintf(key, sizeof(key), "ipm_%.0f.rms_g", r.ipm);
+		printf("%-22s = %.3f\n", key, r.rms);
+		snprintf(key, sizeof(key), "ipm_%.0f.max_err_g", r.ipm);
+		printf("%-22s = %.3f\n", key, r.maxErr);
+		snprintf(key, sizeof(key), "ipm_%.0f.quality", r.ipm);
+		printf("%-22s = %.1f\n", key, r.quality);
+		snprintf(key, sizeof(key), "ipm_%.0f.q50", r.ipm);
+		printf("%-22s = %d, max err %.3f g\n", key, r.good, r.goodMax);
+		ok = ok && r.missed == 0 && r.extra == 0 && r.goodMax <= 3.0 * MAX_ERROR;
+		if (r.ipm <= 60.0) ok = ok && r.rms <= MAX_ERROR && r.good >= ITEMS * 95 / 100;
+	}
+	printf("belt_noise_g           = %.3f\n", checkweigher.getNoise());
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/**
+ * Program      counting_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Counting accuracy of HX711_Counter for very small parts on
+ *              the host, 10 SPS, 0.02 g noise. Every piece weighs its unit
+ *              weight with 0.5 % scatter. A 50 g container is tared and
+ *              10 pieces are the sample, both averaged over 64 samples, then
+ *              pieces are added up to 20, 40 .. 640 and 1000. After each
+ *              step the loop reads for 3 s and until a refinement is done,
+ *              then getWeight(16) once more, and the counts are compared to
+ *              the pieces on the scale:
+ *                refine     HX711_Counter with auto refine
+ *                fixed      HX711_Counter, unit weight of the 10 samples
+ *                weight     unit weight from getWeight(64), count from
+ *                           getWeight(16), i.e. rounded to 0.1 g
+ *              The counters see the same 16 samples as getWeight(16).
+ *              settle_samples: samples until the count follows one more
+ *              piece.
+ *              Resolution limit: the unit weight must be at least 4 times
+ *              the noise of a sample (0.08 g). Tare and sample differ by
+ *              0.0035 g rms, after the count doubles that is 0.007 g / unit
+ *              pieces, and a refinement needs the count within 0.3 pieces.
+ *              Below the limit a refinement may be missed and the count
+ *              drifts off: 0.023 g shows this, 0.047 g with other seeds.
+ *              Exit code 1 if refine is wrong more often than weight or,
+ *              from the limit up, its unit weight is off by more than 0.5 %
+ *              or its count by more than one piece.
+ *
+ * Usage        pio run -e native_counting
+ *              .pio/build/native_counting/program
+ */
+#include <Arduino.h>
+#include "HX711_Counter.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr double  CONTAINER = 50.0, SCATTER = 0.005;     // [g], relative
+constexpr double  NOISE = 0.02;                          // [g] per sample
+constexpr double  LIMIT = 4.0 * NOISE;                   // smallest unit weight counted exactly
+
+static SimHX711      hx711(PIN_DOUT, PIN_PD_SCK, 10);
+static SimLoadCell   cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR     scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Counter refine(scale), fixed(scale);
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	refine.onSample(raw, timestamp);
+	fixed.onSample(raw, timestamp);
+}
+
+static void read()
+{
+	while (!scale.isReady()) SimCore::advance(1000000);
+	scale.getRawValue();
+}
+
+/**
+ * Put the load on now and read for 3 s and until a refinement is done,
+ * then getWeight(nbr)
+ */
+static double settle(double grams, uint8_t nbr = 16)
+{
+	cell.step(SimCore::now() * 1e-9, grams);
+	uint64_t end = SimCore::now() + 3000000000ULL;
+	while (SimCore::now() < end || refine.isBusy()) read();
+	return scale.getWeight(nbr);
+}
+
+/**
+ * Tare or sample both counters, averaged over HX711_COUNT_AVERAGE samples
+ */
+static bool acquire(uint16_t pieces)
+{
+	bool ok = pieces ? refine.sample(pieces) && fixed.sample(pieces) : refine.tare() && fixed.tare();
+	while (refine.isBusy() || fixed.isBusy()) read();
+	return ok && !refine.hasFailed() && !fixed.hasFailed();
+}
+
+struct Result { double unit; int steps, wrong[3], maxErr[3], settle; double unitErr; };
+
+static Result run(double unit)
+{
+	const int counts[] = { 10, 20, 40, 80, 160, 320, 640, 1000 };
+	Result r = {};
+	r.unit = unit;
+	refine.clear();
+	fixed.clear();
+	double load = CONTAINER, wTare = settle(load, HX711_COUNT_AVERAGE);
+	bool ok = acquire(0);
+	int pieces = 0;
+	double wUnit = 0.0;
+	for (int n : counts)
+	{
+		while (pieces < n)
+		{
+			load += unit * (1.0 + SCATTER * cell.gaussian());
+			pieces++;
+		}
+		if (n == counts[0])
+		{
+			wUnit = (settle(load, HX711_COUNT_AVERAGE) - wTare) / n;
+			ok = ok && acquire(n);
+			fixed.setAutoRefine(false);
+			continue;
+		}
+		double w = settle(load) - wTare;
+		long got[3] = { (long)refine.getCount(), (long)fixed.getCount(), wUnit > 0.0 ? lround(w / wUnit) : 0L };
+		for (int k = 0; k < 3; k++)
+		{
+			int e = abs((int)(got[k] - n));
+			if (e) r.wrong[k]++;
+			if (e > r.maxErr[k]) r.maxErr[k] = e;
+		}
+		r.steps++;
+	}
+	if (!ok) r.wrong[0] = r.steps = -1;
+	r.unitErr = (refine.getUnitWeight() * pieces / (load - CONTAINER) - 1.0) * 100.0;
+
+	// samples until the count follows one more piece
+	int32_t c0 = refine.getCount();
+	load += unit;
+	cell.step(SimCore::now() * 1e-9, load);
+	while (r.settle < 100 && refine.getCount() != c0 + 1)
+	{
+		read();
+		r.settle++;
+	}
+	settle(0.0);
+	fixed.setAutoRefine(true);
+	return r;
+}
+
+int main()
+{
+	cell.seed(44);
+	cell.setNoise(NOISE);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+
+	const double units[] = { 0.023, 0.047, 0.083, 0.113, 0.387 };
+	const char *name[] = { "refine", "fixed", "weight" };
+	bool ok = true;
+	printf("digit_g                = %.6f\n", scale.get_m());
+	for (double u : units)
+	{
+		Result r = run(u);
+		char key[32];
+		for (int k = 0; k < 3; k++)
+		{
+			snprintf(key, sizeof(key), "u%.3f.%s", u, name[k]);
+			printf("%-22s = %d of %d wrong, max %d pcs\n", key, r.wrong[k], r.steps, r.maxErr[k]);
+		}
+		snprintf(key, sizeof(key), "u%.3f.unit_err_pct", u);
+		printf("%-22s = %.3f (%u refinements)\n", key, r.unitErr, refine.getRefinements());
+		snprintf(key, sizeof(key), "u%.3f.settle_samples", u);
+		printf("%-22s = %d\n", key, r.settle);
+		ok = ok && r.steps > 0 && r.wrong[0] <= r.wrong[2];
+		if (u >= LIMIT) ok = ok && fabs(r.unitErr) <= 0.5 && r.maxErr[0] <= 1;
+	}
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/**
+ * Program      fill_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Filling control on the host. A valve on PIN 7 (open while
+ *              the pin is LOW) pours 50 g/s into a container on the scale,
+ *              material leaving the nozzle needs 0.4 s to arrive, so about
+ *              20 g are in flight when the valve closes. HX711_Trigger 
+ *              closes it at the 500 g setpoint from the per-sample path 
+ *              and learns the in-flight amount; 3 s after each cutoff the
+ *              container is exchanged. For comparison the same fills are
+ *              controlled by polling getWeight(4) from the loop.
+ *              Reports the final weight errors and the latency from the
+ *              conversion to the pin change.
+ *              Finally a fill is stopped halfway, the valve must close.
+ *              Exit code 1 if the learned fills are off by more than 2 g or
+ *              the valve is left open by stop().
+ *
+ * Usage        pio run -e native_fill
+ *              .pio/build/native_fill/program
+ */
+#include <Arduino.h>
+#include <vector>
+#include "HX711_Trigger.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2, PIN_VALVE = 7;
+constexpr double  SETPOINT = 500.0;
+
+/**
+ * Valve, falling material and container
+ */
+class SimFill : public SimDevice
+{
+    public:
+        SimFill(double rate, double fall) : _rate(rate), _fall(fall * 1e9) {}
+        bool ownsPin(uint8_t pin) override { return pin == PIN_VALVE; }
+        int  pinRead(uint8_t, uint64_t) override { return _pin; }
+        void pinWritten(uint8_t, uint8_t level, uint64_t ns) override
+        {
+            _pin = level;
+            if (level == HIGH) closeAt = ns;
+            update(ns);
+        }
+        // grams in the container at ns
+        double grams(uint64_t ns)
+        {
+            double ms = 0.0;
+            uint64_t until = ns > _fall ? ns - _fall : 0;
+            for (auto &iv : _open)
+            {
+                uint64_t end = iv.second ? iv.second : UINT64_MAX;
+                if (until > iv.first) ms += (double)(std::min(end, until) - iv.first);
+            }
+            return present ? _rate * ms * 1e-9 : 0.0;
+        }
+        void exchange(uint64_t ns, bool nowPresent)
+        {
+            present = nowPresent;
+            _open.clear();
+            update(ns);
+        }
+
+        bool     present = true;
+        uint64_t closeAt = 0;
+
+    private:
+        // the valve pours while the pin is LOW and a container is there
+        void update(uint64_t ns)
+        {
+            bool open = _pin == LOW && present;
+            bool wasOpen = !_open.empty() && _open.back().second == 0;
+            if (open && !wasOpen) _open.push_back({ ns, 0 });
+            if (!open && wasOpen) _open.back().second = ns;
+        }
+
+        double   _rate;
+        uint64_t _fall;
+        int      _pin = HIGH;
+        std::vector<std::pair<uint64_t, uint64_t>> _open;
+};
+
+static SimHX711      hx711(PIN_DOUT, PIN_PD_SCK, 80);
+static SimLoadCell   cell(1000.0, 2.0, 5.0, 0.001);
+static SimFill       fill(50.0, 0.4);
+static HX711_GSR     scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Trigger trigger(scale);
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t value, uint32_t timestamp)
+{
+	trigger.onSample(value, timestamp);
+}
+
+struct Run { double firstErr, meanErr, maxErr; };
+
+/**
+ * Exchange the container 3 s after each cutoff: take it away for 1 s, 
+ * bring an empty one, the controller opens the valve again
+ */
+static bool exchangeDue(uint64_t &cutAt, std::vector<double> &errs, bool closed)
+{
+	uint64_t ns = SimCore::now();
+	if (closed && cutAt == 0) cutAt = ns;
+	if (cutAt && fill.present && ns - cutAt > 3000000000ULL)
+	{
+		errs.push_back(fill.grams(ns) - SETPOINT);
+		fill.exchange(ns, false);
+	}
+	if (cutAt && !fill.present && ns - cutAt > 4000000000ULL)
+	{
+		fill.exchange(ns, true);
+		cutAt = 0;
+		return true;
+	}
+	return false;
+}
+
+static Run summary(std::vector<double> &errs)
+{
+	Run r = { errs[0], 0.0, 0.0 };
+	size_t from = errs.size() / 2;
+	for (size_t i = from; i < errs.size(); i++)
+	{
+		r.meanErr += fabs(errs[i]) / (errs.size() - from);
+		r.maxErr = fmax(r.maxErr, fabs(errs[i]));
+	}
+	return r;
+}
+
+static Run perSample(int cycles, double &edgeToPinMaxUs)
+{
+	std::vector<double> errs;
+	uint64_t cutAt = 0;
+	edgeToPinMaxUs = 0.0;
+	scale.setSampleHandler(onSample);
+	trigger.start();
+	while ((int)errs.size() < cycles)
+	{
+		if (scale.isReady())
+		{
+			bool was = trigger.isActive(0);
+			scale.getRawValue();
+			if (!was && trigger.isActive(0))
+				edgeToPinMaxUs = fmax(edgeToPinMaxUs, (fill.closeAt - hx711.lastConversionAt()) / 1e3);
+		}
+		exchangeDue(cutAt, errs, trigger.isActive(0));
+		SimCore::advance(200000);		// rest of the loop
+	}
+	trigger.stop();
+	scale.setSampleHandler(nullptr);
+	return summary(errs);
+}
+
+static Run polled(int cycles)
+{
+	std::vector<double> errs;
+	uint64_t cutAt = 0;
+	bool closed = false;
+	fill.exchange(SimCore::now(), true);
+	digitalWrite(PIN_VALVE, LOW);
+	while ((int)errs.size() < cycles)
+	{
+		if (!closed && fill.present && scale.getWeight(4) >= SETPOINT)
+		{
+			digitalWrite(PIN_VALVE, HIGH);
+			closed = true;
+		}
+		if (exchangeDue(cutAt, errs, closed))
+		{
+			closed = false;
+			digitalWrite(PIN_VALVE, LOW);
+		}
+		SimCore::advance(200000);
+	}
+	digitalWrite(PIN_VALVE, HIGH);
+	return summary(errs);
+}
+
+/**
+ * Stop the trigger while the valve pours, stop() must close it
+ */
+static bool stopWhileFilling()
+{
+	fill.exchange(SimCore::now(), true);
+	scale.setSampleHandler(onSample);
+	trigger.start();
+	uint64_t end = SimCore::now() + 2000000000ULL;	// about 100 g of 500 g
+	while (SimCore::now() < end)
+	{
+		if (scale.isReady()) scale.getRawValue();
+		SimCore::advance(200000);
+	}
+	bool pouring = digitalRead(PIN_VALVE) == LOW;
+	trigger.stop();
+	scale.setSampleHandler(nullptr);
+	return pouring && digitalRead(PIN_VALVE) == HIGH;
+}
+
+int main()
+{
+	cell.seed(3);
+	cell.setNoise(0.2);
+	hx711.setInput([](char chn, uint64_t ns) 
+	{
+		return chn == 'A' ? cell.volts(ns) + cell.gramsToVolts(fill.grams(ns)) : 0.0;
+	});
+	SimCore::attach(&hx711);
+	SimCore::attach(&fill);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+
+	trigger.add(SETPOINT, 100.0, PIN_VALVE, HIGH);
+	trigger.setLearning(0, true, 0.5f, 1000);
+	double edgeToPin;
+	Run t = perSample(20, edgeToPin);
+	const HX711_Latency &lat = trigger.getLatency();
+	Run p = polled(10);
+	bool closedOnStop = stopWhileFilling();
+
+	printf("sps                    = 80\n");
+	printf("flow_g_per_s           = 50.0\n");
+	printf("in_flight_true_g       = 20.0\n");
+	printf("in_flight_learned_g    = %.2f\n", trigger.getInflight(0));
+	printf("trigger.first_err_g    = %.2f\n", t.firstErr);
+	printf("trigger.mean_abs_err_g = %.2f\n", t.meanErr);
+	printf("trigger.max_abs_err_g  = %.2f\n", t.maxErr);
+	printf("polled.mean_abs_err_g  = %.2f\n", p.meanErr);
+	printf("polled.max_abs_err_g   = %.2f\n", p.maxErr);
+	printf("sample_to_pin_min_us   = %lu\n", (unsigned long)lat.min);
+	printf("sample_to_pin_mean_us  = %lu\n", (unsigned long)(lat.n ? lat.sum / lat.n : 0));
+	printf("sample_to_pin_max_us   = %lu\n", (unsigned long)lat.max);
+	printf("dout_edge_to_pin_max_us= %.0f\n", edgeToPin);
+	printf("valve_closed_on_stop   = %d\n", closedOnStop);
+	bool ok = t.maxErr <= 2.0 && closedOnStop;
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
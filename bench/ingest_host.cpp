@@ -0,0 +1,343 @@
+/**
+ * Program      ingest_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Load test of HX711_Ingest with 64 pseudo terminals. Every
+ *              pty is driven by a child process that runs a simulated scale
+ *              (SimHX711, HX711_GSR, HX711_Reporter reporting every sample
+ *              at 80 SPS, 115200 baud) in real time: the bytes are written
+ *              to the pty when they have left the simulated UART. Even
+ *              devices send text lines, odd ones binary frames. Devices 3,
+ *              7, 11 .. drop every 1000th report, devices 1, 5, 9 .. corrupt
+ *              one byte of every 1500th frame.
+ *              This process reads all ptys like the daemon, with one
+ *              HX711_Ingest, and measures its CPU time and the true lag of
+ *              every reading: host time - (start + scale time); the
+ *              children run on the same CLOCK_MONOTONIC. Halfway through,
+ *              the latest values are asked for on the Unix socket, the
+ *              history of device 1 by a client that takes 1 KB of the
+ *              answer per poll, and the history of device 0 by a command
+ *              sent in two parts 300 ms apart; a client that connects at
+ *              the start and sends nothing must have been closed at the
+ *              end.
+ *              Exit code 1 if a device misses a reading that was sent,
+ *              counts other losses than the dropped and corrupted ones or
+ *              misses a corrupted frame, if the 99th percentile of the lag
+ *              from pty write to read exceeds the limit, if the socket does
+ *              not answer for every device, cuts the history short, rejects
+ *              the split command or keeps the idle client. The
+ *              limit is 20 ms with 4 or more CPUs, the devices and the
+ *              reader share fewer CPUs and wait for each other longer, so 
+ *              it scales with 4 / CPUs (80 ms on one CPU), or is given.
+ *
+ * Usage        pio run -e native_ingest
+ *              .pio/build/native_ingest/program [devices] [seconds] [limit ms]
+ */
+#include <Arduino.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "HX711_Reporter.h"
+#include "HX711_Ingest.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr const char *SOCKET = "/tmp/hx711_ingest_host.sock";
+
+static SimHX711       hx711(PIN_DOUT, PIN_PD_SCK, 80);
+static SimLoadCell    cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR      scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Reporter reporter(scale);
+
+struct Counts { uint32_t sent, dropped, corrupted, written; };
+struct Stamp { uint32_t ms; uint64_t us; };        // scale time, when written or read
+static std::vector<uint32_t> lags;                 // sample to read [us]
+static std::vector<std::vector<Stamp>> reads;
+static uint64_t start = 0;                         // CLOCK_MONOTONIC [us]
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	reporter.onSample(raw, timestamp);
+}
+
+static void onReading(uint16_t device, const HX711_Stamped &s)
+{
+	int64_t lag = (int64_t)s.hostUs - (int64_t)(start + s.scaleMs * 1000);
+	lags.push_back(lag > 0 ? lag : 0);
+	reads[device].push_back({ s.reading.ms, s.hostUs });
+}
+
+static void sleepUntil(uint64_t us)
+{
+	timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR);
+}
+
+/**
+ * Child: one scale in real time on the pty master
+ */
+static void runScale(int index, int master, Counts &c, Stamp *wr, double seconds)
+{
+	std::string out;
+	uint64_t sentAt = 0;
+	Serial.begin(115200);
+	Serial.setEcho(nullptr);
+	Serial.setSink([&](uint8_t b, uint64_t ns) { out.push_back(b); sentAt = ns; });
+	cell.seed(100 + index);
+	cell.setNoise(0.2);
+	for (double t = 2.0 + index * 0.1; t < seconds; t += 5.0) cell.step(t, 100.0 + 7.0 * index);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+	reporter.start(0.0f, 0);
+
+	while (SimCore::now() * 1e-9 < seconds)
+	{
+		if (!scale.isReady())
+		{
+			SimCore::advance(50000);
+			continue;
+		}
+		scale.getRawValue();
+		if (!reporter.available()) continue;
+		HX711_Report r = reporter.getReport();
+		c.sent++;
+		if (index % 4 == 3 && c.sent % 1000 == 0)
+		{
+			c.dropped++;
+			continue;
+		}
+		out.clear();
+		if (index % 2)
+		{
+			reporter.writeFrame(r);
+			if (index % 4 == 1 && c.sent % 1500 == 0)
+			{
+				out[7] ^= 0x10;
+				c.corrupted++;
+			}
+		}
+		else reporter.printText(r);
+		sleepUntil(start + sentAt / 1000);
+		for (size_t n = 0; n < out.size(); )
+		{
+			ssize_t w = ::write(master, out.data() + n, out.size() - n);
+			if (n == 0 && w > 0) *wr = { (uint32_t)(r.timestamp / 1000), HX711_Ingest::now() };
+			if (w <= 0) _exit(1);
+			n += w;
+		}
+		c.written++;
+		wr++;
+	}
+}
+
+/**
+ * Connect and send a command, the answer is read after some polls
+ */
+static int ask(const char *cmd)
+{
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, SOCKET);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) return -1;
+	send(fd, cmd, strlen(cmd), 0);
+	return fd;
+}
+
+struct Asked
+{
+	int    fd = -1;
+	size_t chunk = 4096;       // read per poll
+	std::string answer;
+	int    lines = -1;         // when closed
+};
+
+/**
+ * Read what is there, count the lines when the daemon closed
+ */
+static void collect(Asked &a)
+{
+	if (a.fd < 0) return;
+	char buf[4096];
+	ssize_t n = recv(a.fd, buf, a.chunk < sizeof(buf) ? a.chunk : sizeof(buf), MSG_DONTWAIT);
+	if (n > 0) a.answer.append(buf, n);
+	if (n != 0) return;
+	close(a.fd);
+	a.fd = -1;
+	a.lines = std::count(a.answer.begin(), a.answer.end(), '\n');
+}
+
+static double cpuSeconds()
+{
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+}
+
+int main(int argc, char *argv[])
+{
+	int devices = argc > 1 ? atoi(argv[1]) : 64;
+	double seconds = argc > 2 ? atof(argv[2]) : 20.0;
+	long   cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	double limitMs = argc > 3 ? atof(argv[3]) : 20.0 * (cpus > 0 && cpus < 4 ? 4.0 / cpus : 1.0);
+	Counts *counts = (Counts *)mmap(nullptr, devices * sizeof(Counts), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	memset(counts, 0, devices * sizeof(Counts));
+	size_t maxWrites = seconds * 80 + 100;
+	Stamp *writes = (Stamp *)mmap(nullptr, devices * maxWrites * sizeof(Stamp), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	reads.resize(devices);
+
+	HX711_Ingest ingest;
+	std::vector<int> masters;
+	for (int i = 0; i < devices; i++)
+	{
+		int m = posix_openpt(O_RDWR | O_NOCTTY);
+		if (m < 0 || grantpt(m) < 0 || unlockpt(m) < 0 || ingest.add(ptsname(m)) < 0)
+		{
+			perror("pty");
+			return 1;
+		}
+		masters.push_back(m);
+	}
+	ingest.listen(SOCKET);
+	ingest.setReadingHandler(onReading);
+	lags.reserve(devices * seconds * 80);
+
+	start = HX711_Ingest::now() + 300000;
+	std::vector<pid_t> children;
+	for (int i = 0; i < devices; i++)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			for (int k = 0; k < devices; k++) if (k != i) close(masters[k]);
+			runScale(i, masters[i], counts[i], writes + i * maxWrites, seconds);
+			_exit(0);
+		}
+		children.push_back(pid);
+	}
+
+	int idle = ask("");
+	double cpu0 = cpuSeconds();
+	uint64_t end = start + (uint64_t)(seconds * 1e6) + 500000;
+	Asked latest, history, split;
+	bool asked = false;
+	uint64_t historyMin = 0, splitAt = 0;
+	while (HX711_Ingest::now() < end)
+	{
+		ingest.poll(100);
+		if (!asked && HX711_Ingest::now() > start + (uint64_t)(seconds * 5e5))
+		{
+			latest.fd = ask("latest\n");
+			historyMin = std::min<uint64_t>(ingest.getStats(1 % devices).readings, HX711_HISTORY);
+			history.fd = ask(devices > 1 ? "history 1 4096\n" : "history 0 4096\n");
+			history.chunk = 1024;
+			split.fd = ask("hist");
+			splitAt = HX711_Ingest::now() + 300000;
+			asked = true;
+		}
+		if (splitAt && HX711_Ingest::now() >= splitAt)
+		{
+			if (split.fd >= 0) send(split.fd, "ory 0 50\n", 9, MSG_NOSIGNAL);
+			splitAt = 0;
+		}
+		collect(latest);
+		collect(history);
+		collect(split);
+	}
+	int answered = latest.lines;
+	bool historyFull = history.lines >= (int)historyMin && history.answer.back() == '\n';
+	double cpu = cpuSeconds() - cpu0;
+	char c;
+	bool idleClosed = idle >= 0 && recv(idle, &c, 1, MSG_DONTWAIT) == 0;
+	if (idle >= 0) close(idle);
+	int exited = 0;
+	for (pid_t pid : children)
+	{
+		int status;
+		waitpid(pid, &status, 0);
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 0) exited++;
+	}
+
+	bool ok = exited == devices && answered == devices && historyFull && split.lines == 50 && idleClosed;
+	uint64_t readings = 0, sent = 0, lost = 0, expectedLost = 0, broken = 0, corrupted = 0;
+	float lagMax = 0.0f, lagMean = 0.0f;
+	int wrong = 0;
+	for (int i = 0; i < devices; i++)
+	{
+		HX711_DeviceStats s = ingest.getStats(i);
+		const Counts &c = counts[i];
+		readings += s.readings;
+		sent += c.sent;
+		lost += s.lost;
+		expectedLost += c.dropped + c.corrupted;
+		broken += s.broken;
+		corrupted += c.corrupted;
+		lagMax = fmax(lagMax, s.lagMaxMs);
+		lagMean += s.lagMeanMs / devices;
+		if (s.readings != c.sent - c.dropped - c.corrupted || s.lost != c.dropped + c.corrupted || s.broken < c.corrupted)
+		{
+			if (wrong++ < 4) printf("device %d: %llu readings of %u, %llu lost of %u, %llu broken of %u\n", i,
+				(unsigned long long)s.readings, c.sent - c.dropped - c.corrupted, (unsigned long long)s.lost,
+				c.dropped + c.corrupted, (unsigned long long)s.broken, c.corrupted);
+		}
+	}
+	std::vector<uint32_t> readLags;                  // write to read [us]
+	for (int i = 0; i < devices; i++)
+	{
+		const Stamp *w = writes + i * maxWrites;
+		size_t k = 0;
+		for (const Stamp &r : reads[i])
+		{
+			while (k < counts[i].written && w[k].ms != r.ms) k++;
+			if (k == counts[i].written) break;
+			readLags.push_back(r.us > w[k].us ? r.us - w[k].us : 0);
+		}
+	}
+	ok = ok && readLags.size() == readings;
+	std::sort(readLags.begin(), readLags.end());
+	std::sort(lags.begin(), lags.end());
+	double p50 = lags.empty() ? 0.0 : lags[lags.size() / 2] * 1e-3;
+	double p99 = lags.empty() ? 0.0 : lags[lags.size() * 99 / 100] * 1e-3;
+	double max = lags.empty() ? 0.0 : lags.back() * 1e-3;
+	double r50 = readLags.empty() ? 0.0 : readLags[readLags.size() / 2] * 1e-3;
+	double r99 = readLags.empty() ? 0.0 : readLags[readLags.size() * 99 / 100] * 1e-3;
+	double rMax = readLags.empty() ? 0.0 : readLags.back() * 1e-3;
+	ok = ok && wrong == 0 && r99 <= limitMs;
+
+	printf("devices                = %d\n", devices);
+	printf("seconds                = %.0f\n", seconds);
+	printf("readings               = %llu of %llu sent (%.0f/s)\n", (unsigned long long)readings, (unsigned long long)sent,
+		readings / seconds);
+	printf("lost                   = %llu (dropped or corrupted %llu)\n", (unsigned long long)lost, (unsigned long long)expectedLost);
+	printf("broken                 = %llu (corrupted %llu)\n", (unsigned long long)broken, (unsigned long long)corrupted);
+	printf("devices_wrong          = %d\n", wrong);
+	printf("cpu_pct                = %.2f\n", cpu / (seconds + 0.8) * 100.0);
+	printf("cpu_us_per_reading     = %.2f\n", readings ? cpu * 1e6 / readings : 0.0);
+	printf("lag_ms p50/p99/max     = %.2f / %.2f / %.2f\n", p50, p99, max);
+	printf("read_lag_ms p50/p99/max= %.2f / %.2f / %.2f (p99 limit %.0f, %ld CPUs)\n", r50, r99, rMax, limitMs, cpus);
+	printf("lag_estimate_ms        = mean %.2f, max %.2f\n", lagMean, lagMax);
+	printf("socket_latest_lines    = %d\n", answered);
+	printf("socket_history_lines   = %d (at least %llu)\n", history.lines, (unsigned long long)historyMin);
+	printf("socket_split_lines     = %d of 50\n", split.lines);
+	printf("socket_idle_closed     = %d\n", idleClosed);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+/**
+ * Program      logcodec_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Compression and speed of HX711_LogCodec on the host. The
+ *              traces are acquired through the simulated HX711 like on the
+ *              board, 10 minutes each:
+ *                quiet10    10 SPS, 0.02 g noise, a constant 200 g
+ *                busy80     80 SPS, 0.2 g noise, 0.3 g vibration, a load
+ *                           that steps and ramps between 0 and 900 g
+ *                lossy80    busy80 with every 300th sample lost
+ *              A recorded trace can be added as argument, a text file with
+ *              "timestamp[us] raw" per line.
+ *              Every trace is coded VARINT and RICE into 256 byte blocks
+ *              and decoded again; ratio is to 8 bytes per sample (raw and
+ *              timestamp as binary), hours_2MB the hours of samples that
+ *              90 % of a 2 MB LittleFS hold at the rate of the trace.
+ *              Msps_enc/dec: million samples per second on this host.
+ *              Exit code 1 if a raw value differs after decoding, an
+ *              interpolated timestamp is off by more than a quarter of the
+ *              sample interval, a block with one flipped bit is accepted,
+ *              RICE needs more bytes than VARINT or its ratio is below 4.
+ *
+ * Usage        pio run -e native_logcodec
+ *              .pio/build/native_logcodec/program [trace.txt]
+ */
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "HX711_GSR.h"
+#include "HX711_LogCodec.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr double  DURATION = 600.0;                                 // [s]
+constexpr double  FS_BYTES = 0.9 * 2 * 1024 * 1024;
+
+struct Sample { int32_t raw; uint32_t ts; };
+struct Trace { const char *name; std::vector<Sample> s; };
+
+static SimHX711    hx711(PIN_DOUT, PIN_PD_SCK, 10);
+static SimLoadCell cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR   scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static std::vector<Sample> *recording = nullptr;
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	if (recording) recording->push_back({ raw, timestamp });
+}
+
+static void acquire(std::vector<Sample> &s)
+{
+	recording = &s;
+	double end = SimCore::now() * 1e-9 + DURATION;
+	while (SimCore::now() * 1e-9 < end)
+	{
+		if (!scale.isReady())
+		{
+			SimCore::advance(50000);
+			continue;
+		}
+		scale.getRawValue();
+	}
+	recording = nullptr;
+}
+
+static double seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void encode(LOG_CODING coding, const std::vector<Sample> &s, std::vector<uint8_t> &blocks)
+{
+	HX711_LogCodec codec(coding);
+	blocks.clear();
+	for (const Sample &x : s)
+	{
+		codec.put(x.raw, x.ts);
+		if (codec.available()) blocks.insert(blocks.end(), codec.take(), codec.take() + HX711_LOG_BLOCK);
+	}
+	codec.flush();
+	blocks.insert(blocks.end(), codec.take(), codec.take() + HX711_LOG_BLOCK);
+}
+
+struct Result { size_t blocks; double bytesPerSample, encMsps, decMsps, tsErr, interval; bool exact; };
+
+static Result run(LOG_CODING coding, const std::vector<Sample> &s)
+{
+	Result r = {};
+	std::vector<uint8_t> blocks;
+	size_t reps = 2000000 / s.size() + 1;
+	double t = seconds();
+	for (size_t i = 0; i < reps; i++) encode(coding, s, blocks);
+	r.encMsps = reps * s.size() / (seconds() - t) * 1e-6;
+	r.blocks = blocks.size() / HX711_LOG_BLOCK;
+	r.bytesPerSample = (double)blocks.size() / s.size();
+	r.interval = (double)(s.back().ts - s.front().ts) / (s.size() - 1);
+
+	std::vector<int32_t> raw(2048);
+	std::vector<uint32_t> ts(2048);
+	std::vector<Sample> out;
+	t = seconds();
+	for (size_t i = 0; i < reps; i++)
+	{
+		out.clear();
+		for (size_t b = 0; b < r.blocks; b++)
+		{
+			uint16_t n = HX711_LogCodec::decode(&blocks[b * HX711_LOG_BLOCK], raw.data(), ts.data(), raw.size());
+			for (uint16_t k = 0; k < n; k++) out.push_back({ raw[k], ts[k] });
+		}
+	}
+	r.decMsps = reps * s.size() / (seconds() - t) * 1e-6;
+	r.exact = out.size() == s.size();
+	for (size_t i = 0; r.exact && i < s.size(); i++)
+	{
+		r.exact = out[i].raw == s[i].raw;
+		r.tsErr = fmax(r.tsErr, fabs((double)(int32_t)(out[i].ts - s[i].ts)));
+	}
+	return r;
+}
+
+/**
+ * Every block with one flipped bit, at a few places, must be rejected
+ */
+static bool rejectsCorruption(const std::vector<Sample> &s)
+{
+	std::vector<uint8_t> blocks;
+	encode(LOG_CODING::RICE, s, blocks);
+	int32_t raw[2048];
+	for (size_t b = 0; b < blocks.size(); b += HX711_LOG_BLOCK)
+	{
+		for (uint16_t bit : { 17, 100, 777, 2040 })
+		{
+			std::vector<uint8_t> block(blocks.begin() + b, blocks.begin() + b + HX711_LOG_BLOCK);
+			block[bit >> 3] ^= 1 << (bit & 7);
+			if (HX711_LogCodec::decode(block.data(), raw, nullptr, 2048) != 0) return false;
+		}
+	}
+	return true;
+}
+
+static bool load(const char *file, std::vector<Sample> &s)
+{
+	FILE *f = fopen(file, "r");
+	if (!f) return false;
+	unsigned long ts;
+	long raw;
+	while (fscanf(f, "%lu %ld", &ts, &raw) == 2) s.push_back({ (int32_t)raw, (uint32_t)ts });
+	fclose(f);
+	return s.size() > 1;
+}
+
+int main(int argc, char *argv[])
+{
+	cell.seed(47);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+
+	std::vector<Trace> traces = { { "quiet10", {} }, { "busy80", {} }, { "lossy80", {} } };
+	cell.setNoise(0.02);
+	cell.step(SimCore::now() * 1e-9, 200.0);
+	acquire(traces[0].s);
+
+	hx711.setRate(80);
+	cell.setNoise(0.2);
+	cell.setVibration(0.3, 7.0);
+	double t0 = SimCore::now() * 1e-9;
+	for (double t = t0 + 7.0; t < t0 + DURATION; t += 45.0)
+	{
+		cell.step(t, 900.0 * fmod(t * 0.37, 1.0));
+		cell.ramp(t + 20.0, t + 32.0, 50.0);
+	}
+	acquire(traces[1].s);
+	for (size_t i = 0; i < traces[1].s.size(); i++) if (i % 300 != 299) traces[2].s.push_back(traces[1].s[i]);
+	if (argc > 1)
+	{
+		traces.push_back({ "recorded", {} });
+		if (!load(argv[1], traces.back().s))
+		{
+			printf("cannot read %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	const char *coding[] = { "varint", "rice" };
+	bool ok = rejectsCorruption(traces[1].s);
+	printf("block_bytes            = %u\n", HX711_LOG_BLOCK);
+	printf("codec_bytes            = %u\n", (unsigned)sizeof(HX711_LogCodec));
+	printf("corrupt_rejected       = %s\n", ok ? "yes" : "no");
+	for (const Trace &tr : traces)
+	{
+		Result r[2] = { run(LOG_CODING::VARINT, tr.s), run(LOG_CODING::RICE, tr.s) };
+		char key[32];
+		snprintf(key, sizeof(key), "%s.samples", tr.name);
+		printf("%-22s = %lu, %.1f SPS\n", key, (unsigned long)tr.s.size(), 1e6 / r[0].interval);
+		for (int c = 0; c < 2; c++)
+		{
+			snprintf(key, sizeof(key), "%s.%s", tr.name, coding[c]);
+			printf("%-22s = %.3f B/sample, ratio %.2f, %lu blocks, hours_2MB %.1f\n", key, r[c].bytesPerSample,
+				8.0 / r[c].bytesPerSample, (unsigned long)r[c].blocks, FS_BYTES / r[c].bytesPerSample * r[c].interval * 1e-6 / 3600.0);
+			snprintf(key, sizeof(key), "%s.%s.Msps", tr.name, coding[c]);
+			printf("%-22s = enc %.1f, dec %.1f\n", key, r[c].encMsps, r[c].decMsps);
+			snprintf(key, sizeof(key), "%s.%s.check", tr.name, coding[c]);
+			printf("%-22s = %s, max ts err %.0f us\n", key, r[c].exact ? "exact" : "DIFFERS", r[c].tsErr);
+			ok = ok && r[c].exact && r[c].tsErr <= r[c].interval / 4;
+		}
+		ok = ok && r[1].blocks <= r[0].blocks && 8.0 / r[1].bytesPerSample >= 4.0;
+	}
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
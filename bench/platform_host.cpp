@@ -0,0 +1,157 @@
+/**
+ * Program      platform_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Checks LoadCellPlatform on the host against four simulated
+ *              HX711 on a common PD_SCK line. The cells of a 400 x 300 mm
+ *              platform differ in sensitivity by up to 4 %. After tare and
+ *              a shift test with 2 kg near each corner, loads of 0.5 to 4 kg
+ *              are placed at random positions; total weight and center of
+ *              gravity are compared to the truth, with the corrected gains
+ *              and with the nominal gain for every cell. Also checks that
+ *              the calibration survives store() / restore().
+ *              Exit code 1 if the corrected error exceeds 2 g or 2 mm.
+ *
+ * Usage        pio run -e native_platform
+ *              .pio/build/native_platform/program
+ */
+#include <Arduino.h>
+#include <chrono>
+#include "LoadCellPlatform.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_PD_SCK = 2;
+constexpr uint8_t PINS_DOUT[] = { 3, 4, 5, 6 };
+constexpr double  LENGTH = 400.0, WIDTH = 300.0;     // [mm]
+constexpr int16_t POS[4][2] = { { 0, 0 }, { 400, 0 }, { 0, 300 }, { 400, 300 } };
+
+static SimHX711 hx711[4] = { { 3, PIN_PD_SCK }, { 4, PIN_PD_SCK }, { 5, PIN_PD_SCK }, { 6, PIN_PD_SCK } };
+static SimLoadCell cell[4] =
+{
+	{ 5000.0, 1.92, 5.0, 0.0010 }, { 5000.0, 2.00, 5.0, -0.0004 },
+	{ 5000.0, 2.07, 5.0, 0.0007 }, { 5000.0, 1.97, 5.0, 0.0002 },
+};
+static LoadCellPlatform platform(PINS_DOUT, 4, PIN_PD_SCK);
+
+// the load on the platform, shared by the cells of a rigid plate
+static double loadG = 0.0, loadX = 0.0, loadY = 0.0;
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static double share(int j)
+{
+	double u = loadX / LENGTH, v = loadY / WIDTH;
+	return (POS[j][0] ? u : 1.0 - u) * (POS[j][1] ? v : 1.0 - v);
+}
+
+static void place(double grams, double x, double y)
+{
+	loadG = grams; loadX = x; loadY = y;
+	delay(500);					// skip the conversions in progress
+}
+
+static uint32_t lcg = 12345;
+static double random01()
+{
+	lcg = lcg * 1664525UL + 1013904223UL;
+	return (lcg >> 8) / 16777216.0;
+}
+
+int main()
+{
+	for (int j = 0; j < 4; j++)
+	{
+		cell[j].seed(j + 1);
+		cell[j].setNoise(0.5);
+		hx711[j].setInput([j](char chn, uint64_t)
+		{
+			return chn == 'A' ? cell[j].volts(0) + cell[j].gramsToVolts(loadG * share(j)) : 0.0;
+		});
+		SimCore::attach(&hx711[j]);
+		platform.set_position(j, POS[j][0], POS[j][1]);
+	}
+	platform.begin();
+
+	place(0, 0, 0);
+	platform.tare(16);
+	const double inset = 50.0;
+	const double corners[4][2] = { { inset, inset }, { LENGTH - inset, inset }, { inset, WIDTH - inset }, { LENGTH - inset, WIDTH - inset } };
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		place(2000.0, corners[i][0], corners[i][1]);
+		platform.shiftTest(i, 16);
+	}
+	bool calibrated = platform.calibrate(2000.0f);
+
+	// nominal gain: the mean of the corrected ones, as if the cells were equal
+	LoadCellPlatform nominal(PINS_DOUT, 4, PIN_PD_SCK);
+	float mean = 0.0f;
+	for (uint8_t j = 0; j < 4; j++) mean += platform.get_gain(j) / 4.0f;
+	for (uint8_t j = 0; j < 4; j++)
+	{
+		nominal.set_gain(j, mean);
+		nominal.set_position(j, POS[j][0], POS[j][1]);
+	}
+
+	double errMax = 0.0, cogMax = 0.0, nomErrMax = 0.0, nomCogMax = 0.0;
+	const int trials = 40;
+	for (int k = 0; k < trials; k++)
+	{
+		double g = 500.0 + 3500.0 * random01();
+		double x = LENGTH * random01(), y = WIDTH * random01();
+		place(g, x, y);
+		int32_t raw[4], tared[4];
+		platform.getAverage(raw, 8);
+		PlatformReading r = platform.process(raw);
+		for (uint8_t j = 0; j < 4; j++) tared[j] = raw[j] - platform.get_zero(j);
+		PlatformReading n = nominal.process(tared);
+		errMax    = fmax(errMax, fabs(r.total - g));
+		cogMax    = fmax(cogMax, hypot(r.x - x, r.y - y));
+		nomErrMax = fmax(nomErrMax, fabs(n.total - g));
+		nomCogMax = fmax(nomCogMax, hypot(n.x - x, n.y - y));
+	}
+
+	// persistence
+	platform.store(0);
+	LoadCellPlatform restored(PINS_DOUT, 4, PIN_PD_SCK);
+	bool same = restored.restore(0);
+	for (uint8_t j = 0; j < 4; j++)
+		same = same && restored.get_gain(j) == platform.get_gain(j) && restored.get_zero(j) == platform.get_zero(j);
+
+	// cost of one readout of all cells (virtual Uno time) and of process() (host)
+	int32_t raw[4];
+	while (hx711[3].pinRead(PINS_DOUT[3], SimCore::now()) == HIGH) SimCore::advance(10000);
+	uint64_t v0 = SimCore::now();
+	platform.read(raw);
+	double readUs = (SimCore::now() - v0) / 1e3;
+	auto h0 = std::chrono::steady_clock::now();
+	volatile float sink = 0.0f;
+	const int calls = 1000000;
+	for (int i = 0; i < calls; i++)
+	{
+		raw[i & 3] += 1;
+		sink = sink + platform.process(raw).total;
+	}
+	double processNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - h0).count() / calls;
+
+	printf("cells              = 4\n");
+	printf("calibrated         = %d\n", calibrated);
+	for (uint8_t j = 0; j < 4; j++)
+		printf("gain_%u             = %.7f g/digit\n", j, platform.get_gain(j));
+	printf("trials             = %d\n", trials);
+	printf("err_max_g          = %.2f\n", errMax);
+	printf("cog_err_max_mm     = %.2f\n", cogMax);
+	printf("nominal_err_max_g  = %.2f\n", nomErrMax);
+	printf("nominal_cog_max_mm = %.2f\n", nomCogMax);
+	printf("max_skew_us        = %lu\n", (unsigned long)platform.get_maxSkew());
+	printf("syncs              = %u\n", platform.get_syncs());
+	printf("readout_us         = %.1f\n", readUs);
+	printf("process_host_ns    = %.1f\n", processNs);
+	printf("persisted          = %d\n", same);
+	bool ok = calibrated && same && errMax <= 2.0 && cogMax <= 2.0;
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
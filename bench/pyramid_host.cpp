@@ -0,0 +1,327 @@
+/**
+ * Program      pyramid_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Trend views from HX711_Pyramid against scans of the samples.
+ *              First a small capture is written in three sessions with a 2
+ *              hour gap, flushed in between; every level is compared to
+ *              buckets computed from the samples in memory, after each
+ *              flush and at the end. A capture without pyramid files, as
+ *              written before there were pyramids, must open for reading
+ *              and render nothing; opened for writing it gets its pyramid
+ *              from the blocks, which must then cover every sample.
+ *              Then a month at 80 SPS (207 million
+ *              samples, a gap of 10 minutes every 2^20) is written through
+ *              HX711_CaptureWriter, and the pyramid alone is built again
+ *              from the same samples to time its share. 1000 random views
+ *              per span of 1 h .. 1 month are rendered with up to 1000
+ *              points; some of each span are computed again by reading
+ *              the samples of the range from the capture and bucketing
+ *              them like the level render() chose.
+ *              Exit code 1 if a bucket differs, a view has more than 1000
+ *              points or the 99th percentile of render() takes more than
+ *              1 ms.
+ *
+ * Usage        pio run -e native_pyramid
+ *              .pio/build/native_pyramid/program [samples] [dir]
+ *              the capture takes 8 bytes per sample in dir (/tmp)
+ */
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "HX711_CaptureFile.h"
+
+constexpr int64_t  T0 = 1767225600000000LL;                      // 2026-01-01 [us]
+constexpr int64_t  INTERVAL = 12500, GAP = 600000000LL;          // [us]
+constexpr uint64_t GAP_EVERY = 1 << 20;
+constexpr size_t   POINTS = 1000;
+
+static double seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t lcg = 50;
+static uint32_t random32()
+{
+	lcg = lcg * 1664525UL + 1013904223UL;
+	return lcg;
+}
+
+static void removeCapture(const std::string &base)
+{
+	unlink((base + ".hxd").c_str());
+	unlink((base + ".hxi").c_str());
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++) unlink((base + ".p" + std::to_string(k)).c_str());
+}
+
+static bool same(const HX711_Bucket &a, const HX711_Bucket &b)
+{
+	return a.start == b.start && a.count == b.count && a.sum == b.sum && a.min == b.min && a.max == b.max;
+}
+
+/**
+ * Buckets of the level from samples, the brute force
+ */
+static void bucketize(const int64_t *us, const int32_t *v, size_t n, uint8_t level, std::vector<HX711_Bucket> &out)
+{
+	int64_t w = HX711_Pyramid::width(level);
+	for (size_t i = 0; i < n; i++)
+	{
+		int64_t start = us[i] / w * w;
+		if (out.empty() || out.back().start != start) out.push_back({ start, 0, v[i], v[i], 0, 0 });
+		HX711_Bucket &b = out.back();
+		b.count++;
+		b.sum += v[i];
+		b.min = std::min(b.min, v[i]);
+		b.max = std::max(b.max, v[i]);
+	}
+}
+
+/**
+ * Every level of the pyramid, windows continued after a reopen merged
+ */
+static bool sameLevels(HX711_PyramidReader &p, const std::vector<int64_t> &t, const std::vector<int32_t> &v, size_t n)
+{
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		std::vector<HX711_Bucket> ref, got;
+		bucketize(t.data(), v.data(), n, k, ref);
+		const HX711_Bucket *b = p.getLevel(k);
+		for (uint64_t i = 0; i < p.getBuckets(k); i++)
+		{
+			if (!got.empty() && got.back().start == b[i].start)
+			{
+				HX711_Bucket &g = got.back();
+				g.count += b[i].count;
+				g.sum += b[i].sum;
+				g.min = std::min(g.min, b[i].min);
+				g.max = std::max(g.max, b[i].max);
+			}
+			else got.push_back(b[i]);
+		}
+		if (got.size() != ref.size()) return false;
+		for (size_t i = 0; i < ref.size(); i++) if (!same(got[i], ref[i])) return false;
+	}
+	return true;
+}
+
+static bool checkSessions(const std::string &base)
+{
+	removeCapture(base);
+	std::vector<int64_t> t;
+	std::vector<int32_t> v;
+	for (int i = 0; i < 300000; i++)
+	{
+		t.push_back(T0 + i * INTERVAL * (i % 7 == 0 ? 3 : 1) / 2 + (i >= 180000 ? 7200000000LL : 0));
+		v.push_back((int32_t)(random32() >> 8) - 8000000);
+	}
+	for (size_t i = 1; i < t.size(); i++) t[i] = std::max(t[i], t[i - 1]);
+	HX711_CaptureReader reader;
+	bool ok = true;
+	size_t cut[] = { 0, 123457, 180000, 300000 };
+	for (int s = 0; s < 3 && ok; s++)
+	{
+		HX711_CaptureWriter writer;
+		ok = writer.open(base.c_str());
+		size_t mid = (cut[s] + cut[s + 1]) / 2;
+		for (size_t i = cut[s]; i < mid; i++) writer.append(t[i], v[i]);
+		writer.flush();
+		ok = ok && (s == 0 ? reader.open(base.c_str()) : reader.refresh()) && sameLevels(reader.getPyramid(), t, v, mid);
+		for (size_t i = mid; i < cut[s + 1]; i++) writer.append(t[i], v[i]);
+		writer.flush();
+		ok = ok && reader.refresh() && sameLevels(reader.getPyramid(), t, v, cut[s + 1]);
+		writer.close();
+		ok = ok && reader.refresh() && sameLevels(reader.getPyramid(), t, v, cut[s + 1]);
+	}
+	reader.close();
+	removeCapture(base);
+	return ok;
+}
+
+static bool checkWithout(const std::string &base)
+{
+	removeCapture(base);
+	std::vector<int64_t> t;
+	std::vector<int32_t> v;
+	for (int i = 0; i < 10100; i++)
+	{
+		t.push_back(T0 + i * INTERVAL);
+		v.push_back((int32_t)(random32() >> 8) - 8000000);
+	}
+	HX711_CaptureWriter writer(1000);              // ten blocks and a partial one
+	bool ok = writer.open(base.c_str());
+	for (int i = 0; i < 10000; i++) writer.append(t[i], v[i]);
+	writer.close();
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++) unlink((base + ".p" + std::to_string(k)).c_str());
+
+	HX711_CaptureReader reader;
+	HX711_Bucket b[16];
+	ok = ok && reader.open(base.c_str()) && !reader.hasPyramid() && reader.getSamples() == 10000
+		&& reader.render(t[0], t[9999] + 1, POINTS, b, 16) == 0;
+	ok = ok && writer.open(base.c_str());
+	for (int i = 10000; i < 10100; i++) writer.append(t[i], v[i]);
+	writer.flush();
+	ok = ok && reader.refresh() && reader.hasPyramid() && sameLevels(reader.getPyramid(), t, v, t.size());
+	writer.close();
+	reader.close();
+	removeCapture(base);
+	return ok;
+}
+
+static int32_t weight(int64_t us)
+{
+	double day = (us - T0) * (2.0 * M_PI / 86400e6);
+	return (int32_t)(200000.0 + 100000.0 * sin(day)) + (int32_t)(random32() >> 22) - 512;
+}
+
+/**
+ * The view without a pyramid: the samples of the whole windows from the
+ * capture, bucketed
+ */
+static void scan(HX711_CaptureReader &r, int64_t from, int64_t to, uint8_t level, std::vector<HX711_Bucket> &out)
+{
+	static std::vector<int64_t> us(1 << 20);
+	static std::vector<int32_t> v(1 << 20);
+	int64_t w = HX711_Pyramid::width(level);
+	from = from / w * w;
+	to = (to - 1) / w * w + w;
+	out.clear();
+	while (from < to)
+	{
+		size_t n = r.read(from, to, us.data(), v.data(), us.size());
+		if (n == 0) break;
+		bucketize(us.data(), v.data(), n, level, out);
+		from = us[n - 1] + 1;
+	}
+	// a window split between two reads
+	for (size_t i = 1; i < out.size(); i++)
+	{
+		if (out[i].start != out[i - 1].start) continue;
+		out[i - 1].count += out[i].count;
+		out[i - 1].sum += out[i].sum;
+		out[i - 1].min = std::min(out[i - 1].min, out[i].min);
+		out[i - 1].max = std::max(out[i - 1].max, out[i].max);
+		out.erase(out.begin() + i--);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t samples = argc > 1 ? strtoull(argv[1], nullptr, 10) : 80ULL * 86400 * 30;
+	std::string base = std::string(argc > 2 ? argv[2] : "/tmp") + "/pyramid_host";
+	bool ok = checkSessions(base + "_small");
+	printf("sessions_check         = %s\n", ok ? "ok" : "FAILED");
+	bool without = checkWithout(base + "_old");
+	printf("no_pyramid_check       = %s\n", without ? "ok" : "FAILED");
+	ok = ok && without;
+
+	removeCapture(base);
+	HX711_CaptureWriter writer;
+	if (!writer.open(base.c_str()))
+	{
+		printf("cannot open %s\n", base.c_str());
+		return 1;
+	}
+	double t = seconds();
+	int64_t us = T0;
+	for (uint64_t i = 0; i < samples; i++)
+	{
+		writer.append(us, weight(us));
+		us += INTERVAL + ((i + 1) % GAP_EVERY == 0 ? GAP : 0);
+	}
+	writer.close();
+	double writeS = seconds() - t;
+
+	// the pyramid alone, same samples
+	lcg = 50;
+	HX711_Pyramid alone;
+	std::string aloneBase = base + "_alone";
+	alone.open(aloneBase.c_str());
+	t = seconds();
+	us = T0;
+	for (uint64_t i = 0; i < samples; i++)
+	{
+		alone.append(us, weight(us));
+		us += INTERVAL + ((i + 1) % GAP_EVERY == 0 ? GAP : 0);
+	}
+	alone.close();
+	double aloneS = seconds() - t;
+	lcg = 50;
+	t = seconds();
+	int64_t sink = 0;
+	us = T0;
+	for (uint64_t i = 0; i < samples; i++)
+	{
+		sink += weight(us);
+		us += INTERVAL + ((i + 1) % GAP_EVERY == 0 ? GAP : 0);
+	}
+	double genS = seconds() - t;
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++) unlink((aloneBase + ".p" + std::to_string(k)).c_str());
+
+	HX711_CaptureReader reader;
+	ok = ok && reader.open(base.c_str()) && reader.getSamples() == samples;
+	HX711_PyramidReader &pyramid = reader.getPyramid();
+	uint64_t buckets = 0;
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++) buckets += pyramid.getBuckets(k);
+	printf("samples                = %llu, %.1f days%s\n", (unsigned long long)reader.getSamples(),
+		(reader.getLast() - reader.getFirst()) / 86400e6, sink ? "" : " ");
+	printf("pyramid_buckets        = %llu, level 0 %llu\n", (unsigned long long)buckets, (unsigned long long)pyramid.getBuckets(0));
+	printf("pyramid_bytes_per_smp  = %.3f (capture 8 + %.3f index)\n", (double)buckets * sizeof(HX711_Bucket) / samples,
+		(double)sizeof(HX711_CaptureEntry) * reader.getBlocks() / samples);
+	printf("write_Msps             = %.1f (%.1f s)\n", samples / writeS * 1e-6, writeS);
+	printf("build_ns_per_sample    = %.2f (%.1f s)\n", (aloneS - genS) / samples * 1e9, aloneS - genS);
+
+	struct Span { const char *name; int64_t us; int queries, scans; };
+	const Span spans[] = { { "1h", 3600000000LL, 1000, 5 }, { "1d", 86400000000LL, 1000, 3 },
+		{ "1w", 604800000000LL, 1000, 2 }, { "all", 0, 1000, 1 } };
+	int64_t first = reader.getFirst(), last = reader.getLast() + 1;
+	std::vector<HX711_Bucket> view(POINTS), ref;
+	for (const Span &s : spans)
+	{
+		int64_t span = s.us ? std::min(s.us, last - first) : last - first;
+		std::vector<double> lat;
+		double scanS = 0.0, points = 0.0, level = 0.0;
+		size_t most = 0;
+		int wrong = 0;
+		for (int q = 0; q < s.queries; q++)
+		{
+			int64_t from = first + (int64_t)((last - first - span) * (random32() / 4294967296.0));
+			uint8_t k;
+			t = seconds();
+			size_t n = reader.render(from, from + span, POINTS, view.data(), view.size(), &k);
+			lat.push_back((seconds() - t) * 1e6);
+			points += n;
+			level += k;
+			most = std::max(most, n);
+			if (q < s.scans)
+			{
+				t = seconds();
+				scan(reader, from, from + span, k, ref);
+				scanS += seconds() - t;
+				bool equal = ref.size() == n;
+				for (size_t i = 0; equal && i < n; i++) equal = same(view[i], ref[i]);
+				if (!equal) wrong++;
+			}
+		}
+		std::sort(lat.begin(), lat.end());
+		double mean = 0.0;
+		for (double l : lat) mean += l / lat.size();
+		double p99 = lat[lat.size() * 99 / 100];
+		char key[32];
+		snprintf(key, sizeof(key), "render_%s_us", s.name);
+		printf("%-22s = mean %.1f, p99 %.1f (%.0f points, level %.1f)\n", key, mean, p99, points / s.queries, level / s.queries);
+		snprintf(key, sizeof(key), "scan_%s_ms", s.name);
+		printf("%-22s = %.1f, %d of %d differ\n", key, scanS * 1e3 / s.scans, wrong, s.scans);
+		ok = ok && wrong == 0 && most <= POINTS && p99 <= 1000.0;
+	}
+	reader.close();
+	removeCapture(base);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
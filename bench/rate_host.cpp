@@ -0,0 +1,152 @@
+/**
+ * Program      rate_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Validates HX711_Rate against ramp profiles on the host.
+ *              A simulated cell with 0.2 g noise is loaded and unloaded by
+ *              ramps of 5 to 100 g/s at 10 and 80 SPS. Every estimate made
+ *              while the window lies entirely on a ramp is compared to the
+ *              true rate; it should be within two standard errors in about
+ *              95 % of the cases. For comparison the rate from the
+ *              difference of two successive samples. A binary frame is 
+ *              written after every sample and decoded again.
+ *              Exit code 1 if the rms error exceeds the mean standard error
+ *              by more than 25 %, the 2-sigma coverage is below 85 % or a 
+ *              frame does not carry the estimate.
+ *
+ * Usage        pio run -e native_rate
+ *              .pio/build/native_rate/program
+ */
+#include <Arduino.h>
+#include <vector>
+#include "HX711_Rate.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+
+static SimHX711    hx711(PIN_DOUT, PIN_PD_SCK);
+static SimLoadCell cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR   scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Rate  rate(scale, 16);
+
+static std::vector<uint8_t> out;
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+struct Result { uint8_t sps; double gps; uint32_t n; double rms, relRms, cover, naiveRms, sigma; uint32_t frames, badFrames; };
+
+static uint16_t crc16(const uint8_t *p, int n)
+{
+	uint16_t crc = 0xFFFF;
+	while (n--)
+	{
+		crc ^= (uint16_t)*p++ << 8;
+		for (int k = 0; k < 8; k++) crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * The frame written for the last sample must carry exactly the estimate
+ */
+static bool checkFrame(uint32_t timestamp)
+{
+	if (out.size() != 16 || out[0] != 0xA8) return false;
+	uint32_t ms;
+	float    v[2];
+	uint16_t crc;
+	memcpy(&ms, &out[2], 4);
+	memcpy(v, &out[6], 8);
+	memcpy(&crc, &out[14], 2);
+	return crc == crc16(out.data(), 14) && ms == timestamp / 1000 && 
+		(out[1] < 3 || (v[0] == rate.getRate() && v[1] == rate.getUncertainty()));
+}
+
+static Result ramp(uint8_t sps, double gps)
+{
+	Result r = { sps, gps, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0 };
+	hx711.setRate(sps);
+	double t0 = SimCore::now() * 1e-9 + 1.0;
+	double dur = 400.0 / fabs(gps);			// 400 g between 100 and 500 g
+	cell.step(t0 - 1.0, gps > 0 ? 100.0 : 500.0);
+	cell.ramp(t0, t0 + dur, gps > 0 ? 500.0 : 100.0);
+	double span = 17.0 / sps;					// a window and a bit
+	rate.reset();
+	double lastW = 0.0, lastT = 0.0;
+	uint32_t inside = 0;
+	double sumSq = 0.0, naiveSq = 0.0, sumSigma = 0.0;
+	while (SimCore::now() * 1e-9 < t0 + dur + 1.0)
+	{
+		if (!scale.isReady()) 
+		{
+			SimCore::advance(100000);
+			continue;
+		}
+		int32_t v = scale.getRawValue();
+		rate.add(v, scale.get_timestamp());
+		out.clear();
+		rate.writeFrame();
+		r.frames++;
+		if (!checkFrame(scale.get_timestamp())) r.badFrames++;
+		double t = scale.get_timestamp() * 1e-6;
+		double w = scale.get_m() * v + scale.get_b();
+		double naive = (w - lastW) / (t - lastT);
+		lastW = w; lastT = t;
+		double now = SimCore::now() * 1e-9;
+		if (now < t0 + span || now > t0 + dur) continue;
+		double e = rate.getRate() - gps;
+		sumSq += e * e;
+		naiveSq += (naive - gps) * (naive - gps);
+		sumSigma += rate.getUncertainty();
+		if (fabs(e) <= 2.0 * rate.getUncertainty()) inside++;
+		r.n++;
+	}
+	r.rms = sqrt(sumSq / r.n);
+	r.relRms = r.rms / fabs(gps);
+	r.cover = (double)inside / r.n;
+	r.naiveRms = sqrt(naiveSq / r.n);
+	r.sigma = sumSigma / r.n;
+	return r;
+}
+
+int main()
+{
+	Serial.begin(115200);
+	Serial.setEcho(nullptr);
+	Serial.setSink([](uint8_t c, uint64_t) { out.push_back(c); });
+	cell.seed(5);
+	cell.setNoise(0.2);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+
+	Result res[] = 
+	{ 
+		ramp(10, 5.0), ramp(10, -20.0), ramp(10, 100.0),
+		ramp(80, 5.0), ramp(80, -20.0), ramp(80, 100.0),
+	};
+	bool ok = true;
+	printf("window             = 16\n");
+	printf("noise_g            = 0.2\n");
+	for (const Result &r : res)
+	{
+		char key[24];
+		snprintf(key, sizeof(key), "%usps_%+.0fgps", r.sps, r.gps);
+		printf("%s.estimates   = %lu\n", key, (unsigned long)r.n);
+		printf("%s.rms_gps     = %.3f\n", key, r.rms);
+		printf("%s.rel_rms     = %.2f%%\n", key, 100.0 * r.relRms);
+		printf("%s.sigma_gps   = %.3f\n", key, r.sigma);
+		printf("%s.cover_2s    = %.1f%%\n", key, 100.0 * r.cover);
+		printf("%s.naive_rms   = %.3f\n", key, r.naiveRms);
+		printf("%s.bad_frames  = %lu of %lu\n", key, (unsigned long)r.badFrames, (unsigned long)r.frames);
+		ok = ok && r.rms <= 1.25 * r.sigma && r.cover >= 0.85 && r.badFrames == 0;
+	}
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
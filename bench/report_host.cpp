@@ -0,0 +1,166 @@
+/**
+ * Program      report_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Serial traffic of HX711_Reporter over one simulated hour at
+ *              10 SPS, 0.2 g noise and 1 g/h drift. Every 6 minutes an item
+ *              of 100 to 800 g is put on, 15 s later 200 g are filled in
+ *              over 10 s, 15 s later all is taken off; the scale is idle
+ *              90 % of the time. Three policies run side by side on the
+ *              same samples, every report is sent as text line and as
+ *              binary frame and the bytes are counted:
+ *                every      deadband 0, every sample
+ *                db0.5      deadband 0.5 g, heartbeat 10 s
+ *                db2        deadband 2 g, heartbeat 60 s
+ *              While the load has not changed for 3 s, settled_text_b
+ *              counts the text bytes sent and settled_err is the largest
+ *              difference between the last report and the latest sample
+ *              (the mean of 8 like every report).
+ *              Exit code 1 if a change-only policy sends more than 5 % of
+ *              the bytes of every sample, if its settled error exceeds the
+ *              deadband by more than 0.3 g, if a settled load is not
+ *              reported as stable or a heartbeat comes late.
+ *
+ * Usage        pio run -e native_report
+ *              .pio/build/native_report/program
+ */
+#include <Arduino.h>
+#include "HX711_Reporter.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr int     CYCLES = 10;
+constexpr double  PERIOD = 360.0, HOUR = CYCLES * PERIOD;          // [s]
+
+static SimHX711    hx711(PIN_DOUT, PIN_PD_SCK, 10);
+static SimLoadCell cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR   scale(PIN_DOUT, PIN_PD_SCK, 1000);
+
+struct Policy
+{
+	const char *name;
+	float    deadband;
+	uint16_t heartbeat;
+	HX711_Reporter reporter;
+	uint32_t textBytes, frameBytes, quietBytes, reports, stableReports;
+	double   lastWeight, settledErr;
+	uint32_t lastAt, maxGap;
+};
+
+static Policy policies[] =
+{
+	{ "every", 0.0f,  0, HX711_Reporter(scale), 0, 0, 0, 0, 0, 0.0, 0.0, 0, 0 },
+	{ "db0.5", 0.5f, 10, HX711_Reporter(scale), 0, 0, 0, 0, 0, 0.0, 0.0, 0, 0 },
+	{ "db2",   2.0f, 60, HX711_Reporter(scale), 0, 0, 0, 0, 0, 0.0, 0.0, 0, 0 },
+};
+static uint32_t serialBytes = 0;
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	for (Policy &p : policies) p.reporter.onSample(raw, timestamp);
+}
+
+static uint32_t lcg = 45;
+static double random01()
+{
+	lcg = lcg * 1664525UL + 1013904223UL;
+	return (lcg >> 8) / 16777216.0;
+}
+
+int main()
+{
+	Serial.begin(115200);
+	Serial.setEcho(nullptr);
+	Serial.setSink([](uint8_t, uint64_t) { serialBytes++; });
+	cell.seed(45);
+	cell.setNoise(0.2);
+	cell.setDrift(1.0);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+
+	// load profile
+	double t0 = SimCore::now() * 1e-9 + 1.0;
+	int settled = 0;
+	for (int k = 0; k < CYCLES; k++)
+	{
+		double t = t0 + k * PERIOD + 60.0, w = 100.0 + 700.0 * random01();
+		cell.step(t, w);
+		cell.ramp(t + 15.0, t + 25.0, w + 200.0);
+		cell.step(t + 40.0, 0.0);
+		settled += 3;
+	}
+	for (Policy &p : policies) p.reporter.start(p.deadband, p.heartbeat);
+
+	while (SimCore::now() * 1e-9 < t0 + HOUR)
+	{
+		if (!scale.isReady())
+		{
+			SimCore::advance(1000000);
+			continue;
+		}
+		scale.getRawValue();
+		uint64_t ns = SimCore::now();
+		double w = cell.load(ns);
+		bool quiet = ns > 4000000000ULL && w == cell.load(ns - 1000000000ULL) && w == cell.load(ns - 2000000000ULL)
+			&& w == cell.load(ns - 3000000000ULL);
+		for (Policy &p : policies)
+		{
+			if (quiet && &p != &policies[0]) p.settledErr = fmax(p.settledErr, fabs(p.lastWeight - policies[0].lastWeight));
+			if (p.reporter.available())
+			{
+				HX711_Report r = p.reporter.getReport();
+				uint32_t b0 = serialBytes;
+				p.reporter.printText(r);
+				p.textBytes += serialBytes - b0;
+				if (quiet) p.quietBytes += serialBytes - b0;
+				b0 = serialBytes;
+				p.reporter.writeFrame(r);
+				p.frameBytes += serialBytes - b0;
+				if (p.reports && r.timestamp - p.lastAt > p.maxGap) p.maxGap = r.timestamp - p.lastAt;
+				p.reports++;
+				if ((r.flags & REPORT_STABILITY) && (r.flags & REPORT_STABLE)) p.stableReports++;
+				p.lastWeight = r.weight;
+				p.lastAt = r.timestamp;
+			}
+		}
+	}
+
+	bool ok = true;
+	Policy &every = policies[0];
+	printf("sim_hours              = %.2f\n", HOUR / 3600.0);
+	printf("samples                = %lu\n", (unsigned long)every.reporter.getSamples());
+	printf("settled_levels         = %d\n", settled);
+	printf("object_bytes_host      = %u\n", (unsigned)sizeof(HX711_Reporter));
+	for (const Policy &p : policies)
+	{
+		char key[32];
+		snprintf(key, sizeof(key), "%s.reports", p.name);
+		printf("%-22s = %lu (stable %lu)\n", key, (unsigned long)p.reports, (unsigned long)p.stableReports);
+		snprintf(key, sizeof(key), "%s.text_bytes_h", p.name);
+		printf("%-22s = %lu\n", key, (unsigned long)p.textBytes);
+		snprintf(key, sizeof(key), "%s.settled_text_b", p.name);
+		printf("%-22s = %lu\n", key, (unsigned long)p.quietBytes);
+		snprintf(key, sizeof(key), "%s.frame_bytes_h", p.name);
+		printf("%-22s = %lu\n", key, (unsigned long)p.frameBytes);
+		snprintf(key, sizeof(key), "%s.settled_err_g", p.name);
+		printf("%-22s = %.2f\n", key, p.settledErr);
+		snprintf(key, sizeof(key), "%s.max_gap_s", p.name);
+		printf("%-22s = %.1f\n", key, p.maxGap * 1e-6);
+		if (&p == &every) continue;
+		ok = ok && p.textBytes * 20 <= every.textBytes && p.frameBytes * 20 <= every.frameBytes
+			&& p.settledErr <= p.deadband + 0.3 && p.stableReports >= (uint32_t)settled
+			&& p.maxGap <= p.heartbeat * 1000000UL + 150000UL;
+	}
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/**
+ * Program      scheduler_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Checks HX711_Scheduler on the host when the HX711 goes
+ *              away. One reading of 8 samples every 10 s at 10 SPS with
+ *              a 300 g load; the chip is disconnected while the scheduler
+ *              sleeps (35 s .. 72 s), so four wakes find no conversion,
+ *              and once in the middle of a burst (90.6 s .. 95 s). Around
+ *              the wake due at 20 s loop() is blocked until 20.6 s, longer
+ *              than the settling time, like a menu command.
+ *              Exit code 1 if a wake without conversions is not reported
+ *              as TIMEOUT within settling time + timeout, the chip is left
+ *              powered up after a timeout, a reading on the connected chip
+ *              is not OK or off by more than 1 g, or a reading is missing
+ *              after the chip is back. Both outages end while the scheduler
+ *              sleeps, so the chip must come back powered down. After the
+ *              blocked loop the wake latency must still include the whole
+ *              settling time, and every later reading must come within
+ *              1.3 s of its scheduled wake (no drift).
+ *
+ * Usage        pio run -e native_scheduler
+ *              .pio/build/native_scheduler/program
+ */
+#include <Arduino.h>
+#include "HX711_Scheduler.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t  PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr uint32_t INTERVAL = 10000, SETTLE = 400, TIMEOUT = 1000;  // [ms]
+constexpr double   DURATION = 125.0, LOAD = 300.0;                  // [s], [g]
+constexpr double   BLOCKED_AT = 20.0, BLOCKED_FROM = 19.9, BLOCKED_TO = 20.6;  // [s] loop() does not run
+
+static SimHX711        hx711(PIN_DOUT, PIN_PD_SCK, 10);
+static SimLoadCell     cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR       scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Scheduler lowPower(scale, INTERVAL, 8, SETTLE);
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+struct Outage { double from, to; };
+static const Outage outages[] = { { 35.0, 72.0 }, { 90.6, 95.0 } };
+
+static bool connectedAt(double s)
+{
+	for (const Outage &o : outages) if (s >= o.from && s < o.to) return false;
+	return true;
+}
+
+int main()
+{
+	cell.seed(32);
+	cell.setNoise(0.2);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	cell.step(0.0, LOAD);
+
+	uint32_t ok = 0, timeouts = 0, wrong = 0, leftPowered = 0, lateTimeouts = 0, lateReadings = 0;
+	uint16_t blockedLatency = 0;
+	double maxErr = 0.0, maxTimeoutAfter = 0.0;
+	bool connected = true;
+	uint32_t expectedOk = 0, expectedTimeouts = 0;
+	for (uint32_t k = 0; k * INTERVAL * 1e-3 < DURATION; k++)
+	{
+		// a wake finds the chip, or the burst of 1.2 s after it is cut
+		double wake = k * INTERVAL * 1e-3, end = wake + 1.3;
+		if (connectedAt(wake) && connectedAt(end) && connectedAt(wake + 0.5)) expectedOk++;
+		else expectedTimeouts++;
+	}
+
+	double t0 = SimCore::now() * 1e-9;
+	lowPower.start();
+	while (SimCore::now() * 1e-9 - t0 < DURATION)
+	{
+		double s = SimCore::now() * 1e-9 - t0;
+		if (connected != connectedAt(s))
+		{
+			connected = !connected;
+			hx711.setConnected(connected);
+			if (connected && hx711.isPoweredUp()) leftPowered++;    // PD_SCK must hold it down
+		}
+		if (s >= BLOCKED_FROM && s < BLOCKED_TO)
+		{
+			SimCore::advance(1000000);
+			continue;
+		}
+		if (!lowPower.update())
+		{
+			SimCore::advance(1000000);
+			continue;
+		}
+		// the wake of this cycle
+		double wake = (uint32_t)(s * 1000.0 / INTERVAL) * INTERVAL * 1e-3;
+		if (lowPower.getStatus() == HX711_STATUS::TIMEOUT)
+		{
+			timeouts++;
+			maxTimeoutAfter = fmax(maxTimeoutAfter, s - wake);
+			if (s - wake > (SETTLE + TIMEOUT) * 1e-3 + 1.3) lateTimeouts++;
+			continue;
+		}
+		double err = fabs(lowPower.getWeight() - LOAD);
+		maxErr = fmax(maxErr, err);
+		if (err > 1.0 || !connected) wrong++;
+		if (wake == BLOCKED_AT) blockedLatency = lowPower.getWakeLatency();
+		else if (s - wake > 1.3) lateReadings++;
+		ok++;
+	}
+
+	bool pass = ok == expectedOk && timeouts == expectedTimeouts && wrong == 0 && leftPowered == 0
+		&& lateTimeouts == 0 && lowPower.getTimeouts() == timeouts && blockedLatency >= SETTLE && lateReadings == 0;
+	printf("readings_ok            = %lu of %lu, max err %.2f g\n", (unsigned long)ok, (unsigned long)expectedOk, maxErr);
+	printf("timeouts               = %lu of %lu, latest %.2f s after wake\n", (unsigned long)timeouts,
+		(unsigned long)expectedTimeouts, maxTimeoutAfter);
+	printf("powered_at_reconnect   = %lu\n", (unsigned long)leftPowered);
+	printf("blocked_wake_latency_ms= %u\n", blockedLatency);
+	printf("readings_late          = %lu\n", (unsigned long)lateReadings);
+	printf("duty_cycle             = %.3f\n", lowPower.getDutyCycle());
+	printf("discarded              = %lu\n", (unsigned long)lowPower.getDiscarded());
+	printf("%s\n", pass ? "PASS" : "FAIL");
+	return pass ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/**
+ * Program      stress_snapshot.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Stress test of the seqlock register HX711_Snapshot on the
+ *              host. A producer thread publishes samples as fast as it can,
+ *              the consumer reads them concurrently. All fields of a sample
+ *              are derived from one counter, so a torn read is detected by
+ *              fields which do not belong together, and the counter must
+ *              never go backwards. For comparison the same check runs on
+ *              a plain copy of the data without the seqlock.
+ *              Exit code 1 if a protected read was torn or out of order.
+ *
+ * Usage        pio run -e native_stress
+ *              .pio/build/native_stress/program [seconds]
+ */
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "HX711_GSR.h"
+
+static HX711_Snapshot<HX711_Sample> latest;
+static volatile HX711_Sample plain;     // unprotected, for comparison
+static std::atomic<bool> running{true};
+
+static HX711_Sample make(uint32_t k)
+{
+	return { (int32_t)k, (float)(k & 0xFFFF), k * 100, (HX711_STATUS)(k & 3) };
+}
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static bool consistent(const HX711_Sample &s)
+{
+	uint32_t k = (uint32_t)s.raw;
+	return s.weight == (float)(k & 0xFFFF) && s.timestamp == k * 100 && s.status == (HX711_STATUS)(k & 3);
+}
+
+static void producer(uint32_t *writes)
+{
+	uint32_t k = 0;
+	while (running.load(std::memory_order_relaxed))
+	{
+		HX711_Sample s = make(++k);
+		latest.write(s);
+		plain.raw = s.raw;
+		plain.weight = s.weight;
+		plain.timestamp = s.timestamp;
+		plain.status = s.status;
+	}
+	*writes = k;
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+	uint32_t writes = 0;
+	uint64_t reads = 0, torn = 0, backwards = 0, plainReads = 0, plainTorn = 0;
+	int32_t last = 0;
+
+	std::thread t(producer, &writes);
+	auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			HX711_Sample s = latest.read();
+			reads++;
+			if (! consistent(s)) torn++;
+			if (s.raw < last) backwards++;
+			last = s.raw;
+
+			HX711_Sample p;
+			p.raw = plain.raw;
+			p.weight = plain.weight;
+			p.timestamp = plain.timestamp;
+			p.status = plain.status;
+			plainReads++;
+			if (! consistent(p) && p.raw != 0) plainTorn++;
+		}
+	}
+	running = false;
+	t.join();
+
+	printf("threads            = 2 (%u hardware)\n", std::thread::hardware_concurrency());
+	printf("writes             = %u\n", writes);
+	printf("reads              = %llu\n", (unsigned long long)reads);
+	printf("retries            = %u\n", latest.get_retries());
+	printf("torn               = %llu\n", (unsigned long long)torn);
+	printf("backwards          = %llu\n", (unsigned long long)backwards);
+	printf("plain_torn         = %llu of %llu\n", (unsigned long long)plainTorn, (unsigned long long)plainReads);
+	bool ok = torn == 0 && backwards == 0 && writes > 0;
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/**
+ * Program      summary_host.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Checks HX711_Summary on the host against statistics computed
+ *              in double from the same samples. 80 SPS for 15 minutes, 0.2 g
+ *              noise and 0.3 g vibration, a load that steps and ramps between
+ *              0 and 900 g; windows of 1 s, 10 s, 60 s and 840 s run side by
+ *              side, the last one holds 67200 samples, more than 16 bits.
+ *              Every record is compared to the reference window with the
+ *              same boundaries, the text lines and binary frames are
+ *              counted, every frame is decoded and its CRC checked.
+ *              Exit code 1 if a window is missing, n, min or max differ,
+ *              the mean is off by more than float resolution (1e-6 of the
+ *              value), the standard deviation by more than 0.1 %, or a
+ *              frame is broken.
+ *
+ * Usage        pio run -e native_summary
+ *              .pio/build/native_summary/program
+ */
+#include <Arduino.h>
+#include <algorithm>
+#include <vector>
+#include "HX711_Summary.h"
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+constexpr uint8_t  PIN_DOUT = 3, PIN_PD_SCK = 2;
+constexpr uint32_t PERIODS[] = { 1000, 10000, 60000, 840000 };     // [ms]
+constexpr uint8_t  WINDOWS = sizeof(PERIODS) / sizeof(PERIODS[0]);
+constexpr double   DURATION = 900.0;                                // [s]
+
+static SimHX711      hx711(PIN_DOUT, PIN_PD_SCK, 80);
+static SimLoadCell   cell(1000.0, 2.0, 5.0, 0.001);
+static HX711_GSR     scale(PIN_DOUT, PIN_PD_SCK, 1000);
+static HX711_Summary summary(scale);
+
+struct Ref { uint32_t start; uint32_t n; int32_t min, max; double sum, sumSq; };
+static std::vector<Ref> refs[WINDOWS];
+static std::vector<uint8_t> out;
+static uint32_t samples = 0;
+
+// the shim's simulator is linked too, it is not used here
+void setup() {}
+void loop() {}
+
+static void onSample(int32_t raw, uint32_t timestamp)
+{
+	samples++;
+	summary.onSample(raw, timestamp);
+	for (uint8_t w = 0; w < WINDOWS; w++)
+	{
+		std::vector<Ref> &r = refs[w];
+		uint32_t period = PERIODS[w] * 1000;
+		if (r.empty() || timestamp - r.back().start >= period)
+		{
+			uint32_t start = r.empty() ? timestamp : r.back().start + (timestamp - r.back().start) / period * period;
+			r.push_back({ start, 0, raw, raw, 0.0, 0.0 });
+		}
+		Ref &c = r.back();
+		c.n++;
+		c.min = std::min(c.min, raw);
+		c.max = std::max(c.max, raw);
+		c.sum += raw;
+		c.sumSq += (double)raw * raw;
+	}
+}
+
+static bool close(double a, double b, double abs, double rel)
+{
+	return fabs(a - b) <= abs + rel * fabs(b);
+}
+
+int main()
+{
+	Serial.begin(115200);
+	Serial.setEcho(nullptr);
+	Serial.setSink([](uint8_t c, uint64_t) { out.push_back(c); });
+	cell.seed(46);
+	cell.setNoise(0.2);
+	cell.setVibration(0.3, 7.0);
+	hx711.setInput([](char chn, uint64_t ns) { return chn == 'A' ? cell.volts(ns) : 0.0; });
+	SimCore::attach(&hx711);
+	scale.set_wref(500);
+	scale.set_v0(hx711.toCode(cell.volts(0), 1));
+	scale.set_vref(hx711.toCode(cell.volts(0) + cell.gramsToVolts(500), 1));
+	scale.calculateCoefficients();
+	scale.setSampleHandler(onSample);
+	summary.setRaw(true);
+	for (uint32_t p : PERIODS) summary.add(p);
+
+	double t0 = SimCore::now() * 1e-9 + 0.5;
+	for (double t = t0 + 7.0; t < t0 + DURATION; t += 45.0)
+	{
+		cell.step(t, 900.0 * fmod(t * 0.37, 1.0));
+		cell.ramp(t + 20.0, t + 32.0, 50.0);
+	}
+
+	uint32_t records[WINDOWS] = {}, bad[WINDOWS] = {}, textBytes = 0, frameBytes = 0, frames = 0, broken = 0;
+	double meanErr = 0.0, stdErr = 0.0;
+	while (SimCore::now() * 1e-9 < t0 + DURATION)
+	{
+		if (!scale.isReady())
+		{
+			SimCore::advance(50000);
+			continue;
+		}
+		scale.getRawValue();
+		for (uint8_t w = 0; w < WINDOWS; w++)
+		{
+			if (!summary.available(w)) continue;
+			HX711_Stats s = summary.getStats(w);
+			const Ref &r = refs[w][records[w]++];
+			double mean = r.sum / r.n;
+			double sd = sqrt((r.sumSq - r.sum * mean) / (r.n - 1));
+			meanErr = fmax(meanErr, fabs(s.mean - mean));
+			stdErr = fmax(stdErr, fabs(s.std - sd) / sd);
+			if (s.start != r.start || s.n != r.n || s.min != r.min || s.max != r.max
+				|| !close(s.mean, mean, 0.01, 1e-6) || !close(s.std, sd, 0.0, 1e-3)) bad[w]++;
+
+			out.clear();
+			summary.printText(w, s);
+			textBytes += out.size();
+			out.clear();
+			summary.writeFrame(w, s);
+			frameBytes += out.size();
+			frames++;
+			uint16_t crc = 0xFFFF;
+			for (size_t i = 0; i + 2 < out.size(); i++)
+			{
+				crc ^= (uint16_t)out[i] << 8;
+				for (int k = 0; k < 8; k++) crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+			}
+			float fmean;
+			uint32_t n;
+			memcpy(&fmean, &out[10], 4);
+			memcpy(&n, &out[6], 4);
+			if (out.size() != 28 || out[0] != 0xA6 || out[1] != (0x80 | w) || crc != (uint16_t)(out[26] | out[27] << 8)
+				|| fmean != s.mean || n != s.n) broken++;
+		}
+	}
+
+	bool ok = broken == 0 && summary.getOverruns() == 0;
+	printf("samples                = %lu\n", (unsigned long)samples);
+	printf("window_bytes_host      = %u\n", (unsigned)(sizeof(HX711_Summary) / HX711_SUMMARY_MAX));
+	for (uint8_t w = 0; w < WINDOWS; w++)
+	{
+		char key[32];
+		uint32_t expected = refs[w].size() - 1;          // the last window is still open
+		snprintf(key, sizeof(key), "w%lus.records", (unsigned long)(PERIODS[w] / 1000));
+		printf("%-22s = %lu of %lu, %lu wrong\n", key, (unsigned long)records[w], (unsigned long)expected, (unsigned long)bad[w]);
+		ok = ok && records[w] == expected && bad[w] == 0;
+	}
+	printf("max_mean_err_digits    = %.4f\n", meanErr);
+	printf("max_std_err_rel        = %.2e\n", stdErr);
+	printf("text_bytes             = %lu (every sample as text ~%lu)\n", (unsigned long)textBytes, (unsigned long)samples * 16);
+	printf("frame_bytes            = %lu\n", (unsigned long)frameBytes);
+	printf("frames_broken          = %lu of %lu\n", (unsigned long)broken, (unsigned long)frames);
+	printf("overruns               = %u\n", summary.getOverruns());
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+/**
+ * Class        HX711_CaptureFile.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Block capture files with a memory-mapped index, see
+ *              HX711_CaptureFile.h
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HX711_CaptureFile.h"
+
+static const char MAGIC[4] = { 'H', 'X', 'C', 'I' };
+constexpr uint32_t VERSION    = 1;
+constexpr int64_t  MAX_OFFSET = UINT32_MAX;
+
+static bool readAt(int fd, void *p, size_t n, off_t at)
+{
+	return pread(fd, p, n, at) == (ssize_t)n;
+}
+
+static bool writeAt(int fd, const void *p, size_t n, off_t at)
+{
+	return pwrite(fd, p, n, at) == (ssize_t)n;
+}
+
+static off_t entryAt(uint64_t block)
+{
+	return sizeof(HX711_CaptureHeader) + block * sizeof(HX711_CaptureEntry);
+}
+
+/**
+ * Create <base>.hxd and <base>.hxi or continue them
+ */
+bool HX711_CaptureWriter::open(const char *base)
+{
+	close();
+	std::string b(base);
+	_data = ::open((b + ".hxd").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	_index = ::open((b + ".hxi").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (_data < 0 || _index < 0)
+	{
+		close();
+		return false;
+	}
+	memset(&_entry, 0, sizeof(_entry));
+	_block = 0;
+	_lastUs = INT64_MIN;
+	if (!readAt(_index, &_header, sizeof(_header), 0))
+	{
+		memset(&_header, 0, sizeof(_header));
+		memcpy(_header.magic, MAGIC, 4);
+		_header.version = VERSION;
+		_header.blockSamples = _blockSamples;
+		if (!writeAt(_index, &_header, sizeof(_header), 0))
+		{
+			close();
+			return false;
+		}
+	}
+	else if (memcmp(_header.magic, MAGIC, 4) != 0 || _header.version != VERSION || _header.blockSamples == 0)
+	{
+		close();
+		return false;
+	}
+	_blockSamples = _header.blockSamples;
+	_values.assign(_blockSamples, 0);
+	_offsets.assign(_blockSamples, 0);
+	if (_header.blocks > 0)
+	{
+		HX711_CaptureEntry last;
+		off_t at = (off_t)(_header.blocks - 1) * _blockSamples * 8;
+		if (!readAt(_index, &last, sizeof(last), entryAt(_header.blocks - 1)))
+		{
+			close();
+			return false;
+		}
+		_lastUs = last.last;
+		_block = _header.blocks;
+		if (last.count < _blockSamples && readAt(_data, _values.data(), _blockSamples * 4, at)
+			&& readAt(_data, _offsets.data(), _blockSamples * 4, at + _blockSamples * 4))
+		{
+			_entry = last;                      // continue the partial block
+			_block--;
+		}
+	}
+	_dirty = false;
+	if (!_pyramid.open(base) || (_header.samples > 0 && _pyramid.isEmpty() && !buildPyramid()))
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * The pyramid of a capture written without one, from all its blocks
+ * including the partial last one
+ */
+bool HX711_CaptureWriter::buildPyramid()
+{
+	std::vector<int32_t>  values(_blockSamples);
+	std::vector<uint32_t> offsets(_blockSamples);
+	for (uint64_t k = 0; k < _header.blocks; k++)
+	{
+		HX711_CaptureEntry e;
+		off_t at = (off_t)k * _blockSamples * 8;
+		if (!readAt(_index, &e, sizeof(e), entryAt(k)) || e.count > _blockSamples
+			|| !readAt(_data, values.data(), e.count * 4, at) 
+			|| !readAt(_data, offsets.data(), e.count * 4, at + _blockSamples * 4)) return false;
+		for (uint32_t i = 0; i < e.count; i++) _pyramid.append(e.first + offsets[i], values[i]);
+	}
+	return _pyramid.flush();
+}
+
+/**
+ * One sample, false if it is older than the last one or writing failed
+ */
+bool HX711_CaptureWriter::append(int64_t us, int32_t value)
+{
+	if (_data < 0 || us < _lastUs) return false;
+	if (_entry.count == _blockSamples || (_entry.count > 0 && us - _entry.first > MAX_OFFSET))
+	{
+		if (_dirty && !writeBlock()) return false;
+		_block++;
+		memset(&_entry, 0, sizeof(_entry));
+	}
+	if (_entry.count == 0)
+	{
+		_entry.first = us;
+		_entry.min = _entry.max = value;
+	}
+	_values[_entry.count] = value;
+	_offsets[_entry.count] = (uint32_t)(us - _entry.first);
+	_entry.count++;
+	_entry.last = us;
+	_entry.sum += value;
+	if (value < _entry.min) _entry.min = value;
+	if (value > _entry.max) _entry.max = value;
+	_lastUs = us;
+	_header.samples++;
+	_pyramid.append(us, value);
+	_dirty = true;
+	return true;
+}
+
+/**
+ * Data, entry, then the header that makes them visible
+ */
+bool HX711_CaptureWriter::writeBlock()
+{
+	off_t at = (off_t)_block * _blockSamples * 8;
+	bool ok = writeAt(_data, _values.data(), _blockSamples * 4, at)
+		&& writeAt(_data, _offsets.data(), _blockSamples * 4, at + _blockSamples * 4)
+		&& writeAt(_index, &_entry, sizeof(_entry), entryAt(_block));
+	if (ok && _block + 1 > _header.blocks) _header.blocks = _block + 1;
+	ok = ok && writeAt(_index, &_header, sizeof(_header), 0);
+	_dirty = !ok;
+	return ok;
+}
+
+/**
+ * Write the open block to the page cache, readers see it after refresh()
+ */
+bool HX711_CaptureWriter::flush()
+{
+	return (!_dirty || writeBlock()) && _pyramid.flush();
+}
+
+void HX711_CaptureWriter::close()
+{
+	if (_data >= 0 && _index >= 0 && _dirty) writeBlock();
+	_pyramid.close();
+	if (_data >= 0) ::close(_data);
+	if (_index >= 0) ::close(_index);
+	_data = _index = -1;
+}
+
+bool HX711_CaptureReader::open(const char *base)
+{
+	close();
+	_base = base;
+	_dataFd = ::open((_base + ".hxd").c_str(), O_RDONLY | O_CLOEXEC);
+	_indexFd = ::open((_base + ".hxi").c_str(), O_RDONLY | O_CLOEXEC);
+	if (_dataFd < 0 || _indexFd < 0 || !map())
+	{
+		close();
+		return false;
+	}
+	_pyramid.open(base);                    // optional
+	return true;
+}
+
+/**
+ * Map again what the writer has added since
+ */
+bool HX711_CaptureReader::refresh()
+{
+	if (_dataFd < 0) return false;
+	unmap();
+	if (!map()) return false;
+	if (!_pyramid.isOpen()) _pyramid.open(_base.c_str());	// a writer may have built it since
+	else if (!_pyramid.refresh()) return false;
+	return true;
+}
+
+void HX711_CaptureReader::close()
+{
+	unmap();
+	_pyramid.close();
+	if (_dataFd >= 0) ::close(_dataFd);
+	if (_indexFd >= 0) ::close(_indexFd);
+	_dataFd = _indexFd = -1;
+}
+
+bool HX711_CaptureReader::map()
+{
+	struct stat ds, is;
+	if (fstat(_dataFd, &ds) < 0 || fstat(_indexFd, &is) < 0 || (size_t)is.st_size < sizeof(HX711_CaptureHeader)) return false;
+	_indexSize = is.st_size;
+	void *p = mmap(nullptr, _indexSize, PROT_READ, MAP_SHARED, _indexFd, 0);
+	if (p == MAP_FAILED) return false;
+	_index = (const uint8_t *)p;
+	_header = (const HX711_CaptureHeader *)_index;
+	_entries = (const HX711_CaptureEntry *)(_index + sizeof(HX711_CaptureHeader));
+	_blockSamples = _header->blockSamples;
+	if (memcmp(_header->magic, MAGIC, 4) != 0 || _header->version != VERSION || _blockSamples == 0) return false;
+	_dataSize = ds.st_size;
+	if (_dataSize > 0)
+	{
+		p = mmap(nullptr, _dataSize, PROT_READ, MAP_SHARED, _dataFd, 0);
+		if (p == MAP_FAILED) return false;
+		_data = (const uint8_t *)p;
+		madvise(p, _dataSize, MADV_RANDOM);
+	}
+	// only what is complete in all three
+	_blocks = _header->blocks;
+	uint64_t n = (_indexSize - sizeof(HX711_CaptureHeader)) / sizeof(HX711_CaptureEntry);
+	if (n < _blocks) _blocks = n;
+	n = _dataSize / ((uint64_t)_blockSamples * 8);
+	if (n < _blocks) _blocks = n;
+	return true;
+}
+
+void HX711_CaptureReader::unmap()
+{
+	if (_data) munmap((void *)_data, _dataSize);
+	if (_index) munmap((void *)_index, _indexSize);
+	_data = _index = nullptr;
+	_header = nullptr;
+	_entries = nullptr;
+	_blocks = 0;
+}
+
+/**
+ * First block whose last sample is at or after us, getBlocks() if none
+ */
+size_t HX711_CaptureReader::findBlock(int64_t us)
+{
+	size_t lo = 0, hi = _blocks;
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (_entries[mid].last < us) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/**
+ * Count, sum, min and max of the samples in [from, to)
+ */
+HX711_Aggregate HX711_CaptureReader::aggregate(int64_t from, int64_t to)
+{
+	HX711_Aggregate a = { 0, 0, INT32_MAX, INT32_MIN };
+	for (size_t b = findBlock(from); b < _blocks && _entries[b].first < to; b++)
+	{
+		const HX711_CaptureEntry &e = _entries[b];
+		if (e.first >= from && e.last < to)
+		{
+			a.count += e.count;
+			a.sum += e.sum;
+			if (e.min < a.min) a.min = e.min;
+			if (e.max > a.max) a.max = e.max;
+		}
+		else scan(b, from, to, a);
+	}
+	if (a.count == 0) a.min = a.max = 0;
+	return a;
+}
+
+void HX711_CaptureReader::scan(uint64_t block, int64_t from, int64_t to, HX711_Aggregate &a)
+{
+	const HX711_CaptureEntry &e = _entries[block];
+	const int32_t  *v = (const int32_t *)(_data + block * _blockSamples * 8);
+	const uint32_t *o = (const uint32_t *)(v + _blockSamples);
+	for (uint32_t i = 0; i < e.count; i++)
+	{
+		int64_t t = e.first + o[i];
+		if (t < from) continue;
+		if (t >= to) break;
+		a.count++;
+		a.sum += v[i];
+		if (v[i] < a.min) a.min = v[i];
+		if (v[i] > a.max) a.max = v[i];
+	}
+}
+
+/**
+ * The samples in [from, to), up to max, returns their number
+ */
+size_t HX711_CaptureReader::read(int64_t from, int64_t to, int64_t *us, int32_t *values, size_t max)
+{
+	size_t n = 0;
+	for (size_t b = findBlock(from); b < _blocks && _entries[b].first < to && n < max; b++)
+	{
+		const HX711_CaptureEntry &e = _entries[b];
+		const int32_t  *v = (const int32_t *)(_data + b * _blockSamples * 8);
+		const uint32_t *o = (const uint32_t *)(v + _blockSamples);
+		for (uint32_t i = 0; i < e.count && n < max; i++)
+		{
+			int64_t t = e.first + o[i];
+			if (t < from) continue;
+			if (t >= to) break;
+			us[n] = t;
+			values[n++] = v[i];
+		}
+	}
+	return n;
+}
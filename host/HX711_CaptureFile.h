@@ -0,0 +1,141 @@
+/**
+ * Header       HX711_CaptureFile.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Long recordings of timestamped int32 samples on the host,
+ *              two append-only files:
+ *                <base>.hxd  blocks of HX711_CAPTURE_BLOCK samples, each
+ *                            the values (int32) and then their times as
+ *                            offsets from the first sample [us] (uint32)
+ *                <base>.hxi  a header and one entry per block: times of
+ *                            the first and last sample, min, max, sum and
+ *                            count of its values
+ *              A block ends when it is full or its offsets would overflow
+ *              (71 minutes), so a slow or interrupted stream costs only
+ *              index entries. Times must not decrease, so the entries are
+ *              sorted and HX711_CaptureReader finds the first block of a
+ *              range by binary search in the memory-mapped index. An
+ *              aggregate takes whole blocks from their entries and scans
+ *              only the blocks at both ends.
+ *              HX711_CaptureWriter keeps the open block in memory and
+ *              writes it with its entry when it is full and on flush();
+ *              data first, the block count in the header last. open()
+ *              continues an existing capture, also a partial last block.
+ *              Both keep a min/max/mean pyramid beside, see HX711_Pyramid.h,
+ *              the writer updates and flushes it with the capture, the
+ *              reader renders trend views from it. A capture without one
+ *              still opens: the reader renders no buckets, the writer
+ *              builds the pyramid from the blocks first.
+ *              Times are [us] since the epoch, little endian, Linux only.
+ */
+#ifndef _HX711_CAPTUREFILE_H_
+#define _HX711_CAPTUREFILE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "HX711_Pyramid.h"
+
+constexpr uint32_t HX711_CAPTURE_BLOCK = 4096;
+
+struct HX711_CaptureHeader
+{
+    char     magic[4];        // "HXCI"
+    uint32_t version;
+    uint32_t blockSamples;
+    uint32_t reserved;
+    uint64_t blocks;          // entries in use, the last may be partial
+    uint64_t samples;
+};
+
+struct HX711_CaptureEntry
+{
+    int64_t  first;           // [us]
+    int64_t  last;
+    int64_t  sum;
+    int32_t  min;
+    int32_t  max;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct HX711_Aggregate
+{
+    uint64_t count;
+    int64_t  sum;
+    int32_t  min;
+    int32_t  max;
+    double   mean() const { return count ? (double)sum / count : 0.0; }
+};
+
+class HX711_CaptureWriter
+{
+    public:
+        HX711_CaptureWriter(uint32_t blockSamples = HX711_CAPTURE_BLOCK) : _blockSamples(blockSamples) {}
+        ~HX711_CaptureWriter() { close(); }
+
+        bool     open(const char *base);
+        bool     append(int64_t us, int32_t value);
+        bool     flush();
+        void     close();
+        bool     isOpen() { return _data >= 0; }
+        uint64_t getSamples() { return _header.samples; }
+        uint64_t getBlocks() { return _header.blocks; }
+
+    private:
+        bool     writeBlock();
+        bool     buildPyramid();
+
+        uint32_t _blockSamples;
+        int      _data = -1;
+        int      _index = -1;
+        HX711_CaptureHeader _header = {};
+        HX711_CaptureEntry  _entry = {};        // of the open block
+        uint64_t _block = 0;                    // its number
+        int64_t  _lastUs = INT64_MIN;
+        std::vector<int32_t>  _values;
+        std::vector<uint32_t> _offsets;
+        bool     _dirty = false;
+        HX711_Pyramid _pyramid;
+};
+
+class HX711_CaptureReader
+{
+    public:
+        ~HX711_CaptureReader() { close(); }
+
+        bool     open(const char *base);
+        bool     refresh();
+        void     close();
+        uint64_t getSamples() { return _header ? _header->samples : 0; }
+        uint64_t getBlocks() { return _blocks; }
+        int64_t  getFirst() { return _blocks ? _entries[0].first : 0; }
+        int64_t  getLast() { return _blocks ? _entries[_blocks - 1].last : 0; }
+        const HX711_CaptureEntry *getEntries() { return _entries; }
+        bool     hasPyramid() { return _pyramid.isOpen(); }
+        size_t   findBlock(int64_t us);
+        HX711_Aggregate aggregate(int64_t from, int64_t to);
+        size_t   read(int64_t from, int64_t to, int64_t *us, int32_t *values, size_t max);
+        size_t   render(int64_t from, int64_t to, size_t points, HX711_Bucket *out, size_t max, uint8_t *level = nullptr)
+                    { return _pyramid.render(from, to, points, out, max, level); }
+        HX711_PyramidReader &getPyramid() { return _pyramid; }
+
+    private:
+        void     scan(uint64_t block, int64_t from, int64_t to, HX711_Aggregate &a);
+        bool     map();
+        void     unmap();
+
+        std::string _base;
+        int      _dataFd = -1;
+        int      _indexFd = -1;
+        const uint8_t *_data = nullptr;
+        size_t   _dataSize = 0;
+        const uint8_t *_index = nullptr;
+        size_t   _indexSize = 0;
+        const HX711_CaptureHeader *_header = nullptr;
+        const HX711_CaptureEntry  *_entries = nullptr;
+        uint64_t _blocks = 0;
+        uint32_t _blockSamples = 0;
+        HX711_PyramidReader _pyramid;
+};
+#endif
@@ -0,0 +1,450 @@
+/**
+ * Class        HX711_Ingest.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      epoll multiplexing of many scales, see HX711_Ingest.h
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "HX711_Ingest.h"
+
+constexpr uint32_t MS_WRAP    = 4294967;                // micros() / 1000 wraps there
+constexpr uint64_t LISTEN_TAG = 0xFFFFFFFF00000000ULL;  // epoll data of the socket
+constexpr uint64_t CLIENT_TAG = 0xFFFFFFFE00000000ULL;  // | fd of a client
+constexpr uint64_t RETRY_US   = 1000000;
+constexpr int      EVENTS     = 64;
+
+HX711_Ingest::HX711_Ingest(size_t history) : _history(history > 0 ? history : 1)
+{
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+}
+
+HX711_Ingest::~HX711_Ingest()
+{
+	for (Device *d : _devices)
+	{
+		if (d->fd >= 0) ::close(d->fd);
+		delete d;
+	}
+	for (const Client &c : _clients) ::close(c.fd);
+	if (_listen >= 0)
+	{
+		::close(_listen);
+		unlink(_socketPath.c_str());
+	}
+	if (_epoll >= 0) ::close(_epoll);
+}
+
+uint64_t HX711_Ingest::now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static speed_t toSpeed(uint32_t baud)
+{
+	switch (baud)
+	{
+		case 9600:   return B9600;
+		case 19200:  return B19200;
+		case 38400:  return B38400;
+		case 57600:  return B57600;
+		case 230400: return B230400;
+		case 460800: return B460800;
+		case 921600: return B921600;
+		default:     return B115200;
+	}
+}
+
+/**
+ * Add a serial port, its index or -1 if epoll failed. A port that does
+ * not open yet is retried every second.
+ */
+int HX711_Ingest::add(const char *path, uint32_t baud, bool everySample)
+{
+	if (_epoll < 0 || _devices.size() >= 0xFFFF) return -1;
+	Device *d = new Device;
+	d->path = path;
+	d->baud = baud;
+	d->everySample = everySample;
+	d->history.resize(_history);
+	_devices.push_back(d);
+	open(_devices.size() - 1);
+	return _devices.size() - 1;
+}
+
+/**
+ * Raw 8N1, nonblocking; a pipe or file that is no tty is read as it is
+ */
+bool HX711_Ingest::open(uint16_t index)
+{
+	Device &d = *_devices[index];
+	d.fd = ::open(d.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (d.fd < 0) d.fd = ::open(d.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (d.fd < 0)
+	{
+		d.retryAt = now() + RETRY_US;
+		return false;
+	}
+	termios tio;
+	if (tcgetattr(d.fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tio.c_cc[VMIN] = 1;                 // nonblocking read of nothing is EAGAIN, not 0
+		tio.c_cc[VTIME] = 0;
+		cfsetspeed(&tio, toSpeed(d.baud));
+		tcsetattr(d.fd, TCSANOW, &tio);
+	}
+	epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLRDHUP;
+	ev.data.u64 = index;
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, d.fd, &ev);
+	d.parser.clear();
+	return true;
+}
+
+void HX711_Ingest::close(Device &d)
+{
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, d.fd, nullptr);
+	::close(d.fd);
+	d.fd = -1;
+	d.retryAt = now() + RETRY_US;
+}
+
+/**
+ * Unix stream socket for list, latest and history
+ */
+bool HX711_Ingest::listen(const char *socketPath)
+{
+	sockaddr_un addr = {};
+	if (strlen(socketPath) >= sizeof(addr.sun_path)) return false;
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+	unlink(socketPath);
+	_listen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (_listen < 0 || bind(_listen, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(_listen, 8) < 0) return false;
+	_socketPath = socketPath;
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.u64 = LISTEN_TAG;
+	return epoll_ctl(_epoll, EPOLL_CTL_ADD, _listen, &ev) == 0;
+}
+
+/**
+ * Wait up to timeoutMs for data and handle all of it, reopen ports that
+ * failed, close idle clients. Returns the number of readings.
+ */
+int HX711_Ingest::poll(int timeoutMs)
+{
+	uint64_t t = now();
+	for (uint16_t i = 0; i < _devices.size(); i++)
+	{
+		if (_devices[i]->fd < 0 && t >= _devices[i]->retryAt && open(i)) _devices[i]->stats.reopens++;
+	}
+	epoll_event ev[EVENTS];
+	int n = epoll_wait(_epoll, ev, EVENTS, timeoutMs);
+	int readings = 0;
+	for (int i = 0; i < n; i++)
+	{
+		uint64_t tag = ev[i].data.u64;
+		if (tag == LISTEN_TAG)
+		{
+			int client;
+			while ((client = accept4(_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+			{
+				epoll_event cev = {};
+				cev.events = EPOLLIN;
+				cev.data.u64 = CLIENT_TAG | (uint32_t)client;
+				epoll_ctl(_epoll, EPOLL_CTL_ADD, client, &cev);
+				Client c;
+				c.fd = client;
+				c.since = now();
+				_clients.push_back(c);
+			}
+		}
+		else if ((tag & CLIENT_TAG) == CLIENT_TAG)
+		{
+			serve((int)(uint32_t)tag, ev[i].events);
+		}
+		else
+		{
+			uint64_t before = _devices[tag]->stats.readings;
+			drain((uint16_t)tag, ev[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR));
+			readings += _devices[tag]->stats.readings - before;
+		}
+	}
+	if (!_clients.empty()) expire(now());
+	return readings;
+}
+
+/**
+ * Close clients that sent no command or took none of their answer in
+ * time, they would stay in the epoll set forever
+ */
+void HX711_Ingest::expire(uint64_t t)
+{
+	for (size_t i = 0; i < _clients.size(); )
+	{
+		if (t - _clients[i].since < HX711_CLIENT_IDLE) i++;
+		else drop(i);
+	}
+}
+
+void HX711_Ingest::drop(size_t index)
+{
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, _clients[index].fd, nullptr);
+	::close(_clients[index].fd);
+	_clients[index] = std::move(_clients.back());
+	_clients.pop_back();
+}
+
+/**
+ * Read until the port is empty, parse in place; after a hangup the port
+ * is closed when all is read
+ */
+void HX711_Ingest::drain(uint16_t index, bool hangup)
+{
+	Device &d = *_devices[index];
+	while (d.fd >= 0)
+	{
+		size_t free;
+		uint8_t *p = d.parser.space(free);
+		ssize_t n = read(d.fd, p, free);
+		if (n < 0 && errno == EINTR) continue;
+		if ((n < 0 && errno == EAGAIN) || (n == 0 && !hangup)) return;
+		if (n <= 0)
+		{
+			close(d);                       // hung up or failed
+			return;
+		}
+		d.parser.commit(n);
+		d.stats.bytes += n;
+		uint64_t hostUs = now();
+		HX711_Reading r;
+		while (d.parser.next(r)) stamp(index, r, hostUs);
+	}
+}
+
+/**
+ * Unwrap the scale time, count lost readings, estimate the lag, keep
+ */
+void HX711_Ingest::stamp(uint16_t index, const HX711_Reading &r, uint64_t hostUs)
+{
+	Device &d = *_devices[index];
+	if (d.stats.readings == 0)
+	{
+		d.scaleMs = r.ms;
+	}
+	else
+	{
+		int64_t dt;
+		if (r.ms >= d.lastMs) dt = r.ms - d.lastMs;
+		else if (d.lastMs - r.ms > MS_WRAP / 2) dt = (int64_t)r.ms + MS_WRAP - d.lastMs;
+		else dt = -1;                       // the scale restarted
+		if (dt < 0)
+		{
+			const HX711_Stamped &last = d.history[(d.head + _history - 1) % _history];
+			d.scaleMs += (hostUs - last.hostUs) / 1000;
+			d.interval = 0.0;
+			d.baseCur = d.basePrev = INT64_MAX;
+		}
+		else
+		{
+			d.scaleMs += dt;
+			if (dt > 0 && d.everySample)
+			{
+				if (d.interval > 0.0 && dt > 1.5 * d.interval) d.stats.lost += lround(dt / d.interval) - 1;
+				else if (d.interval == 0.0 || dt < 0.67 * d.interval) d.interval = dt;
+				else d.interval += (dt - d.interval) / 16.0;
+			}
+		}
+	}
+	d.lastMs = r.ms;
+
+	int64_t offset = (int64_t)hostUs - (int64_t)d.scaleMs * 1000;
+	if (hostUs - d.baseAt >= HX711_LAG_SPAN)
+	{
+		d.basePrev = d.baseCur;
+		d.baseCur = INT64_MAX;
+		d.baseAt = hostUs;
+	}
+	if (offset < d.baseCur) d.baseCur = offset;
+	float lag = (offset - (d.baseCur < d.basePrev ? d.baseCur : d.basePrev)) / 1000.0f;
+	d.stats.lagMs = lag;
+	if (lag > d.stats.lagMaxMs) d.stats.lagMaxMs = lag;
+	d.lagSum += lag;
+	d.lagN++;
+	d.stats.readings++;
+
+	HX711_Stamped &s = d.history[d.head];
+	s.reading = r;
+	s.scaleMs = d.scaleMs;
+	s.hostUs = hostUs;
+	d.head = (d.head + 1) % _history;
+	if (d.filled < _history) d.filled++;
+	if (_handler) _handler(index, s);
+}
+
+bool HX711_Ingest::getLatest(uint16_t device, HX711_Stamped &s)
+{
+	Device &d = *_devices[device];
+	if (d.filled == 0) return false;
+	s = d.history[(d.head + _history - 1) % _history];
+	return true;
+}
+
+/**
+ * The last max readings, oldest first
+ */
+size_t HX711_Ingest::getHistory(uint16_t device, HX711_Stamped *out, size_t max)
+{
+	Device &d = *_devices[device];
+	size_t n = max < d.filled ? max : d.filled;
+	for (size_t i = 0; i < n; i++) out[i] = d.history[(d.head + _history - n + i) % _history];
+	return n;
+}
+
+HX711_DeviceStats HX711_Ingest::getStats(uint16_t device, bool reset)
+{
+	Device &d = *_devices[device];
+	d.stats.broken = d.parser.getBroken();
+	d.stats.other = d.parser.getOther();
+	d.stats.intervalMs = d.interval;
+	d.stats.lagMeanMs = d.lagN ? d.lagSum / d.lagN : 0.0f;
+	HX711_DeviceStats s = d.stats;
+	if (reset)
+	{
+		d.stats.lagMaxMs = 0.0f;
+		d.lagSum = 0.0;
+		d.lagN = 0;
+	}
+	return s;
+}
+
+void HX711_Ingest::printStats(FILE *f, bool reset)
+{
+	fprintf(f, "dev readings       lost     broken  lag_ms mean/max  interval  path\n");
+	for (uint16_t i = 0; i < _devices.size(); i++)
+	{
+		HX711_DeviceStats s = getStats(i, reset);
+		fprintf(f, "%3u %10llu %8llu %8llu %8.1f %6.1f %8.1f  %s%s\n", i, (unsigned long long)s.readings,
+			(unsigned long long)s.lost, (unsigned long long)s.broken, s.lagMeanMs, s.lagMaxMs, s.intervalMs,
+			getPath(i), _devices[i]->fd < 0 ? " (closed)" : "");
+	}
+}
+
+/**
+ * Collect the command up to its newline, or up to the end if the client
+ * shuts down its side, then send the answer as far as the socket takes
+ * it; the rest goes out on EPOLLOUT. The connection is closed when the
+ * answer is sent or the client fails.
+ */
+void HX711_Ingest::serve(int client, uint32_t events)
+{
+	size_t i = 0;
+	while (i < _clients.size() && _clients[i].fd != client) i++;
+	if (i == _clients.size()) return;
+	Client &c = _clients[i];
+	uint64_t t = now();
+	if (c.out.empty())
+	{
+		bool ended = false;
+		char buf[HX711_COMMAND_MAX];
+		while (c.in.size() < HX711_COMMAND_MAX && c.in.find('\n') == std::string::npos)
+		{
+			ssize_t n = recv(client, buf, HX711_COMMAND_MAX - c.in.size(), 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0 && errno != EAGAIN)
+			{
+				drop(i);
+				return;
+			}
+			if (n <= 0)
+			{
+				ended = n == 0;
+				break;
+			}
+			c.in.append(buf, n);
+			c.since = t;
+		}
+		size_t eol = c.in.find('\n');
+		if (eol == std::string::npos && !ended && c.in.size() < HX711_COMMAND_MAX) return;
+		if (c.in.empty())
+		{
+			drop(i);                        // hung up without a command
+			return;
+		}
+		if (eol != std::string::npos) c.in.resize(eol);
+		c.out = answer(c.in.c_str());
+		epoll_event ev = {};
+		ev.events = EPOLLOUT;
+		ev.data.u64 = CLIENT_TAG | (uint32_t)client;
+		epoll_ctl(_epoll, EPOLL_CTL_MOD, client, &ev);
+	}
+	else if (!(events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) return;
+	while (c.sent < c.out.size())
+	{
+		ssize_t w = send(client, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+		if (w < 0 && errno == EINTR) continue;
+		if (w < 0 && errno == EAGAIN) return;
+		if (w <= 0) break;                  // the client went away
+		c.sent += w;
+		c.since = t;
+	}
+	drop(i);
+}
+
+/**
+ * The text answer to one command
+ */
+std::string HX711_Ingest::answer(const char *cmd)
+{
+	std::string out;
+	char line[160];
+	unsigned dev = 0, count = 0;
+	if (strncmp(cmd, "list", 4) == 0)
+	{
+		for (uint16_t i = 0; i < _devices.size(); i++)
+		{
+			HX711_DeviceStats s = getStats(i);
+			snprintf(line, sizeof(line), "%u %s %llu %llu %llu %.1f\n", i, getPath(i), (unsigned long long)s.readings,
+				(unsigned long long)s.lost, (unsigned long long)s.broken, s.lagMs);
+			out += line;
+		}
+	}
+	else if (strncmp(cmd, "latest", 6) == 0)
+	{
+		HX711_Stamped s;
+		for (uint16_t i = 0; i < _devices.size(); i++)
+		{
+			if (!getLatest(i, s)) continue;
+			snprintf(line, sizeof(line), "%u %llu %.1f %c\n", i, (unsigned long long)s.scaleMs, s.reading.weight,
+				s.reading.flags & HX711_STABLE ? 'S' : 'M');
+			out += line;
+		}
+	}
+	else if (sscanf(cmd, "history %u %u", &dev, &count) == 2 && dev < _devices.size())
+	{
+		std::vector<HX711_Stamped> h(count < _history ? count : _history);
+		h.resize(getHistory(dev, h.data(), h.size()));
+		for (const HX711_Stamped &s : h)
+		{
+			snprintf(line, sizeof(line), "%llu %.1f %c\n", (unsigned long long)s.scaleMs, s.reading.weight,
+				s.reading.flags & HX711_STABLE ? 'S' : 'M');
+			out += line;
+		}
+	}
+	else out = "? list | latest | history <device> <n>\n";
+	return out;
+}
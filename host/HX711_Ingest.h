@@ -0,0 +1,136 @@
+/**
+ * Header       HX711_Ingest.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Reads many scales on serial ports with one thread: all
+ *              ports are nonblocking in one epoll set, poll() waits for
+ *              any of them and drains what is there into the port's
+ *              HX711_Parser. Every reading is stamped with the host time,
+ *              kept as latest value and in a history ring per device and
+ *              passed to the reading handler, if one is set.
+ *              Lag: the scale clock is unknown, so the smallest difference
+ *              host time - scale time seen during the last 10 to 20 s is
+ *              taken as zero lag, the lag of a reading is its difference
+ *              above that. It includes the 1 ms resolution of the scale
+ *              time and follows the drift of the scale crystal.
+ *              Loss: a device that reports every sample (t0 on the scale)
+ *              sends at a fixed interval, an interval above 1.5 times the
+ *              mean interval counts the readings missing. Change-only
+ *              devices are added with everySample false, for them only
+ *              broken lines count.
+ *              A port that hangs up or fails is closed and opened again
+ *              every second. With listen() a Unix socket answers one
+ *              command per connection. Clients are nonblocking: the
+ *              command is collected up to its newline over as many reads
+ *              as it takes, the answer is queued and sent whenever the
+ *              client can take more, so a slow client never stalls the
+ *              ports. A client that sends no command or takes nothing of
+ *              its answer within HX711_CLIENT_IDLE is closed:
+ *                list             device, path, readings, lost, broken, lag
+ *                latest           device, scale ms, weight, S or M
+ *                history <d> <n>  the last n readings of device d
+ *
+ * Constructor  history      readings kept per device
+ */
+#ifndef _HX711_INGEST_H_
+#define _HX711_INGEST_H_
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "HX711_Parser.h"
+
+constexpr size_t   HX711_HISTORY   = 4096;
+constexpr uint64_t HX711_LAG_SPAN  = 10000000;  // lag base window [us]
+constexpr uint64_t HX711_CLIENT_IDLE = 2000000; // socket client without progress [us]
+constexpr size_t   HX711_COMMAND_MAX = 64;      // longer commands are not collected
+
+struct HX711_Stamped
+{
+    HX711_Reading reading;
+    uint64_t scaleMs;         // scale time, unwrapped
+    uint64_t hostUs;          // CLOCK_MONOTONIC when read
+};
+
+struct HX711_DeviceStats
+{
+    uint64_t bytes;
+    uint64_t readings;
+    uint64_t lost;            // missing by the interval
+    uint64_t broken;          // lines and frames that did not parse
+    uint64_t other;           // other lines
+    uint32_t reopens;
+    float    intervalMs;      // mean interval
+    float    lagMs;           // of the latest reading
+    float    lagMaxMs;        // since getStats(reset)
+    float    lagMeanMs;
+};
+
+class HX711_Ingest
+{
+    public:
+        using ReadingHandler = void (*)(uint16_t device, const HX711_Stamped &s);
+
+        HX711_Ingest(size_t history = HX711_HISTORY);
+        ~HX711_Ingest();
+
+        int      add(const char *path, uint32_t baud = 115200, bool everySample = true);
+        bool     listen(const char *socketPath);
+        int      poll(int timeoutMs);
+        void     setReadingHandler(ReadingHandler handler) { _handler = handler; }
+        uint16_t getDevices() { return _devices.size(); }
+        const char *getPath(uint16_t device) { return _devices[device]->path.c_str(); }
+        bool     getLatest(uint16_t device, HX711_Stamped &s);
+        size_t   getHistory(uint16_t device, HX711_Stamped *out, size_t max);
+        HX711_DeviceStats getStats(uint16_t device, bool reset = false);
+        void     printStats(FILE *f, bool reset = false);
+        static uint64_t now();
+
+    private:
+        struct Client
+        {
+            int      fd;
+            uint64_t since;           // accepted or last progress [us]
+            std::string in;           // command so far
+            std::string out;          // answer, once the command is complete
+            size_t   sent = 0;
+        };
+
+        struct Device
+        {
+            std::string path;
+            uint32_t baud;
+            bool     everySample;
+            int      fd = -1;
+            uint64_t retryAt = 0;
+            HX711_Parser parser;
+            std::vector<HX711_Stamped> history;
+            size_t   head = 0;
+            size_t   filled = 0;
+            uint64_t scaleMs = 0;
+            uint32_t lastMs = 0;
+            double   interval = 0.0;
+            int64_t  baseCur = INT64_MAX, basePrev = INT64_MAX;
+            uint64_t baseAt = 0;
+            double   lagSum = 0.0;
+            uint64_t lagN = 0;
+            HX711_DeviceStats stats = {};
+        };
+
+        bool     open(uint16_t index);
+        void     close(Device &d);
+        void     drain(uint16_t index, bool hangup);
+        void     stamp(uint16_t index, const HX711_Reading &r, uint64_t hostUs);
+        void     serve(int client, uint32_t events);
+        std::string answer(const char *cmd);
+        void     drop(size_t index);
+        void     expire(uint64_t t);
+
+        int      _epoll;
+        int      _listen = -1;
+        std::string _socketPath;
+        size_t   _history;
+        std::vector<Device *> _devices;
+        std::vector<Client> _clients;
+        ReadingHandler _handler = nullptr;
+};
+#endif
@@ -0,0 +1,122 @@
+/**
+ * Class        HX711_Parser.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      In place parser of scale reports, see HX711_Parser.h
+ */
+#include <string.h>
+#include "HX711_Parser.h"
+
+static uint16_t crc16(const uint8_t *p, uint8_t n)
+{
+	uint16_t crc = 0xFFFF;
+	while (n--)
+	{
+		crc ^= (uint16_t)*p++ << 8;
+		for (uint8_t k = 0; k < 8; k++) crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * The next reading in the buffer, false when only an incomplete line
+ * or frame is left
+ */
+bool HX711_Parser::next(HX711_Reading &r)
+{
+	while (_pos < _end)
+	{
+		const uint8_t *p = _buf + _pos;
+		if (*p == HX711_FRAME_SYNC)
+		{
+			if (_end - _pos < HX711_FRAME_SIZE) break;
+			if (frame(p, r))
+			{
+				_pos += HX711_FRAME_SIZE;
+				return true;
+			}
+			_broken++;
+			_pos++;
+			continue;
+		}
+		const uint8_t *e = p;
+		const uint8_t *end = _buf + _end;
+		while (e < end && *e != '\n' && *e != HX711_FRAME_SYNC) e++;
+		if (e == end && e - p <= (ptrdiff_t)HX711_PARSER_LINE) break;
+		_pos = e - _buf + (e < end && *e == '\n');
+		if (line(p, e, r)) return true;
+	}
+	compact();
+	return false;
+}
+
+/**
+ * "123456 250.3 S", the carriage return is optional
+ */
+bool HX711_Parser::line(const uint8_t *p, const uint8_t *e, HX711_Reading &r)
+{
+	if (e > p && e[-1] == '\r') e--;
+	if (e == p) return false;
+	if (*p < '0' || *p > '9')
+	{
+		_other++;
+		return false;
+	}
+	uint32_t ms = 0;
+	while (p < e && *p >= '0' && *p <= '9') ms = ms * 10 + (*p++ - '0');
+	bool ok = p < e && *p++ == ' ';
+	bool negative = ok && p < e && *p == '-';
+	if (negative) p++;
+	int32_t  v = 0;
+	uint32_t scale = 1;
+	bool digits = false;
+	while (ok && p < e && *p >= '0' && *p <= '9')
+	{
+		v = v * 10 + (*p++ - '0');
+		digits = true;
+	}
+	if (ok && p < e && *p == '.')
+	{
+		p++;
+		while (p < e && *p >= '0' && *p <= '9' && scale < 100000)
+		{
+			v = v * 10 + (*p++ - '0');
+			scale *= 10;
+		}
+	}
+	ok = ok && digits && e - p == 2 && p[0] == ' ' && (p[1] == 'S' || p[1] == 'M');
+	if (!ok)
+	{
+		_broken++;
+		return false;
+	}
+	r.ms = ms;
+	r.weight = (negative ? -v : v) / (float)scale;
+	r.flags = p[1] == 'S' ? HX711_STABLE : 0;
+	return true;
+}
+
+/**
+ * 0xA5, flags, uint32 ms, float weight, CRC-16 over the 10 bytes before
+ */
+bool HX711_Parser::frame(const uint8_t *p, HX711_Reading &r)
+{
+	uint16_t crc;
+	memcpy(&crc, p + 10, 2);
+	if (crc != crc16(p, 10)) return false;
+	r.flags = p[1];
+	memcpy(&r.ms, p + 2, 4);
+	memcpy(&r.weight, p + 6, 4);
+	return true;
+}
+
+/**
+ * Move what is left to the front for the next read()
+ */
+void HX711_Parser::compact()
+{
+	if (_pos == 0) return;
+	memmove(_buf, _buf + _pos, _end - _pos);
+	_end -= _pos;
+	_pos = 0;
+}
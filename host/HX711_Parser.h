@@ -0,0 +1,57 @@
+/**
+ * Header       HX711_Parser.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Host side parser of the reports a scale sends, see
+ *              HX711_Reporter: text lines "123456 250.3 S" and binary
+ *              frames of 12 bytes starting with 0xA5, also mixed.
+ *              read() writes straight into the buffer given by space(),
+ *              next() parses in place and returns one reading at a time,
+ *              no line is copied or allocated. Only an incomplete line or
+ *              frame at the end is moved to the front before the next
+ *              read(). Lines that start with a digit but do not parse and
+ *              frames with a wrong CRC are counted as broken, the parser
+ *              resynchronizes on the next line end or sync byte. Other
+ *              lines (menu, prompts) are counted and skipped.
+ *              Linux only, like everything in host/.
+ */
+#ifndef _HX711_PARSER_H_
+#define _HX711_PARSER_H_
+#include <stddef.h>
+#include <stdint.h>
+
+constexpr size_t  HX711_PARSER_BUFFER = 4096;
+constexpr size_t  HX711_PARSER_LINE   = 64;    // longer lines are garbage
+constexpr uint8_t HX711_FRAME_SYNC    = 0xA5;
+constexpr uint8_t HX711_FRAME_SIZE    = 12;
+constexpr uint8_t HX711_STABLE        = 0x80;  // REPORT_STABLE
+
+struct HX711_Reading
+{
+    uint32_t ms;              // scale time [ms], wraps after 71 minutes
+    float    weight;          // [g]
+    uint8_t  flags;           // REPORT_... of a frame, HX711_STABLE of a line
+};
+
+class HX711_Parser
+{
+    public:
+        uint8_t *space(size_t &free) { free = sizeof(_buf) - _end; return _buf + _end; }
+        void     commit(size_t n) { _end += n; }
+        bool     next(HX711_Reading &r);
+        void     clear() { _pos = _end = 0; }
+        uint64_t getBroken() { return _broken; }
+        uint64_t getOther() { return _other; }
+
+    private:
+        bool     line(const uint8_t *p, const uint8_t *e, HX711_Reading &r);
+        bool     frame(const uint8_t *p, HX711_Reading &r);
+        void     compact();
+
+        uint8_t  _buf[HX711_PARSER_BUFFER];
+        size_t   _pos = 0;                      // first byte not parsed
+        size_t   _end = 0;                      // end of the data
+        uint64_t _broken = 0;
+        uint64_t _other = 0;
+};
+#endif
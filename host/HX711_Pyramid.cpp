@@ -0,0 +1,280 @@
+/**
+ * Class        HX711_Pyramid.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Min/max/mean pyramid of a capture, see HX711_Pyramid.h
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HX711_Pyramid.h"
+
+static std::string levelFile(const std::string &base, uint8_t level)
+{
+	return base + ".p" + std::to_string(level);
+}
+
+static bool writeBucket(int fd, const HX711_Bucket &b, uint64_t at)
+{
+	return pwrite(fd, &b, sizeof(b), (off_t)(at * sizeof(b))) == (ssize_t)sizeof(b);
+}
+
+/**
+ * Start of the window of the level that holds us, times are not negative
+ */
+static int64_t windowOf(int64_t us, uint8_t level)
+{
+	int64_t w = HX711_Pyramid::width(level);
+	return us / w * w;
+}
+
+static void merge(HX711_Bucket &to, const HX711_Bucket &b)
+{
+	to.count += b.count;
+	to.sum += b.sum;
+	if (b.min < to.min) to.min = b.min;
+	if (b.max > to.max) to.max = b.max;
+}
+
+int64_t HX711_Pyramid::width(uint8_t level)
+{
+	int64_t w = HX711_PYRAMID_BASE;
+	while (level--) w *= HX711_PYRAMID_FACTOR;
+	return w;
+}
+
+/**
+ * Create the level files or continue them, what they hold is final
+ */
+bool HX711_Pyramid::open(const char *base)
+{
+	close();
+	std::string b(base);
+	_ok = true;
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		struct stat s;
+		_fd[k] = ::open(levelFile(b, k).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		_ok = _ok && _fd[k] >= 0 && fstat(_fd[k], &s) == 0;
+		_closed[k] = _ok ? s.st_size / sizeof(HX711_Bucket) : 0;
+		_has[k] = false;
+	}
+	if (!_ok) close();
+	return _ok;
+}
+
+/**
+ * Nothing written yet, also when open() created the level files
+ */
+bool HX711_Pyramid::isEmpty()
+{
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		if (getBuckets(k)) return false;
+	}
+	return true;
+}
+
+void HX711_Pyramid::append(int64_t us, int32_t value)
+{
+	if (!_ok) return;
+	int64_t start = windowOf(us, 0);
+	HX711_Bucket &b = _open[0];
+	if (_has[0] && b.start != start) closeBucket(0);
+	if (!_has[0])
+	{
+		b = { start, 0, value, value, 0, 0 };
+		_has[0] = true;
+	}
+	b.count++;
+	b.sum += value;
+	if (value < b.min) b.min = value;
+	if (value > b.max) b.max = value;
+}
+
+/**
+ * Write the open bucket for good and merge it into the level above
+ */
+void HX711_Pyramid::closeBucket(uint8_t level)
+{
+	_ok = _ok && writeBucket(_fd[level], _open[level], _closed[level]);
+	_closed[level]++;
+	_has[level] = false;
+	if (level + 1 < HX711_PYRAMID_LEVELS) push(level + 1, _open[level]);
+}
+
+void HX711_Pyramid::push(uint8_t level, const HX711_Bucket &b)
+{
+	int64_t start = windowOf(b.start, level);
+	HX711_Bucket &o = _open[level];
+	if (_has[level] && o.start != start) closeBucket(level);
+	if (!_has[level])
+	{
+		o = b;
+		o.start = start;
+		_has[level] = true;
+	}
+	else merge(o, b);
+}
+
+/**
+ * Write the open buckets, each with what is still open below it. What
+ * a level has not pushed up yet is the buckets flush() wrote for it
+ * beyond the closed ones: its open bucket and the pieces from below,
+ * merged by window. The open bucket may lie in an earlier window than
+ * the pieces, so a level can write more than one.
+ */
+bool HX711_Pyramid::flush()
+{
+	if (!_ok) return false;
+	HX711_Bucket piece[HX711_PYRAMID_LEVELS + 1];
+	uint8_t pieces = 0;
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS && _ok; k++)
+	{
+		HX711_Bucket level[HX711_PYRAMID_LEVELS + 1];
+		uint8_t n = 0;
+		if (_has[k]) level[n++] = _open[k];
+		for (uint8_t i = 0; i < pieces; i++)
+		{
+			int64_t start = windowOf(piece[i].start, k);
+			if (n > 0 && level[n - 1].start == start) merge(level[n - 1], piece[i]);
+			else
+			{
+				level[n] = piece[i];
+				level[n++].start = start;
+			}
+		}
+		for (uint8_t i = 0; i < n && _ok; i++) _ok = writeBucket(_fd[k], level[i], _closed[k] + i);
+		_ok = _ok && ftruncate(_fd[k], (off_t)((_closed[k] + n) * sizeof(HX711_Bucket))) == 0;
+		memcpy(piece, level, n * sizeof(HX711_Bucket));
+		pieces = n;
+	}
+	return _ok;
+}
+
+/**
+ * Close all open buckets from the bottom up
+ */
+void HX711_Pyramid::close()
+{
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS && _ok; k++)
+	{
+		if (_has[k]) closeBucket(k);
+	}
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		if (_ok) _ok = ftruncate(_fd[k], (off_t)(_closed[k] * sizeof(HX711_Bucket))) == 0;
+		if (_fd[k] >= 0) ::close(_fd[k]);
+		_fd[k] = -1;
+		_has[k] = false;
+	}
+	_ok = false;
+}
+
+bool HX711_PyramidReader::open(const char *base)
+{
+	close();
+	std::string b(base);
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		_fd[k] = ::open(levelFile(b, k).c_str(), O_RDONLY | O_CLOEXEC);
+		if (_fd[k] < 0)
+		{
+			close();
+			return false;
+		}
+	}
+	if (!map())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Map again what the writer has added since
+ */
+bool HX711_PyramidReader::refresh()
+{
+	if (_fd[0] < 0) return false;
+	unmap();
+	return map();
+}
+
+void HX711_PyramidReader::close()
+{
+	unmap();
+	for (int &fd : _fd)
+	{
+		if (fd >= 0) ::close(fd);
+		fd = -1;
+	}
+}
+
+bool HX711_PyramidReader::map()
+{
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		struct stat s;
+		if (fstat(_fd[k], &s) < 0) return false;
+		_count[k] = s.st_size / sizeof(HX711_Bucket);
+		if (_count[k] == 0) continue;
+		_size[k] = s.st_size;
+		void *p = mmap(nullptr, _size[k], PROT_READ, MAP_SHARED, _fd[k], 0);
+		if (p == MAP_FAILED) return false;
+		_level[k] = (const HX711_Bucket *)p;
+	}
+	return true;
+}
+
+void HX711_PyramidReader::unmap()
+{
+	for (uint8_t k = 0; k < HX711_PYRAMID_LEVELS; k++)
+	{
+		if (_level[k]) munmap((void *)_level[k], _size[k]);
+		_level[k] = nullptr;
+		_size[k] = 0;
+		_count[k] = 0;
+	}
+}
+
+/**
+ * Finest level with at most points windows in [from, to), the top level
+ * if none has
+ */
+uint8_t HX711_PyramidReader::levelFor(int64_t from, int64_t to, size_t points)
+{
+	uint8_t k = 0;
+	while (k + 1 < HX711_PYRAMID_LEVELS && to > from
+		&& (uint64_t)((windowOf(to - 1, k) - windowOf(from, k)) / HX711_Pyramid::width(k)) + 1 > points) k++;
+	return k;
+}
+
+/**
+ * The buckets of levelFor() that overlap [from, to), up to max, returns
+ * their number. The buckets at both ends cover their whole window.
+ */
+size_t HX711_PyramidReader::render(int64_t from, int64_t to, size_t points, HX711_Bucket *out, size_t max, uint8_t *level)
+{
+	uint8_t k = levelFor(from, to, points);
+	if (level) *level = k;
+	const HX711_Bucket *b = _level[k];
+	int64_t start = windowOf(from, k);
+	size_t lo = 0, hi = _count[k], n = 0;
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (b[mid].start < start) lo = mid + 1;
+		else hi = mid;
+	}
+	for (size_t i = lo; i < _count[k] && b[i].start < to; i++)
+	{
+		if (n > 0 && out[n - 1].start == b[i].start) merge(out[n - 1], b[i]);
+		else if (n < max) out[n++] = b[i];
+		else break;
+	}
+	return n;
+}
@@ -0,0 +1,103 @@
+/**
+ * Header       HX711_Pyramid.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Min/max/mean pyramid of a capture for trend views. Level 0
+ *              has a bucket per second, every level above one per 4
+ *              buckets of the level below, 12 levels up to 48 days. A
+ *              bucket holds start, count, sum, min and max of the samples
+ *              in its time window; empty windows have no bucket. Each
+ *              level is an append-only file <base>.p0 .. <base>.p11 of
+ *              buckets sorted by time.
+ *              HX711_Pyramid is updated while writing: a sample goes into
+ *              the open bucket of level 0 only; when a sample opens a new
+ *              window, the closed bucket is written and merged into the
+ *              open bucket of level 1, and so on up while buckets close.
+ *              At 80 SPS a level 0 bucket closes every 80 samples, each
+ *              level above 4 times less often, so a sample costs constant
+ *              time, amortized. flush() also writes the open buckets, each
+ *              including the open ones below it, and truncates what an
+ *              earlier flush wrote beyond.
+ *              HX711_PyramidReader maps the files; render() takes the
+ *              finest level that covers a range with at most the given
+ *              number of points and finds its first bucket by binary
+ *              search. Below 1000 s level 0 has fewer than 1000 points,
+ *              read the samples from the capture then.
+ *              A capture written before there were pyramids has no level
+ *              files: the reader renders nothing then, the writer builds
+ *              them from the blocks on open().
+ *              A capture opened again starts new open buckets, a window
+ *              written before and continued has two buckets with the same
+ *              start, render() merges them.
+ */
+#ifndef _HX711_PYRAMID_H_
+#define _HX711_PYRAMID_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+constexpr uint8_t HX711_PYRAMID_LEVELS = 12;
+constexpr int64_t HX711_PYRAMID_BASE   = 1000000;  // level 0 bucket [us]
+constexpr int64_t HX711_PYRAMID_FACTOR = 4;
+
+struct HX711_Bucket
+{
+    int64_t  start;           // of the window [us]
+    int64_t  sum;
+    int32_t  min;
+    int32_t  max;
+    uint32_t count;
+    uint32_t reserved;
+    double   mean() const { return count ? (double)sum / count : 0.0; }
+};
+
+class HX711_Pyramid
+{
+    public:
+        HX711_Pyramid() { for (int &fd : _fd) fd = -1; }
+        ~HX711_Pyramid() { close(); }
+
+        bool     open(const char *base);
+        void     append(int64_t us, int32_t value);
+        bool     flush();
+        void     close();
+        uint64_t getBuckets(uint8_t level) { return _closed[level] + _has[level]; }
+        bool     isEmpty();
+        static int64_t width(uint8_t level);
+
+    private:
+        void     closeBucket(uint8_t level);
+        void     push(uint8_t level, const HX711_Bucket &b);
+
+        int      _fd[HX711_PYRAMID_LEVELS];
+        uint64_t _closed[HX711_PYRAMID_LEVELS] = {};  // buckets written for good
+        HX711_Bucket _open[HX711_PYRAMID_LEVELS];
+        bool     _has[HX711_PYRAMID_LEVELS] = {};
+        bool     _ok = false;
+};
+
+class HX711_PyramidReader
+{
+    public:
+        HX711_PyramidReader() { for (int &fd : _fd) fd = -1; }
+        ~HX711_PyramidReader() { close(); }
+
+        bool     open(const char *base);
+        bool     refresh();
+        void     close();
+        bool     isOpen() { return _fd[0] >= 0; }
+        uint64_t getBuckets(uint8_t level) { return _count[level]; }
+        const HX711_Bucket *getLevel(uint8_t level) { return _level[level]; }
+        uint8_t  levelFor(int64_t from, int64_t to, size_t points);
+        size_t   render(int64_t from, int64_t to, size_t points, HX711_Bucket *out, size_t max, uint8_t *level = nullptr);
+
+    private:
+        bool     map();
+        void     unmap();
+
+        int      _fd[HX711_PYRAMID_LEVELS];
+        const HX711_Bucket *_level[HX711_PYRAMID_LEVELS] = {};
+        size_t   _size[HX711_PYRAMID_LEVELS] = {};
+        uint64_t _count[HX711_PYRAMID_LEVELS] = {};
+};
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Program      hx711d.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Linux daemon that reads many scales on USB serial with one
+ *              thread (HX711_Ingest). The scales send change-only or every
+ *              sample reports (menu keys t/T), text or binary. Latest
+ *              values and history are served on a Unix socket, per device
+ *              statistics with lag and loss go to stderr. With -w every
+ *              reading is appended to a capture file per port, the weight
+ *              in mg, the time the host read it (HX711_CaptureFile).
+ *
+ * Usage        hx711d [-s socket] [-b baud] [-c] [-n history] [-i seconds] [-w dir] port...
+ *                -s  Unix socket, default /tmp/hx711d.sock
+ *                -b  baud rate, default 115200
+ *                -c  the scales report change-only, no loss by interval
+ *                -n  readings kept per device, default 4096
+ *                -i  statistics interval, default 10 s, 0 = none
+ *                -w  capture to <dir>/<port name>.hxd/.hxi, flushed with
+ *                    the statistics and at the end
+ *              echo latest | socat - UNIX-CONNECT:/tmp/hx711d.sock
+ *
+ * Build        pio run -e native_hx711d
+ *              .pio/build/native_hx711d/program /dev/ttyUSB0 /dev/ttyUSB1
+ */
+#include <libgen.h>
+#include <math.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "HX711_CaptureFile.h"
+#include "HX711_Ingest.h"
+
+static volatile sig_atomic_t running = 1;
+static std::vector<HX711_CaptureWriter *> writers;
+static int64_t realtimeOffset = 0;             // CLOCK_REALTIME - CLOCK_MONOTONIC [us]
+
+static void stop(int)
+{
+	running = 0;
+}
+
+static void onReading(uint16_t device, const HX711_Stamped &s)
+{
+	writers[device]->append((int64_t)s.hostUs + realtimeOffset, lround(s.reading.weight * 1000.0f));
+}
+
+static bool openCaptures(HX711_Ingest &ingest, const char *dir)
+{
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	realtimeOffset = ts.tv_sec * 1000000LL + ts.tv_nsec / 1000 - (int64_t)HX711_Ingest::now();
+	for (uint16_t i = 0; i < ingest.getDevices(); i++)
+	{
+		std::string path(ingest.getPath(i));
+		std::string base = std::string(dir) + "/" + basename(&path[0]);
+		writers.push_back(new HX711_CaptureWriter());
+		if (!writers.back()->open(base.c_str()))
+		{
+			fprintf(stderr, "cannot open capture %s\n", base.c_str());
+			return false;
+		}
+	}
+	ingest.setReadingHandler(onReading);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *socketPath = "/tmp/hx711d.sock";
+	uint32_t baud = 115200;
+	bool everySample = true;
+	size_t history = HX711_HISTORY;
+	int interval = 10;
+	const char *captureDir = nullptr;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:b:cn:i:w:")) != -1)
+	{
+		switch (opt)
+		{
+			case 's': socketPath = optarg; break;
+			case 'b': baud = strtoul(optarg, nullptr, 10); break;
+			case 'c': everySample = false; break;
+			case 'n': history = strtoul(optarg, nullptr, 10); break;
+			case 'i': interval = atoi(optarg); break;
+			case 'w': captureDir = optarg; break;
+			default:
+				fprintf(stderr, "usage: %s [-s socket] [-b baud] [-c] [-n history] [-i seconds] [-w dir] port...\n", argv[0]);
+				return 2;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "%s: no serial port given\n", argv[0]);
+		return 2;
+	}
+
+	HX711_Ingest ingest(history);
+	for (int i = optind; i < argc; i++)
+	{
+		if (ingest.add(argv[i], baud, everySample) < 0)
+		{
+			fprintf(stderr, "%s: cannot add %s\n", argv[0], argv[i]);
+			return 1;
+		}
+	}
+	if (captureDir && !openCaptures(ingest, captureDir)) return 1;
+	if (!ingest.listen(socketPath))
+	{
+		perror(socketPath);
+		return 1;
+	}
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	uint64_t shownAt = HX711_Ingest::now();
+	while (running)
+	{
+		ingest.poll(500);
+		if (interval > 0 && HX711_Ingest::now() - shownAt >= interval * 1000000ULL)
+		{
+			shownAt = HX711_Ingest::now();
+			ingest.printStats(stderr, true);
+			for (HX711_CaptureWriter *w : writers) w->flush();
+		}
+	}
+	ingest.printStats(stderr);
+	for (HX711_CaptureWriter *w : writers) delete w;
+	return 0;
+}
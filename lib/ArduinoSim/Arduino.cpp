@@ -0,0 +1,320 @@
+/**
+ * Class        Arduino.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Host implementation of the Arduino core shim: virtual clock,
+ *              pin routing to simulated devices and the serial port
+ *
+ * Remarks      Default call costs are those measured on an Uno (16 MHz)
+ */
+#include "Arduino.h"
+
+uint64_t   SimCore::_ns = 0;
+uint32_t   SimCore::_ioCalls = 0;
+uint64_t   SimCore::_sleptNs = 0;
+uint32_t   SimCore::_wakeups = 0;
+bool       SimCore::_irqOn = true;
+uint64_t   SimCore::_bgPeriod = 0;
+uint64_t   SimCore::_bgDur = 0;
+uint64_t   SimCore::_bgNext = UINT64_MAX;
+uint64_t   SimCore::_stolenNs = 0;
+uint64_t   SimCore::_lastYield = 0;
+uint64_t   SimCore::_maxYieldGap = 0;
+uint32_t   SimCore::_gapsOverWdt = 0;
+uint32_t   SimCore::_callCost[(int)SimCall::NBR_CALLS] = 
+{
+	3500,	// DIGITAL_WRITE  ~56 cycles
+	3200,	// DIGITAL_READ   ~51 cycles
+	1000,	// MILLIS
+	1000,	// MICROS
+	5000,	// SERIAL_IO      per byte queued into the TX buffer
+	6000	// WAKEUP         wake from idle, ISR entry and exit
+};
+constexpr uint64_t TIMER0_TICK_NS = 1024000;	// Timer0 overflow every 1.024 ms
+constexpr uint64_t SOFT_WDT_NS    = 3200000000ULL;	// ESP8266 soft watchdog
+
+static struct { int8_t irq; void (*isr)(); int mode; } irqs[4];
+static uint8_t nbrIrqs = 0;
+SimDevice *SimCore::_devices[8];
+uint8_t    SimCore::_nbrDevices = 0;
+SimSerial  Serial;
+
+/**
+ * Background interrupts are not periodic: the gap is uniformly 
+ * distributed over 0.5 .. 1.5 periods (fixed LCG, reproducible)
+ */
+static uint64_t nextIrqGap(uint64_t period)
+{
+	static uint32_t lcg = 12345;
+	lcg = lcg * 1664525u + 1013904223u;
+	return period / 2 + (uint64_t)(lcg >> 8) * period / (1u << 24);
+}
+
+void SimCore::advance(uint64_t ns)
+{
+	_ns += ns;
+	while (_irqOn && _ns >= _bgNext)
+	{
+		_ns       += _bgDur;
+		_stolenNs += _bgDur;
+		_bgNext   += nextIrqGap(_bgPeriod);
+	}
+	for (uint8_t i = 0; i < _nbrDevices; i++)
+		_devices[i]->advanceTo(_ns);
+}
+
+void SimCore::attach(SimDevice *dev)
+{
+	if (_nbrDevices < sizeof(_devices) / sizeof(_devices[0]))
+		_devices[_nbrDevices++] = dev;
+}
+
+void SimCore::setBackgroundIrq(uint64_t periodNs, uint64_t durNs)
+{
+	_bgPeriod = periodNs;
+	_bgDur    = durNs;
+	_bgNext   = periodNs ? _ns + periodNs : UINT64_MAX;
+}
+
+/**
+ * Background interrupts which became due while disabled run on enable
+ */
+void SimCore::setInterrupts(bool on)
+{
+	_irqOn = on;
+	if (on) advance(0);
+}
+
+void SimCore::resumed()
+{
+	_lastYield = _ns;
+}
+
+void SimCore::yielded()
+{
+	uint64_t gap = _ns - _lastYield;
+	if (gap > _maxYieldGap) _maxYieldGap = gap;
+	if (gap > SOFT_WDT_NS) _gapsOverWdt++;
+	_lastYield = _ns;
+}
+
+void SimCore::reset()
+{
+	_ns = 0;
+	_nbrDevices = 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	(void)pin; (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	SimCore::charge(SimCall::DIGITAL_WRITE);
+	SimCore::countIo();
+	for (uint8_t i = 0; i < SimCore::_nbrDevices; i++)
+		if (SimCore::_devices[i]->ownsPin(pin))
+			SimCore::_devices[i]->pinWritten(pin, val ? HIGH : LOW, SimCore::now());
+}
+
+int digitalRead(uint8_t pin)
+{
+	SimCore::charge(SimCall::DIGITAL_READ);
+	SimCore::countIo();
+	for (uint8_t i = 0; i < SimCore::_nbrDevices; i++)
+		if (SimCore::_devices[i]->ownsPin(pin))
+			return SimCore::_devices[i]->pinRead(pin, SimCore::now());
+	return LOW;
+}
+
+uint32_t millis()
+{
+	SimCore::charge(SimCall::MILLIS);
+	return (uint32_t)(SimCore::now() / 1000000ULL);
+}
+
+uint32_t micros()
+{
+	SimCore::charge(SimCall::MICROS);
+	return (uint32_t)(SimCore::now() / 1000ULL);
+}
+
+void delay(uint32_t ms)
+{
+	SimCore::yielded();		// delay() suspends the task on the ESP8266
+	SimCore::advance(ms * 1000000ULL);
+	SimCore::resumed();
+}
+
+void delayMicroseconds(uint32_t us)
+{
+	SimCore::advance(us * 1000ULL);
+}
+
+void yield()
+{
+	SimCore::yielded();
+}
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *buf)
+{
+	sprintf(buf, "%*.*f", width, prec, val);
+	return buf;
+}
+
+void attachInterrupt(int8_t irq, void (*isr)(), int mode)
+{
+	detachInterrupt(irq);
+	if (nbrIrqs < sizeof(irqs) / sizeof(irqs[0]))
+		irqs[nbrIrqs++] = { irq, isr, mode };
+}
+
+void detachInterrupt(int8_t irq)
+{
+	for (uint8_t i = 0; i < nbrIrqs; i++)
+		if (irqs[i].irq == irq)
+		{
+			irqs[i] = irqs[--nbrIrqs];
+			return;
+		}
+}
+
+/**
+ * Idle sleep: Timer0 keeps running, so the MCU wakes at the next tick
+ * unless an attached pin falls earlier, whose ISR is then called
+ */
+void SimCore::sleep()
+{
+	uint64_t wake = (_ns / TIMER0_TICK_NS + 1) * TIMER0_TICK_NS;
+	void (*isr)() = nullptr;
+	for (uint8_t i = 0; i < nbrIrqs; i++)
+	{
+		if (irqs[i].mode != FALLING && irqs[i].mode != CHANGE) continue;
+		for (uint8_t d = 0; d < _nbrDevices; d++)
+		{
+			if (!_devices[d]->ownsPin(irqs[i].irq)) continue;
+			uint64_t t = _devices[d]->nextFallAt(irqs[i].irq, _ns);
+			if (t < wake)
+			{
+				wake = t > _ns ? t : _ns;
+				isr  = irqs[i].isr;
+			}
+		}
+	}
+	_sleptNs += wake - _ns;
+	_wakeups++;
+	advance(wake - _ns);
+	charge(SimCall::WAKEUP);
+	if (isr) isr();
+}
+
+/**
+ * Queue one byte into the 64 byte TX buffer, block while it is full
+ */
+size_t SimSerial::write(uint8_t c)
+{
+	const uint64_t bufBytes = 64;
+	SimCore::charge(SimCall::SERIAL_IO);
+	uint64_t now = SimCore::now();
+	if (_txFreeAt > now + (bufBytes - 1) * _nsPerByte)
+		SimCore::advance(_txFreeAt - (bufBytes - 1) * _nsPerByte - now);
+	now = SimCore::now();
+	_txFreeAt = (_txFreeAt > now ? _txFreeAt : now) + _nsPerByte;
+	_bytesSent++;
+	SimCore::countIo();
+	if (_echo) fputc(c, _echo);
+	if (_sink) _sink(c, _txFreeAt);    // time the byte has left the UART
+	return 1;
+}
+
+size_t SimSerial::write(const char *s)
+{
+	size_t n = 0;
+	while (*s) n += write((uint8_t)*s++);
+	return n;
+}
+
+size_t SimSerial::print(long n, int base)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%ld", n);
+	return write(buf);
+}
+
+size_t SimSerial::print(unsigned long n, int base)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", n);
+	return write(buf);
+}
+
+size_t SimSerial::print(double d, int digits)
+{
+	char buf[40];
+	snprintf(buf, sizeof(buf), "%.*f", digits, d);
+	return write(buf);
+}
+
+/**
+ * Wait until all queued bytes are on the line
+ */
+void SimSerial::flush()
+{
+	if (_txFreeAt > SimCore::now())
+		SimCore::advance(_txFreeAt - SimCore::now());
+}
+
+int SimSerial::available()
+{
+	SimCore::charge(SimCall::SERIAL_IO);
+	return (_rxHead + sizeof(_rx) - _rxTail) % sizeof(_rx);
+}
+
+int SimSerial::peek()
+{
+	return _rxHead == _rxTail ? -1 : _rx[_rxTail];
+}
+
+int SimSerial::read()
+{
+	SimCore::charge(SimCall::SERIAL_IO);
+	if (_rxHead == _rxTail) return -1;
+	char c = _rx[_rxTail];
+	_rxTail = (_rxTail + 1) % sizeof(_rx);
+	_consumed++;
+	SimCore::countIo();
+	return (uint8_t)c;
+}
+
+/**
+ * Same semantics as Stream::parseInt(): skip non-digits, stop at the first
+ * non-digit after the number or after the timeout has elapsed
+ */
+long SimSerial::parseInt()
+{
+	uint64_t deadline = SimCore::now() + _timeoutMs * 1000000ULL;
+	long v = 0;
+	bool neg = false, digits = false;
+	while (SimCore::now() < deadline)
+	{
+		int c = peek();
+		if (c < 0) { SimCore::advance(100000); yield(); continue; }
+		if (c == '-' && !digits) neg = true;
+		else if (c >= '0' && c <= '9') { v = 10 * v + (c - '0'); digits = true; }
+		else if (digits) break;
+		read();
+	}
+	return neg ? -v : v;
+}
+
+void SimSerial::inject(const char *s)
+{
+	while (*s)
+	{
+		uint16_t next = (_rxHead + 1) % sizeof(_rx);
+		if (next == _rxTail) break;  // RX buffer full, bytes are lost as on the MCU
+		_rx[_rxHead] = *s++;
+		_rxHead = next;
+	}
+}
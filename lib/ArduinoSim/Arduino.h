@@ -0,0 +1,198 @@
+/**
+ * Header       Arduino.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Thin shim of the Arduino core API for the host (native) build.
+ *              Time is virtual: it only advances when the firmware calls a
+ *              core function, each of which is charged the cost it has on the
+ *              real MCU (see SimCore::callCost). Pin accesses are routed to the
+ *              attached SimDevice (e.g. the HX711 model in SimHX711.h).
+ *              Because nothing ever sleeps, hours of firmware time pass in
+ *              seconds of host time. sleep_cpu() (avr/sleep.h) jumps to the
+ *              next wake-up and accounts the time spent asleep.
+ * 
+ * Remarks      Only the subset of the API used by this project is provided.
+ */
+#ifndef _ARDUINO_SIM_H_
+#define _ARDUINO_SIM_H_
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <functional>
+
+#define HIGH      1
+#define LOW       0
+#define INPUT     0
+#define OUTPUT    1
+#define INPUT_PULLUP 2
+#define LSBFIRST  0
+#define MSBFIRST  1
+
+#define DEC       10
+#define HEX       16
+
+// Flash access maps 1:1 to RAM on the host
+#define PROGMEM
+#define PSTR(s)               (s)
+#define F(s)                  ((const __FlashStringHelper *)(s))
+#define pgm_read_byte(addr)   (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)   (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)  (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)    (*(void * const *)(addr))
+#define snprintf_P            snprintf
+#define strcpy_P              strcpy
+#define strlen_P              strlen
+#define memcpy_P              memcpy
+class __FlashStringHelper;
+
+#define noInterrupts()          SimCore::setInterrupts(false)
+#define interrupts()            SimCore::setInterrupts(true)
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+#define CHANGE    1
+#define FALLING   2
+#define RISING    3
+#define NOT_AN_INTERRUPT        -1
+#define digitalPinToInterrupt(p) ((int8_t)(p))    // interrupt number = pin on the host
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void     pinMode(uint8_t pin, uint8_t mode);
+void     digitalWrite(uint8_t pin, uint8_t val);
+int      digitalRead(uint8_t pin);
+uint32_t millis();
+uint32_t micros();
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+void     yield();
+char    *dtostrf(double val, signed char width, unsigned char prec, char *buf);
+void     attachInterrupt(int8_t irq, void (*isr)(), int mode);
+void     detachInterrupt(int8_t irq);
+
+void setup();
+void loop();
+
+/**
+ * A peripheral attached to one or more pins of the simulated MCU
+ */
+class SimDevice
+{
+    public:
+        virtual ~SimDevice() {}
+        virtual bool ownsPin(uint8_t pin) = 0;
+        virtual void pinWritten(uint8_t pin, uint8_t level, uint64_t ns) = 0;
+        virtual int  pinRead(uint8_t pin, uint64_t ns) = 0;
+        // advance internal state up to time ns (called on every clock step)
+        virtual void advanceTo(uint64_t ns) { (void)ns; }
+        // time the device will next pull pin LOW (wakes a sleeping MCU)
+        virtual uint64_t nextFallAt(uint8_t pin, uint64_t ns) { (void)pin; (void)ns; return UINT64_MAX; }
+};
+
+/**
+ * Virtual clock and pin routing of the simulated MCU
+ */
+enum class SimCall { DIGITAL_WRITE, DIGITAL_READ, MILLIS, MICROS, SERIAL_IO, WAKEUP, NBR_CALLS };
+
+class SimCore
+{
+    public:
+        static uint64_t now() { return _ns; }
+        static void     advance(uint64_t ns);
+        static void     charge(SimCall call) { advance(_callCost[(int)call]); }
+        static void     setCallCost(SimCall call, uint32_t ns) { _callCost[(int)call] = ns; }
+        static uint32_t callCost(SimCall call) { return _callCost[(int)call]; }
+        static void     attach(SimDevice *dev);
+        static void     detachAll() { _nbrDevices = 0; }
+        static void     reset();
+        // digital and serial I/O calls so far, lets the simulator detect an idle loop()
+        static uint32_t ioCalls() { return _ioCalls; }
+        static void     countIo() { _ioCalls++; }
+        // sleep until the Timer0 tick or an attached interrupt pin falls
+        static void     sleep();
+        static uint64_t sleptNs() { return _sleptNs; }
+        static uint32_t wakeups() { return _wakeups; }
+
+        // background interrupts (e.g. the ESP8266 WiFi stack) steal durNs
+        // every periodNs while interrupts are enabled
+        static void     setBackgroundIrq(uint64_t periodNs, uint64_t durNs);
+        static void     setInterrupts(bool on);
+        static uint64_t stolenNs() { return _stolenNs; }
+        // cooperative scheduling: longest time the firmware ran without yield()
+        static void     yielded();
+        static void     resumed();
+        static uint64_t maxYieldGapNs() { return _maxYieldGap; }
+        static uint32_t wdtResets() { return _gapsOverWdt; }   // gaps longer than the 3.2 s soft WDT
+
+    private:
+        static uint64_t   _ns;
+        static uint32_t   _ioCalls;
+        static uint64_t   _sleptNs;
+        static uint32_t   _wakeups;
+        static bool       _irqOn;
+        static uint64_t   _bgPeriod, _bgDur, _bgNext, _stolenNs;
+        static uint64_t   _lastYield, _maxYieldGap;
+        static uint32_t   _gapsOverWdt;
+        static uint32_t   _callCost[(int)SimCall::NBR_CALLS];
+        static SimDevice *_devices[8];
+        static uint8_t    _nbrDevices;
+        friend void digitalWrite(uint8_t, uint8_t);
+        friend int  digitalRead(uint8_t);
+};
+
+/**
+ * Serial port with a 64 byte TX buffer which drains at the baud rate,
+ * so printing blocks exactly as long as it would on the Uno
+ */
+class SimSerial
+{
+    public:
+        void   begin(uint32_t baud) { _nsPerByte = 10ULL * 1000000000ULL / baud; }
+        void   end() {}
+        int    available();
+        int    read();
+        int    peek();
+        long   parseInt();
+        void   setTimeout(uint32_t ms) { _timeoutMs = ms; }
+        void   flush();
+        size_t write(uint8_t c);
+        size_t write(const char *s);
+
+        size_t print(const char *s)                 { return write(s); }
+        size_t print(const __FlashStringHelper *s)  { return write((const char *)s); }
+        size_t print(char c)                        { return write((uint8_t)c); }
+        size_t print(int n, int base = DEC)         { return print((long)n, base); }
+        size_t print(unsigned n, int base = DEC)    { return print((unsigned long)n, base); }
+        size_t print(long n, int base = DEC);
+        size_t print(unsigned long n, int base = DEC);
+        size_t print(double d, int digits = 2);
+        size_t println()                            { return write("\r\n"); }
+        template <typename T> size_t println(T v)   { size_t n = print(v); return n + println(); }
+        template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+        operator bool() { return true; }
+
+        // host side of the line
+        void   inject(const char *s);                // bytes the user "types"
+        void   setEcho(FILE *f) { _echo = f; }       // where transmitted bytes go
+        void   setSink(std::function<void(uint8_t c, uint64_t ns)> sink) { _sink = sink; }
+        uint64_t bytesSent() { return _bytesSent; }
+        uint32_t bytesConsumed() { return _consumed; } // bytes the firmware has read
+        bool   rxEmpty() { return _rxHead == _rxTail; }
+
+    private:
+        uint64_t _nsPerByte = 10ULL * 1000000000ULL / 9600;
+        uint64_t _txFreeAt  = 0;                      // time the TX buffer becomes empty
+        uint32_t _timeoutMs = 1000;
+        uint64_t _bytesSent = 0;
+        FILE    *_echo      = stdout;
+        std::function<void(uint8_t, uint64_t)> _sink;
+        uint32_t _consumed  = 0;
+        char     _rx[256];
+        uint16_t _rxHead = 0, _rxTail = 0;
+};
+extern SimSerial Serial;
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * Header       EEPROM.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Host replacement of the Arduino EEPROM library: 1 KB of
+ *              erased (0xFF) cells held in RAM, with the AVR get()/put()
+ *              interface and the ESP8266 begin()/commit() calls as no-ops
+ */
+#ifndef _EEPROM_SIM_H_
+#define _EEPROM_SIM_H_
+#include <Arduino.h>
+
+class EEPROMClass
+{
+    public:
+        EEPROMClass() { erase(); }
+        void     begin(size_t size) { (void)size; }
+        bool     commit() { return true; }
+        void     end() {}
+        uint16_t length() { return sizeof(_cells); }
+        uint8_t  read(int addr) { return _cells[addr]; }
+        void     write(int addr, uint8_t v) { _cells[addr] = v; }
+        void     update(int addr, uint8_t v) { _cells[addr] = v; }
+        void     erase() { memset(_cells, 0xFF, sizeof(_cells)); }
+        uint8_t *data() { return _cells; }
+
+        template <typename T> T &get(int addr, T &t)
+        {
+            memcpy(&t, &_cells[addr], sizeof(T));
+            return t;
+        }
+
+        template <typename T> const T &put(int addr, const T &t)
+        {
+            memcpy(&_cells[addr], &t, sizeof(T));
+            return t;
+        }
+
+    private:
+        uint8_t _cells[1024];
+};
+extern EEPROMClass EEPROM;
+
+#endif
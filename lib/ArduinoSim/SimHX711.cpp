@@ -0,0 +1,154 @@
+/**
+ * Class        SimHX711.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Bit-level HX711 model, see SimHX711.h
+ *
+ * References   https://cdn.sparkfun.com/datasheets/Sensors/ForceFlex/hx711_english.pdf 
+ */
+#include "SimHX711.h"
+
+constexpr uint64_t T_POWERDOWN_NS = 60000;   // PD_SCK HIGH > 60 us enters power down
+constexpr uint64_t T_HIGH_MAX_NS  = 50000;   // max PD_SCK HIGH time during readout
+constexpr uint8_t  SETTLE_CONV    = 3;       // conversions off before the 4th is valid
+
+/**
+ * Convert the differential input voltage into the 24-bit output code
+ * Full scale is +-0.5 * AVDD / gain
+ */
+int32_t SimHX711::toCode(double volts, uint8_t gainSel)
+{
+	static const double gains[] = { 128.0, 128.0, 32.0, 64.0 };
+	double fullScale = 0.5 * _avdd / gains[gainSel & 3];
+	double code = round(volts / fullScale * 8388608.0);
+	if (code >  8388607.0) code =  8388607.0;
+	if (code < -8388608.0) code = -8388608.0;
+	return (int32_t)code;
+}
+
+void SimHX711::powerUp(uint64_t ns)
+{
+	_powered     = true;
+	_gainSel     = _convGain = 1;
+	_nextConv    = ns + _period;
+	_settleLeft  = _settleTotal = SETTLE_CONV;
+	_settleRef   = 0;
+	_ready       = false;
+	_pulses      = 0;
+}
+
+void SimHX711::setConnected(bool connected)
+{
+	_connected = connected;
+	if (!connected)
+	{
+		_powered = false;
+		_ready   = false;
+	}
+	else
+	{
+		_stats.connectedAt = SimCore::now();
+		_stats.firstReadAt = 0;
+		if (!_clk) powerUp(SimCore::now());
+	}
+}
+
+/**
+ * A conversion completes at time ns
+ */
+void SimHX711::convert(uint64_t ns)
+{
+	_stats.conversions++;
+	if (_pulses > 0 && _pulses < 25) return;  // output register is being shifted out
+	if (_pulses >= 25) _pulses = 0;           // previous sample was read
+	else if (_ready) _stats.samplesMissed++;
+
+	if (_gainSel != _convGain)
+	{
+		_settleLeft = _settleTotal = SETTLE_CONV;	// like a power up, datasheet
+		_settleRef  = _latched;
+		_convGain   = _gainSel;
+	}
+
+	char chn = _convGain == 2 ? 'B' : 'A';
+	int32_t code = toCode(_input ? _input(chn, ns) : 0.0, _convGain);
+	if (_settleLeft > 0)
+	{
+		code += (int32_t)((int64_t)(_settleRef - code) * _settleLeft / (_settleTotal + 1));
+		_settleLeft--;
+	}
+	_latched   = code;
+	_latchedAt = ns;
+	_ready     = true;
+}
+
+void SimHX711::advanceTo(uint64_t ns)
+{
+	if (!_connected) return;
+	if (_powered && _clk && ns - _clkHighAt >= T_POWERDOWN_NS)
+	{
+		_powered = false;
+		_ready   = false;
+		_pulses  = 0;
+		_stats.powerDowns++;
+	}
+	while (_powered && ns >= _nextConv)
+	{
+		convert(_nextConv);
+		_nextConv += _period;
+	}
+}
+
+void SimHX711::pinWritten(uint8_t pin, uint8_t level, uint64_t ns)
+{
+	if (pin != _pinPD_SCK) return;
+	advanceTo(ns);
+	if (level && !_clk)
+	{
+		_clk = true;
+		_clkHighAt = ns;
+		if (_powered && _connected && (_ready || _pulses > 0))
+		{
+			_pulses++;
+			if (_pulses == 25)
+			{
+				_ready = false;   // 25th pulse pulls DOUT HIGH
+				_stats.samplesRead++;
+				if (_stats.firstReadAt == 0) _stats.firstReadAt = ns;
+			}
+			if (_pulses >= 25 && _pulses <= 27)
+				_gainSel = _pulses - 24;
+		}
+	}
+	else if (!level && _clk)
+	{
+		_clk = false;
+		if (!_connected) return;
+		if (!_powered)
+			powerUp(ns);
+		else if (_pulses > 0 && ns - _clkHighAt > T_HIGH_MAX_NS)
+			_stats.pulseViolations++;
+	}
+}
+
+int SimHX711::pinRead(uint8_t pin, uint64_t ns)
+{
+	if (pin != _pinDOUT) return LOW;
+	advanceTo(ns);
+	if (!_connected || !_powered) return HIGH;
+	if (_pulses >= 1 && _pulses <= 24)
+		return (_latched >> (24 - _pulses)) & 1;
+	return _ready ? LOW : HIGH;
+}
+
+/**
+ * DOUT falls when the next conversion is ready
+ */
+uint64_t SimHX711::nextFallAt(uint8_t pin, uint64_t ns)
+{
+	if (pin != _pinDOUT || !_connected) return UINT64_MAX;
+	advanceTo(ns);
+	if (!_powered || _clk) return UINT64_MAX;
+	if (_ready && _pulses == 0) return ns;
+	return _nextConv;
+}
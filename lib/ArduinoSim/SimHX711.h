@@ -0,0 +1,97 @@
+/**
+ * Header       SimHX711.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Bit-level model of the HX711 for the host build. It follows
+ *              the datasheet timing of DOUT and PD_SCK:
+ *              - a conversion completes every 100 ms (RATE = 0, 10 SPS) or
+ *                12.5 ms (RATE = 1, 80 SPS), DOUT goes LOW when data is ready
+ *              - each PD_SCK rising edge shifts out one bit, MSB first,
+ *                the 25th pulse pulls DOUT HIGH again
+ *              - 25, 26 or 27 pulses select CHN_A_128, CHN_B_32 or CHN_A_64
+ *                for the next conversion
+ *              - PD_SCK HIGH for more than 60 us powers the chip down, the
+ *                falling edge resets it to normal mode with CHN_A_128
+ *              - after power-up or a channel/gain change the output needs
+ *                4 conversions to settle (400 ms at 10 SPS): the first 3 
+ *                are pulled 3/4, 2/4 and 1/4 of the way to the previous 
+ *                code (0 after power-up), the 4th is valid
+ *              - the code saturates at 0x7FFFFF / 0x800000
+ * 
+ * Constructor  pinDOUT, pinPD_SCK  pins the model is wired to
+ * arguments    sps                 10 or 80 samples per second
+ */
+#ifndef _SIM_HX711_H_
+#define _SIM_HX711_H_
+#include <Arduino.h>
+#include <functional>
+
+class SimHX711 : public SimDevice
+{
+    public:
+        // differential input voltage [V] of channel 'A' or 'B' at time ns
+        typedef std::function<double(char chn, uint64_t ns)> Input;
+
+        struct Stats
+        {
+            uint32_t conversions     = 0;
+            uint32_t samplesRead     = 0;   // complete 24 bit readouts
+            uint32_t samplesMissed   = 0;   // conversions overwritten before they were read
+            uint32_t powerDowns      = 0;
+            uint32_t pulseViolations = 0;   // PD_SCK HIGH longer than 50 us during readout
+            uint64_t connectedAt     = 0;   // last time the chip was (re)connected
+            uint64_t firstReadAt     = 0;   // first complete readout after that
+        };
+
+        SimHX711(uint8_t pinDOUT, uint8_t pinPD_SCK, uint8_t sps = 10) :
+            _pinDOUT(pinDOUT), _pinPD_SCK(pinPD_SCK)
+        {
+            setRate(sps);
+            powerUp(0);
+        }
+
+        void     setRate(uint8_t sps) { _period = sps >= 80 ? 12500000ULL : 100000000ULL; }
+        uint64_t period() { return _period; }
+        void     setInput(Input in) { _input = in; }
+        void     setAvdd(double avdd) { _avdd = avdd; }
+        void     setConnected(bool connected);
+        bool     isPoweredUp() { return _powered && _connected; }
+        uint8_t  gainSelect() { return _gainSel; }
+        int32_t  lastCode() { return _latched; }
+        uint64_t lastConversionAt() { return _latchedAt; }
+        const Stats &stats() { return _stats; }
+
+        bool ownsPin(uint8_t pin) override { return pin == _pinDOUT || pin == _pinPD_SCK; }
+        void pinWritten(uint8_t pin, uint8_t level, uint64_t ns) override;
+        int  pinRead(uint8_t pin, uint64_t ns) override;
+        void advanceTo(uint64_t ns) override;
+        uint64_t nextFallAt(uint8_t pin, uint64_t ns) override;
+
+        int32_t toCode(double volts, uint8_t gainSel);
+
+    private:
+        void convert(uint64_t ns);
+        void powerUp(uint64_t ns);
+
+        uint8_t  _pinDOUT;
+        uint8_t  _pinPD_SCK;
+        Input    _input;
+        double   _avdd       = 5.0;
+        uint64_t _period     = 100000000ULL;
+        bool     _connected  = true;
+        bool     _powered    = false;
+        bool     _clk        = false;
+        uint64_t _clkHighAt  = 0;
+        uint64_t _nextConv   = 0;
+        uint8_t  _gainSel    = 1;     // 1 = A128, 2 = B32, 3 = A64 (CHN_GAIN order)
+        uint8_t  _convGain   = 1;     // gain the running conversion was started with
+        uint8_t  _settleLeft = 0;     // conversions until the output is settled
+        uint8_t  _settleTotal = 0;
+        int32_t  _settleRef  = 0;     // code the unsettled output starts from
+        int32_t  _latched    = 0;
+        uint64_t _latchedAt  = 0;
+        bool     _ready      = false;
+        uint8_t  _pulses     = 0;
+        Stats    _stats;
+};
+#endif
@@ -0,0 +1,90 @@
+/**
+ * Class        SimLoadCell.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Load cell model with scripted load, noise, drift, creep 
+ *              and vibration, see SimLoadCell.h
+ */
+#include "SimLoadCell.h"
+
+void SimLoadCell::step(double t, double grams)
+{
+	_keys.push_back({ t, grams, false });
+}
+
+void SimLoadCell::ramp(double t0, double t1, double grams)
+{
+	_keys.push_back({ t0, _keys.empty() ? 0.0 : _keys.back().grams, false });
+	_keys.push_back({ t1, grams, true });
+}
+
+/**
+ * Scripted load at time ns, time is expected to be non-decreasing
+ */
+double SimLoadCell::load(uint64_t ns)
+{
+	double t = ns * 1e-9;
+	if (_keys.empty() || t < _keys[0].t) return 0.0;
+	if (_cursor >= _keys.size() || _keys[_cursor].t > t) _cursor = 0;
+	while (_cursor + 1 < _keys.size() && _keys[_cursor + 1].t <= t) _cursor++;
+
+	const Key &k = _keys[_cursor];
+	if (_cursor + 1 < _keys.size() && _keys[_cursor + 1].ramp)
+	{
+		const Key &n = _keys[_cursor + 1];
+		return k.grams + (n.grams - k.grams) * (t - k.t) / (n.t - k.t);
+	}
+	return k.grams;
+}
+
+double SimLoadCell::volts(uint64_t ns)
+{
+	double t = ns * 1e-9;
+	double g = load(ns);
+
+	if (_creepFraction != 0.0)
+	{
+		double target = _creepFraction * g;
+		_creep = target + (_creep - target) * exp(-(t - _creepAt) / _creepTau);
+		_creepAt = t;
+		g += _creep;
+	}
+	g += _drift * t / 3600.0;
+	if (_vibAmplitude != 0.0) g += _vibAmplitude * sin(2.0 * M_PI * _vibHz * t);
+	if (_noise != 0.0) g += _noise * gaussian();
+	return _offset + gramsToVolts(g);
+}
+
+/**
+ * xorshift64*, identical sequence on every host
+ */
+uint64_t SimLoadCell::nextRandom()
+{
+	_rng ^= _rng >> 12;
+	_rng ^= _rng << 25;
+	_rng ^= _rng >> 27;
+	return _rng * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Standard normal deviate (Marsaglia polar method)
+ */
+double SimLoadCell::gaussian()
+{
+	if (_haveSpare)
+	{
+		_haveSpare = false;
+		return _spare;
+	}
+	double u, v, s;
+	do
+	{
+		u = (nextRandom() >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+		v = (nextRandom() >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+		s = u * u + v * v;
+	} while (s >= 1.0 || s == 0.0);
+	s = sqrt(-2.0 * log(s) / s);
+	_spare = v * s;
+	_haveSpare = true;
+	return u * s;
+}
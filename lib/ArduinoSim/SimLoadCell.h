@@ -0,0 +1,62 @@
+/**
+ * Header       SimLoadCell.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Model of a strain gauge load cell which feeds SimHX711.
+ *              The true load follows a scripted profile of steps and ramps,
+ *              the bridge output adds
+ *              - white gaussian noise        [g rms]
+ *              - linear zero drift           [g/h]
+ *              - creep, a first order lag    [fraction of the load, time constant s]
+ *              - vibration, a sine           [g amplitude, Hz]
+ *              All randomness comes from a seeded xorshift generator, so a
+ *              given seed always yields the same run on every host.
+ * 
+ * Constructor  capacity      rated load [g]
+ * arguments    sensitivity   rated output [mV/V]
+ *              excitation    bridge supply [V] (AVDD of the HX711)
+ *              offset        bridge output without load [V]
+ */
+#ifndef _SIM_LOADCELL_H_
+#define _SIM_LOADCELL_H_
+#include <Arduino.h>
+#include <vector>
+
+class SimLoadCell
+{
+    public:
+        SimLoadCell(double capacity = 1000.0, double sensitivity = 2.0, 
+                    double excitation = 5.0, double offset = 0.001) :
+            _capacity(capacity), _sensitivity(sensitivity), 
+            _excitation(excitation), _offset(offset) {}
+
+        void   seed(uint64_t seed) { _rng = seed ? seed : 0x9E3779B97F4A7C15ULL; _haveSpare = false; }
+        void   setNoise(double gramsRms) { _noise = gramsRms; }
+        void   setDrift(double gramsPerHour) { _drift = gramsPerHour; }
+        void   setCreep(double fraction, double tauSeconds) { _creepFraction = fraction; _creepTau = tauSeconds; }
+        void   setVibration(double grams, double hz) { _vibAmplitude = grams; _vibHz = hz; }
+        void   setOffset(double volts) { _offset = volts; }
+
+        void   step(double t, double grams);                // load changes to grams at t [s]
+        void   ramp(double t0, double t1, double grams);    // load moves linearly to grams
+        double load(uint64_t ns);                           // scripted true load [g]
+        double volts(uint64_t ns);                          // bridge output incl. all effects [V]
+        double gramsToVolts(double grams) { return grams / _capacity * _sensitivity * 1e-3 * _excitation; }
+        double gaussian();
+        double capacity() { return _capacity; }
+
+    private:
+        struct Key { double t; double grams; bool ramp; };
+        uint64_t nextRandom();
+
+        double   _capacity, _sensitivity, _excitation, _offset;
+        double   _noise = 0.0, _drift = 0.0;
+        double   _creepFraction = 0.0, _creepTau = 1.0, _creep = 0.0, _creepAt = 0.0;
+        double   _vibAmplitude = 0.0, _vibHz = 0.0;
+        std::vector<Key> _keys;
+        size_t   _cursor = 0;
+        uint64_t _rng = 0x9E3779B97F4A7C15ULL;
+        bool     _haveSpare = false;
+        double   _spare = 0.0;
+};
+#endif
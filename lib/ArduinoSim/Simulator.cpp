@@ -0,0 +1,271 @@
+/**
+ * Class        Simulator.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Runs the firmware against a scripted load, see Simulator.h
+ */
+#include "Simulator.h"
+#include <chrono>
+
+Simulator::Simulator(uint8_t pinDOUT, uint8_t pinPD_SCK) : _hx711(pinDOUT, pinPD_SCK)
+{
+	_hx711.setInput([this](char chn, uint64_t ns) { return chn == 'A' ? _cell.volts(ns) : 0.0; });
+}
+
+static uint64_t toNs(double s)
+{
+	return (uint64_t)(s * 1e9 + 0.5);
+}
+
+/**
+ * Unescape \n, \r and \t in the text of send/every
+ */
+static std::string unescape(const char *s)
+{
+	std::string r;
+	for (; *s; s++)
+	{
+		if (*s == '\\' && s[1])
+		{
+			s++;
+			r += *s == 'n' ? '\n' : *s == 'r' ? '\r' : *s == 't' ? '\t' : *s;
+		}
+		else r += *s;
+	}
+	return r;
+}
+
+/**
+ * Execute one line of a scenario script
+ */
+bool Simulator::command(const char *line)
+{
+	char   cmd[16] = "", text[128] = "", onOff[8] = "";
+	double a = 0, b = 0, c = 0, d = 0;
+	int    n = 0;
+
+	while (*line == ' ' || *line == '\t') line++;
+	if (*line == '#' || *line == '\0' || *line == '\n' || *line == '\r') return true;
+	if (sscanf(line, "%15s%n", cmd, &n) != 1) return false;
+	const char *args = line + n;
+
+	if      (!strcmp(cmd, "seed"))      { if (!_seedSet) _seed = strtoull(args, nullptr, 0); return true; }
+	else if (!strcmp(cmd, "duration"))  { if (sscanf(args, "%lf", &a) != 1) return false; _durationNs = toNs(a); }
+	else if (!strcmp(cmd, "sps"))       { if (sscanf(args, "%lf", &a) != 1) return false; _hx711.setRate((uint8_t)a); }
+	else if (!strcmp(cmd, "cell"))
+	{
+		if (sscanf(args, "%lf %lf %lf %lf", &a, &b, &c, &d) != 4) return false;
+		_cell = SimLoadCell(a, b, c, d);
+		_hx711.setAvdd(c);
+	}
+	else if (!strcmp(cmd, "noise"))     { if (sscanf(args, "%lf", &a) != 1) return false; _cell.setNoise(a); }
+	else if (!strcmp(cmd, "drift"))     { if (sscanf(args, "%lf", &a) != 1) return false; _cell.setDrift(a); }
+	else if (!strcmp(cmd, "creep"))     { if (sscanf(args, "%lf %lf", &a, &b) != 2) return false; _cell.setCreep(a, b); }
+	else if (!strcmp(cmd, "vibration")) { if (sscanf(args, "%lf %lf", &a, &b) != 2) return false; _cell.setVibration(a, b); }
+	else if (!strcmp(cmd, "load"))      { if (sscanf(args, "%lf %lf", &a, &b) != 2) return false; _cell.step(a, b); }
+	else if (!strcmp(cmd, "ramp"))      { if (sscanf(args, "%lf %lf %lf", &a, &b, &c) != 3) return false; _cell.ramp(a, b, c); }
+	else if (!strcmp(cmd, "send"))
+	{
+		if (sscanf(args, "%lf %127[^\r\n]", &a, text) != 2) return false;
+		_events.push_back({ toNs(a), 0, 0, unescape(text), Kind::SEND });
+	}
+	else if (!strcmp(cmd, "every"))
+	{
+		if (sscanf(args, "%lf %lf %lf %127[^\r\n]", &a, &b, &c, text) != 4 || b <= 0) return false;
+		_events.push_back({ toNs(a), toNs(b), toNs(c), unescape(text), Kind::SEND });
+	}
+	else if (!strcmp(cmd, "disconnect")) { if (sscanf(args, "%lf", &a) != 1) return false; _events.push_back({ toNs(a), 0, 0, "", Kind::DISCONNECT }); }
+	else if (!strcmp(cmd, "connect"))    { if (sscanf(args, "%lf", &a) != 1) return false; _events.push_back({ toNs(a), 0, 0, "", Kind::CONNECT }); }
+	else if (!strcmp(cmd, "irq"))       { if (sscanf(args, "%lf %lf", &a, &b) != 2) return false; _irqPeriodNs = toNs(a * 1e-6); _irqDurNs = toNs(b * 1e-6); }
+	else if (!strcmp(cmd, "echo"))      { if (sscanf(args, "%7s", onOff) != 1) return false; _echo = !strcmp(onOff, "on"); }
+	else return false;
+	return true;
+}
+
+bool Simulator::loadScript(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) 
+	{
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	char line[256];
+	int  nbr = 0;
+	bool ok = true;
+	while (fgets(line, sizeof(line), f))
+	{
+		nbr++;
+		if (!command(line))
+		{
+			fprintf(stderr, "%s:%d: bad command: %s", path, nbr, line);
+			ok = false;
+		}
+	}
+	fclose(f);
+	return ok;
+}
+
+uint64_t Simulator::nextEventAt()
+{
+	uint64_t t = UINT64_MAX;
+	for (auto &e : _events)
+		if (e.at < t) t = e.at;
+	return t;
+}
+
+/**
+ * Type the text of all events which are due
+ */
+void Simulator::dispatchEvents()
+{
+	uint64_t now = SimCore::now();
+	for (size_t i = 0; i < _events.size(); )
+	{
+		Event &e = _events[i];
+		if (e.at > now) { i++; continue; }
+		if (e.kind == Kind::DISCONNECT)
+		{
+			recordRecovery();
+			_hx711.setConnected(false);
+		}
+		else if (e.kind == Kind::CONNECT)
+		{
+			_hx711.setConnected(true);
+			_m.outages++;
+		}
+		Serial.inject(e.text.c_str());
+		for (char k : e.text) 
+			_cmds.push_back({ k, now, 0, std::string() });
+		if (e.period && e.at + e.period <= e.until) 
+		{
+			e.at += e.period;
+			i++;
+		}
+		else _events.erase(_events.begin() + i);
+	}
+}
+
+/**
+ * Time from the last reconnect to the first sample read
+ */
+void Simulator::recordRecovery()
+{
+	const SimHX711::Stats &s = _hx711.stats();
+	if (_m.outages > _recoveries.size() && s.firstReadAt >= s.connectedAt && s.firstReadAt)
+		_recoveries.push_back((s.firstReadAt - s.connectedAt) * 1e-6);
+}
+
+/**
+ * Output is attributed to the byte the firmware has read last
+ */
+void Simulator::onSerialOut(uint8_t c, uint64_t ns)
+{
+	if (_echo) fputc(c, stdout);
+	uint32_t consumed = Serial.bytesConsumed();
+	if (consumed == 0 || consumed > _cmds.size()) return;
+	Cmd &cmd = _cmds[consumed - 1];
+	cmd.doneAt = ns;
+	if (cmd.key == 'w' && cmd.out.size() < 256) cmd.out += (char)c;
+}
+
+void Simulator::run()
+{
+	_cell.seed(_seed);
+	SimCore::attach(&_hx711);
+	Serial.setEcho(nullptr);
+	Serial.setSink([this](uint8_t c, uint64_t ns) { onSerialOut(c, ns); });
+
+	auto t0 = std::chrono::steady_clock::now();
+	SimCore::setBackgroundIrq(_irqPeriodNs, _irqDurNs);
+	setup();
+	while (SimCore::now() < _durationNs)
+	{
+		dispatchEvents();
+		uint32_t io = SimCore::ioCalls();
+		loop();
+		yield();
+		_m.loopCalls++;
+
+		// loop() only polled: fast forward to the next millisecond or event
+		if (SimCore::ioCalls() == io && Serial.rxEmpty())
+		{
+			uint64_t next = (SimCore::now() / 1000000ULL + 1) * 1000000ULL;
+			uint64_t ev = nextEventAt();
+			if (ev < next) next = ev;
+			if (next > SimCore::now()) SimCore::advance(next - SimCore::now());
+		}
+	}
+	Serial.flush();
+	recordRecovery();
+	_m.realSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	_m.simSeconds  = SimCore::now() * 1e-9;
+	evaluate();
+}
+
+/**
+ * Weight printed after 'w' against the true load at the time it was printed
+ */
+void Simulator::evaluate()
+{
+	double latSum = 0.0, errSum = 0.0, errSq = 0.0;
+	for (auto &cmd : _cmds)
+	{
+		if (cmd.doneAt == 0) continue;
+		double lat = (cmd.doneAt - cmd.typedAt) * 1e-6;
+		_m.commands++;
+		latSum += lat;
+		if (lat > _m.latencyMaxMs) _m.latencyMaxMs = lat;
+
+		if (cmd.key != 'w') continue;
+		const char *p = cmd.out.c_str();
+		while (*p == '\r' || *p == ' ') p++;		// CLR_LINE
+		if (!*p || !strchr("-0123456789", *p)) continue;	// no weight, e.g. an error message
+		double err = strtod(p, nullptr) - _cell.load(cmd.doneAt);
+		_m.weighings++;
+		errSum += err;
+		errSq  += err * err;
+		if (fabs(err) > _m.errMaxAbs) _m.errMaxAbs = fabs(err);
+	}
+	for (double r : _recoveries)
+	{
+		_m.recoveryMeanMs += r / _recoveries.size();
+		if (r > _m.recoveryMaxMs) _m.recoveryMaxMs = r;
+	}
+	if (_m.commands)  _m.latencyMeanMs = latSum / _m.commands;
+	if (_m.weighings)
+	{
+		_m.errMean = errSum / _m.weighings;
+		_m.errRms  = sqrt(errSq / _m.weighings);
+	}
+}
+
+void Simulator::report(FILE *f)
+{
+	const SimHX711::Stats &s = _hx711.stats();
+	fprintf(f, "seed            = %llu\n", (unsigned long long)_seed);
+	fprintf(f, "sim_seconds     = %.3f\n", _m.simSeconds);
+	fprintf(f, "real_seconds    = %.3f\n", _m.realSeconds);
+	fprintf(f, "speedup         = %.0f\n", _m.simSeconds / (_m.realSeconds > 0 ? _m.realSeconds : 1e-9));
+	fprintf(f, "loop_calls      = %llu\n", (unsigned long long)_m.loopCalls);
+	fprintf(f, "conversions     = %u\n", s.conversions);
+	fprintf(f, "samples_read    = %u\n", s.samplesRead);
+	fprintf(f, "samples_missed  = %u\n", s.samplesMissed);
+	fprintf(f, "pulse_violations= %u\n", s.pulseViolations);
+	fprintf(f, "power_downs     = %u\n", s.powerDowns);
+	fprintf(f, "irq_stolen_ms   = %.3f\n", SimCore::stolenNs() * 1e-6);
+	fprintf(f, "yield_max_gap_ms= %.3f\n", SimCore::maxYieldGapNs() * 1e-6);
+	fprintf(f, "wdt_resets      = %u\n", SimCore::wdtResets());
+	fprintf(f, "serial_bytes    = %llu\n", (unsigned long long)Serial.bytesSent());
+	fprintf(f, "commands        = %u\n", _m.commands);
+	fprintf(f, "latency_mean_ms = %.3f\n", _m.latencyMeanMs);
+	fprintf(f, "latency_max_ms  = %.3f\n", _m.latencyMaxMs);
+	fprintf(f, "weighings       = %u\n", _m.weighings);
+	fprintf(f, "err_mean_g      = %.3f\n", _m.errMean);
+	fprintf(f, "err_rms_g       = %.3f\n", _m.errRms);
+	fprintf(f, "err_max_abs_g   = %.3f\n", _m.errMaxAbs);
+	fprintf(f, "outages         = %u\n", _m.outages);
+	fprintf(f, "recovered       = %u\n", (unsigned)_recoveries.size());
+	fprintf(f, "recovery_mean_ms= %.1f\n", _m.recoveryMeanMs);
+	fprintf(f, "recovery_max_ms = %.1f\n", _m.recoveryMaxMs);
+}
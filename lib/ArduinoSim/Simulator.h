@@ -0,0 +1,99 @@
+/**
+ * Header       Simulator.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Deterministic virtual-time simulator which runs setup() and
+ *              loop() of the firmware against SimHX711 and SimLoadCell.
+ *              A scenario script sets up the cell, the load profile and the
+ *              keys typed on the serial line, one command per line:
+ * 
+ *                seed N                   seed of all random effects
+ *                duration S               virtual seconds to run
+ *                sps 10|80                HX711 output data rate
+ *                cell CAP SENS EXC OFFS   capacity [g], [mV/V], [V], offset [V]
+ *                noise G                  white noise [g rms]
+ *                drift G                  zero drift [g/h]
+ *                creep F TAU              creep fraction of load, time constant [s]
+ *                vibration G HZ           sinusoidal vibration [g], [Hz]
+ *                load T G                 load steps to G grams at T [s]
+ *                ramp T0 T1 G             load ramps linearly to G grams
+ *                send T TEXT              TEXT is typed at T ("\n" allowed)
+ *                every T0 PERIOD T1 TEXT  TEXT is typed every PERIOD s from T0 to T1
+ *                disconnect T             HX711 loses power / a wire breaks at T
+ *                connect T                HX711 is connected again at T
+ *                irq PERIOD DUR           background interrupt of DUR us every PERIOD us
+ *                echo on|off              copy the firmware's serial output to stdout
+ *                # ...                    comment
+ * 
+ *              The report lists timing metrics (loop iterations, sample rate,
+ *              command latency) and accuracy metrics (error of every weight
+ *              printed after a 'w' against the true load) and the time from
+ *              every reconnect to the first sample the firmware reads.
+ *              Like the ESP8266 core, the simulator yields after every loop(),
+ *              the report shows the longest run without yield() and how often
+ *              it exceeded the 3.2 s soft watchdog.
+ */
+#ifndef _SIMULATOR_H_
+#define _SIMULATOR_H_
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "SimHX711.h"
+#include "SimLoadCell.h"
+
+class Simulator
+{
+    public:
+        struct Metrics
+        {
+            double   simSeconds    = 0.0;
+            double   realSeconds   = 0.0;
+            uint64_t loopCalls     = 0;
+            uint32_t commands      = 0;
+            double   latencyMeanMs = 0.0;   // key typed until last byte of the answer sent
+            double   latencyMaxMs  = 0.0;
+            uint32_t weighings     = 0;
+            double   errMean       = 0.0;   // printed weight - true load [g]
+            double   errRms        = 0.0;
+            double   errMaxAbs     = 0.0;
+            uint32_t outages       = 0;
+            double   recoveryMeanMs = 0.0;  // reconnect until first sample read
+            double   recoveryMaxMs  = 0.0;
+        };
+
+        Simulator(uint8_t pinDOUT, uint8_t pinPD_SCK);
+
+        bool     loadScript(const char *path);
+        bool     command(const char *line);
+        void     run();
+        void     report(FILE *f);
+        void     setSeed(uint64_t seed) { _seed = seed; _seedSet = true; }
+        const Metrics &metrics() { return _m; }
+        SimHX711    &hx711() { return _hx711; }
+        SimLoadCell &cell() { return _cell; }
+
+    private:
+        enum class Kind { SEND, CONNECT, DISCONNECT };
+        struct Event { uint64_t at; uint64_t period; uint64_t until; std::string text; Kind kind; };
+        struct Cmd   { char key; uint64_t typedAt; uint64_t doneAt; std::string out; };
+
+        void     dispatchEvents();
+        uint64_t nextEventAt();
+        void     onSerialOut(uint8_t c, uint64_t ns);
+        void     evaluate();
+        void     recordRecovery();
+
+        SimHX711    _hx711;
+        SimLoadCell _cell;
+        std::vector<Event> _events;
+        std::vector<Cmd>   _cmds;      // one per byte typed
+        uint64_t _durationNs = 10000000000ULL;
+        uint64_t _seed = 1;
+        bool     _seedSet = false;
+        bool     _echo = false;
+        uint64_t _irqPeriodNs = 0;
+        uint64_t _irqDurNs = 0;
+        Metrics  _m;
+        std::vector<double> _recoveries;
+};
+#endif
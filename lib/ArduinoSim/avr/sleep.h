@@ -0,0 +1,20 @@
+/**
+ * Header       avr/sleep.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Host replacement of the avr-libc sleep API. sleep_cpu() lets
+ *              the virtual clock jump to the next wake-up, see SimCore::sleep()
+ */
+#ifndef _SIM_AVR_SLEEP_H_
+#define _SIM_AVR_SLEEP_H_
+#include <Arduino.h>
+
+#define SLEEP_MODE_IDLE       0
+#define SLEEP_MODE_PWR_SAVE   3
+
+#define set_sleep_mode(mode)  do { (void)(mode); } while (0)
+#define sleep_enable()        do {} while (0)
+#define sleep_disable()       do {} while (0)
+#define sleep_cpu()           SimCore::sleep()
+
+#endif
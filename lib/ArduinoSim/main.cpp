@@ -0,0 +1,36 @@
+/**
+ * Program      main.cpp (host build)
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Runs the firmware in the virtual-time simulator 
+ * 
+ * Usage        .pio/build/native/program SCENARIO [SEED]
+ *              SCENARIO  script, see Simulator.h and the examples in sim/
+ *              SEED      overrides the seed of the script
+ */
+#ifndef SIM_NO_MAIN     // benchmarks bring their own main()
+#include <Arduino.h>
+#include "Simulator.h"
+
+#ifndef SIM_PIN_DOUT
+#define SIM_PIN_DOUT    3
+#endif
+#ifndef SIM_PIN_PD_SCK
+#define SIM_PIN_PD_SCK  2
+#endif
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s SCENARIO [SEED]\n", argv[0]);
+		return 2;
+	}
+	static Simulator sim(SIM_PIN_DOUT, SIM_PIN_PD_SCK);
+	if (argc > 2) sim.setSeed(strtoull(argv[2], nullptr, 0));
+	if (!sim.loadScript(argv[1])) return 1;
+	sim.run();
+	sim.report(stdout);
+	return 0;
+}
+#endif
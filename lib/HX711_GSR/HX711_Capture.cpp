@@ -0,0 +1,213 @@
+/**
+ * Class        HX711_Capture.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Peak hold and force curve capture with pre-trigger history,
+ *              see HX711_Capture.h
+ */
+#include "HX711_Capture.h"
+#include "HX711_Crc.h"
+#include "HX711_Profile.h"
+
+constexpr uint8_t CAPTURE_MAGIC[4] = { 'H', 'X', 'C', '2' };
+
+/**
+ * Start a new capture. The trigger level is converted to digits once,
+ * so the per-sample path compares integers only.
+ * pre + post is limited to the buffer size.
+ */
+void HX711_Capture::arm(float trigger, uint16_t pre, uint16_t post)
+{
+	double m = _scale.get_m();
+	if (pre > HX711_CAPTURE_SIZE - 1) pre = HX711_CAPTURE_SIZE - 1;
+	if (post < 1) post = 1;
+	if (post > HX711_CAPTURE_SIZE - pre) post = HX711_CAPTURE_SIZE - pre;
+	_pre = pre;
+	_postLeft = post;
+	_rawTrigger = m != 0.0 ? (int32_t)lround((trigger - _scale.get_b()) / m) : 0;
+	_peakHigh = trigger >= 0.0f;
+	_fireAbove = (m >= 0.0) == _peakHigh;
+	_head = _count = _trigger = _gaps = 0;
+	_minDt = 0;
+	_first = true;
+	_state = CAPTURE_STATE::ARMED;
+}
+
+/**
+ * Per-sample path, constant time
+ */
+void HX711_Capture::onSample(int32_t raw, uint32_t timestamp)
+{
+	if (_state == CAPTURE_STATE::ARMED)
+	{
+		bool fire = _fireAbove ? raw >= _rawTrigger : raw <= _rawTrigger;
+		put(raw, timestamp);
+		if (!fire)
+		{
+			if (_count > _pre)					// keep the last pre samples
+			{
+				_head = index(1);
+				_count--;
+			}
+			return;
+		}
+		_trigger = _count - 1;
+		_state = CAPTURE_STATE::RECORDING;
+	}
+	else if (_state == CAPTURE_STATE::RECORDING)
+	{
+		put(raw, timestamp);
+	}
+	else return;
+	if (--_postLeft == 0) _state = CAPTURE_STATE::DONE;
+}
+
+void HX711_Capture::put(int32_t raw, uint32_t timestamp)
+{
+	if (_first)
+	{
+		_first = false;
+		_rawMax = _rawMin = raw;
+		_tMax = _tMin = timestamp;
+	}
+	else
+	{
+		uint32_t dt = timestamp - _tLast;
+		if (_minDt == 0 || dt < _minDt) _minDt = dt;
+		else if (dt > _minDt + (_minDt >> 1)) _gaps++;
+		if (raw > _rawMax) { _rawMax = raw; _tMax = timestamp; }
+		if (raw < _rawMin) { _rawMin = raw; _tMin = timestamp; }
+	}
+	// values of the auto range scaled beyond 24 bits are stored halved
+	uint16_t i = index(_count);
+	bool half = raw > 0x7FFFFF || raw < -0x800000;
+	if (half) 
+	{
+		raw >>= 1;
+		_halved[i >> 3] |= 1 << (i & 7);
+	}
+	else _halved[i >> 3] &= ~(1 << (i & 7));
+	_raw[i][0] = (uint8_t)raw;
+	_raw[i][1] = (uint8_t)(raw >> 8);
+	_raw[i][2] = (uint8_t)(raw >> 16);
+	_ts[i] = (uint16_t)(timestamp >> 2);
+	_count++;
+	_tLast = timestamp;
+}
+
+/**
+ * Sample i of the capture, 0 is the oldest
+ */
+int32_t HX711_Capture::getRaw(uint16_t i)
+{
+	if (i >= _count) return 0;
+	uint8_t *b = _raw[index(i)];
+	int32_t raw = (int32_t)((uint32_t)b[2] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[0] << 8) >> 8;
+	return isHalved(index(i)) ? raw * 2 : raw;
+}
+
+/**
+ * Timestamp of sample i [us], summed back from the newest one
+ */
+uint32_t HX711_Capture::getTimestamp(uint16_t i)
+{
+	if (i >= _count) return 0;
+	uint32_t t = _tLast;
+	for (uint16_t j = _count - 1; j > i; j--)
+		t -= (uint32_t)(uint16_t)(_ts[index(j)] - _ts[index(j - 1)]) << 2;
+	return t;
+}
+
+float HX711_Capture::getMax()
+{
+	return _scale.get_m() * (_scale.get_m() >= 0.0 ? _rawMax : _rawMin) + _scale.get_b();
+}
+
+float HX711_Capture::getMin()
+{
+	return _scale.get_m() * (_scale.get_m() >= 0.0 ? _rawMin : _rawMax) + _scale.get_b();
+}
+
+float HX711_Capture::getPeak()
+{
+	return _peakHigh ? getMax() : getMin();
+}
+
+/**
+ * Timestamp of the peak [us]
+ */
+uint32_t HX711_Capture::getPeakTime()
+{
+	return _fireAbove ? _tMax : _tMin;		// the raw extreme in trigger direction
+}
+
+static uint16_t writeBytes(uint16_t crc, const void *p, uint8_t n)
+{
+	const uint8_t *b = (const uint8_t *)p;
+	for (uint8_t k = 0; k < n; k++)
+	{
+		Serial.write(b[k]);
+		crc = HX711_Crc::update(crc, b[k]);
+	}
+	return crc;
+}
+
+/**
+ * Binary dump, little endian (AVR, ESP8266 and x86 alike):
+ *   "HXC2"   magic
+ *   uint16   count, trigger index, gaps
+ *   uint32   timestamp of the first sample [us]
+ *   float    m, b    weight = m * raw + b
+ *   count *  { int24 raw, uint16 timestamp / 4 }
+ *   (count + 7) / 8 bytes, bit i (LSB first) set: raw of sample i is halved
+ *   uint16   CRC-16/CCITT (0xFFFF, 0x1021) of all the bytes before
+ * Header 22 bytes, 5 bytes per sample and the bitmap.
+ */
+void HX711_Capture::dump()
+{
+	PROFILE_START(t);
+	uint16_t crc = HX711_CRC_INIT;
+	uint32_t t0 = getTimestamp(0);
+	float    m = _scale.get_m(), b = _scale.get_b();
+	crc = writeBytes(crc, CAPTURE_MAGIC, 4);
+	crc = writeBytes(crc, &_count, 2);
+	crc = writeBytes(crc, &_trigger, 2);
+	crc = writeBytes(crc, &_gaps, 2);
+	crc = writeBytes(crc, &t0, 4);
+	crc = writeBytes(crc, &m, 4);
+	crc = writeBytes(crc, &b, 4);
+	for (uint16_t i = 0; i < _count; i++)
+	{
+		crc = writeBytes(crc, _raw[index(i)], 3);
+		crc = writeBytes(crc, &_ts[index(i)], 2);
+	}
+	for (uint16_t i = 0; i < _count; i += 8)
+	{
+		uint8_t bits = 0;
+		for (uint8_t k = 0; k < 8 && i + k < _count; k++) 
+			if (isHalved(index(i + k))) bits |= 1 << k;
+		crc = writeBytes(crc, &bits, 1);
+	}
+	writeBytes(crc, &crc, 2);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
+void HX711_Capture::print()
+{
+	char buf[96];
+	char mx[12], mn[12];
+	dtostrf(getMax(), 1, 2, mx);
+	dtostrf(getMin(), 1, 2, mn);
+	snprintf_P(buf, sizeof(buf), PSTR(", %u samples, max %s g, min %s g, peak at %lu us, gaps %u "),
+		_count, mx, mn, (unsigned long)getPeakTime(), _gaps);
+	PROFILE_START(t);
+	switch (_state)
+	{
+		case CAPTURE_STATE::IDLE:      Serial.print(F("capture idle"));      break;
+		case CAPTURE_STATE::ARMED:     Serial.print(F("capture armed"));     break;
+		case CAPTURE_STATE::RECORDING: Serial.print(F("capture recording")); break;
+		case CAPTURE_STATE::DONE:      Serial.print(F("capture done"));      break;
+	}
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
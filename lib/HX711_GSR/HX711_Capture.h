@@ -0,0 +1,95 @@
+/**
+ * Header       HX711_Capture.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Peak hold and force curve capture for pull and compression
+ *              tests. onSample() runs on the per-sample path (the sample
+ *              handler of HX711_GSR) and records every conversion into a
+ *              fixed ring buffer, so nothing is averaged away. While armed
+ *              the ring holds the last pre samples (pre-trigger history);
+ *              when the weight reaches the trigger level (falls below it
+ *              for a negative level) post samples from this one on are
+ *              recorded, then the capture is done. Max, min and the time
+ *              of the peak run from arm() to the end of the capture; the
+ *              peak is the max for a positive trigger level (pull test),
+ *              the min for a negative one (compression).
+ *              A sample takes 5 bytes: the raw value packed into 24 bits
+ *              and the timestamp as its low 16 bits in units of 4 us, the
+ *              intervals are exact as long as they are below 262 ms. Auto
+ *              ranging scales gain 64 samples beyond 24 bits, those are 
+ *              stored halved and marked in a bitmap (1 bit per sample), so
+ *              they lose their lowest bit but are not clipped. Max and min
+ *              are kept from the full values. An
+ *              interval above 1.5 times the shortest one is counted as a
+ *              gap (conversion lost). dump() writes the capture in binary
+ *              to Serial, see the format there.
+ *              HX711_CAPTURE_SIZE samples (96 on AVR: 492 bytes, 1.2 s at
+ *              80 SPS) can be changed by a build flag.
+ *
+ * Constructor  scale        the HX711_GSR whose calibration converts samples
+ */
+#ifndef _HX711_CAPTURE_H_
+#define _HX711_CAPTURE_H_
+#include "HX711_GSR.h"
+
+#ifndef HX711_CAPTURE_SIZE
+    #ifdef __AVR__
+        #define HX711_CAPTURE_SIZE 96
+    #else
+        #define HX711_CAPTURE_SIZE 1024
+    #endif
+#endif
+
+enum class CAPTURE_STATE { IDLE, ARMED, RECORDING, DONE };
+
+class HX711_Capture
+{
+    public:
+        HX711_Capture(HX711_GSR &scale) : _scale(scale) {}
+
+        void     arm(float trigger, uint16_t pre, uint16_t post);
+        void     disarm() { _state = CAPTURE_STATE::IDLE; }
+        void     onSample(int32_t raw, uint32_t timestamp);
+        CAPTURE_STATE getState() { return _state; }
+        bool     isArmed() { return _state == CAPTURE_STATE::ARMED || _state == CAPTURE_STATE::RECORDING; }
+        bool     isDone() { return _state == CAPTURE_STATE::DONE; }
+        uint16_t getCount() { return _count; }
+        uint16_t getTriggerIndex() { return _trigger; }
+        int32_t  getRaw(uint16_t i);
+        uint32_t getTimestamp(uint16_t i);
+        float    getMax();
+        float    getMin();
+        float    getPeak();
+        uint32_t getPeakTime();
+        uint16_t getGaps() { return _gaps; }
+        void     dump();
+        void     print();
+
+    private:
+        uint16_t index(uint16_t i) { return (_head + i) % HX711_CAPTURE_SIZE; }
+        void     put(int32_t raw, uint32_t timestamp);
+        bool     isHalved(uint16_t j) { return _halved[j >> 3] & (1 << (j & 7)); }
+
+        HX711_GSR &_scale;
+        uint8_t  _raw[HX711_CAPTURE_SIZE][3];   // 24 bit, little endian
+        uint16_t _ts[HX711_CAPTURE_SIZE];       // timestamp / 4, low 16 bits
+        uint8_t  _halved[(HX711_CAPTURE_SIZE + 7) / 8]; // bit set: _raw holds raw / 2
+        uint16_t _head = 0;                     // oldest sample
+        uint16_t _count = 0;
+        uint16_t _pre = 0;
+        uint16_t _postLeft = 0;
+        uint16_t _trigger = 0;                  // index of the trigger sample
+        uint16_t _gaps = 0;
+        uint32_t _minDt = 0;                    // shortest interval [us]
+        int32_t  _rawTrigger = 0;
+        int32_t  _rawMax = 0;
+        int32_t  _rawMin = 0;
+        uint32_t _tMax = 0;
+        uint32_t _tMin = 0;
+        uint32_t _tLast = 0;                    // full timestamp of the newest sample
+        bool     _first = true;                 // no sample since arm()
+        bool     _fireAbove = true;             // trigger when raw >= _rawTrigger, else <=
+        bool     _peakHigh = true;              // peak is the max weight
+        CAPTURE_STATE _state = CAPTURE_STATE::IDLE;
+};
+#endif
@@ -0,0 +1,239 @@
+/**
+ * Class        HX711_Checkweigher.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      In-motion weighing of items on a conveyor,
+ *              see HX711_Checkweigher.h
+ */
+#include "HX711_Checkweigher.h"
+#include "HX711_Profile.h"
+
+constexpr uint8_t FLAT_WINDOW = 4;      // samples which must lie within the tolerance
+constexpr uint8_t FLAT_GOOD   = 8;      // shorter flat portions lower the quality
+constexpr uint8_t ZERO_SHIFT  = 5;      // zero and noise follow the empty belt over 32 samples
+constexpr uint8_t WARMUP      = 1 << ZERO_SHIFT;
+constexpr uint8_t TOL_STEPS   = 4;      // the tolerance is doubled up to 3 times
+
+/**
+ * The belt must be empty at the start, the first 32 samples are the zero:
+ * the chip may still settle during the first half, the second is averaged
+ */
+void HX711_Checkweigher::start(float enterLevel, float maxError)
+{
+	double m = fabs(_scale.get_m());
+	_sign = _scale.get_m() >= 0.0 ? 1 : -1;
+	_enter = m > 0.0 ? (int32_t)lround(enterLevel / m) : 0;
+	_minTol = m > 0.0 ? (int32_t)lround(maxError / m) : 0;
+	_maxError = maxError;
+	_qHead = _qTail = 0;
+	_number = _lost = 0;
+	_inItem = false;
+	_warmup = 0;
+	_running = true;
+}
+
+/**
+ * Per-sample path: zero tracking or collecting the pulse, 
+ * the evaluation when the item has left
+ */
+void HX711_Checkweigher::onSample(int32_t raw, uint32_t timestamp)
+{
+	if (!_running) return;
+	if (_warmup < WARMUP)					// follow the first half, then average
+	{
+		uint8_t k = ++_warmup - WARMUP / 2;
+		if (_warmup <= WARMUP / 2)
+		{
+			_zero16 = raw * 16;
+			_mad16 = 0;
+			return;
+		}
+		int32_t dev = raw * 16 - _zero16;
+		_zero16 += dev / (k + 1);
+		_mad16 += ((dev < 0 ? -dev : dev) - _mad16) / k;
+		return;
+	}
+	int32_t d = (raw - _zero16 / 16) * _sign;
+	if (!_inItem)
+	{
+		if (d < _enter)
+		{
+			int32_t dev = raw * 16 - _zero16;
+			int32_t adev = dev < 0 ? -dev : dev;
+			if (adev / 16 <= tolerance())		// empty belt, not the flanks of an item
+			{
+				_zero16 += dev >> ZERO_SHIFT;
+				_mad16 += (adev - _mad16) >> ZERO_SHIFT;
+			}
+			return;
+		}
+		_inItem = true;
+		_n = _pulse = 0;
+		_tFirst = timestamp;
+	}
+	else if (d < _enter / 2)
+	{
+		_inItem = false;
+		if (_pulse >= FLAT_WINDOW) evaluate();	// shorter ones are spikes
+		return;
+	}
+	if (_n < HX711_ITEM_SAMPLES) _buf[_n++] = raw;
+	if (_pulse < 0xFFFF) _pulse++;
+	_tLast = timestamp;
+}
+
+/**
+ * 5 noise sigmas (sigma = 1.25 * MAD), at least maxError [digits]
+ */
+int32_t HX711_Checkweigher::tolerance()
+{
+	int32_t tol = _mad16 * 25 / 64;
+	return tol < _minTol ? _minTol : tol;
+}
+
+/**
+ * Flat portion, interquartile mean and quality of the pulse in _buf
+ */
+void HX711_Checkweigher::evaluate()
+{
+	PROFILE_START(t);
+	float   zero = _zero16 / 16.0f;
+	int32_t z = _zero16 / 16;
+	int32_t tol = tolerance();
+
+	int32_t peak = 0;
+	for (uint16_t i = 0; i < _n; i++)
+		if ((_buf[i] - z) * _sign > peak) peak = (_buf[i] - z) * _sign;
+
+	// a wider tolerance if the item has not settled, the spread lowers the quality
+	uint16_t bs = 0, bl = 0;
+	for (uint8_t k = 0; k < TOL_STEPS && bl < FLAT_WINDOW; k++, tol *= 2)
+		findFlat(tol, peak, bs, bl);
+	bool flat = bl >= FLAT_WINDOW;
+	uint16_t mid2 = flat ? 2 * bs + bl - 1 : _pulse - 1;	// twice the index of the middle
+	if (!flat)							// no flat portion, the samples above half the peak
+	{
+		bs = bl = 0;
+		for (uint16_t i = 0; i < _n; i++)
+			if ((_buf[i] - z) * _sign >= peak / 2) _buf[bl++] = _buf[i];
+	}
+
+	int32_t *v = _buf + bs;
+	sort(v, bl);
+	uint16_t q = bl / 4;
+	int64_t sum = 0;							// relative to the zero, no float cancellation
+	for (uint16_t i = q; i < bl - q; i++) sum += v[i] - z;
+	float level = (float)sum / (bl - 2 * q) + (z - zero);
+	float sigma = (v[(3 * bl) / 4 < bl ? (3 * bl) / 4 : bl - 1] - v[bl / 4]) / 1.349f;
+	double m = _scale.get_m();
+
+	HX711_Item item;
+	item.weight = m * level;
+	item.stdErr = 1.1f * sigma * fabs(m) / sqrt((float)bl);
+	item.timestamp = _tFirst + (uint32_t)((uint64_t)(_tLast - _tFirst) * mid2 / (2 * (_pulse - 1)));
+	item.number = ++_number;
+	item.samples = _pulse;
+	item.flat = flat ? bl : 0;
+	item.overflow = _pulse > HX711_ITEM_SAMPLES;
+	float quality = flat ? 1.0f - item.stdErr / _maxError : 0.0f;
+	if (quality < 0.0f) quality = 0.0f;
+	if (bl < FLAT_GOOD) quality *= (float)bl / FLAT_GOOD;
+	if (item.overflow) quality /= 2.0f;
+	item.quality = (uint8_t)lround(100.0f * quality);
+
+	uint8_t next = (_qHead + 1) % HX711_ITEM_QUEUE;
+	if (next == _qTail) _lost++;
+	else
+	{
+		_queue[_qHead] = item;
+		_qHead = next;
+	}
+	PROFILE_LAP(ProfileStage::FILTER, t);
+}
+
+/**
+ * Longest run of overlapping windows of FLAT_WINDOW samples which lie
+ * within tol and above half the peak
+ */
+void HX711_Checkweigher::findFlat(int32_t tol, int32_t peak, uint16_t &bs, uint16_t &bl)
+{
+	int32_t z = _zero16 / 16;
+	uint16_t rs = 0, re = 0;
+	bool run = false;
+	bl = 0;
+	for (uint16_t i = 0; i + FLAT_WINDOW <= _n; i++)
+	{
+		int32_t lo = _buf[i], hi = _buf[i];
+		for (uint8_t k = 1; k < FLAT_WINDOW; k++)
+		{
+			if (_buf[i + k] < lo) lo = _buf[i + k];
+			if (_buf[i + k] > hi) hi = _buf[i + k];
+		}
+		int32_t low = (_sign > 0 ? lo : hi) - z;
+		if (hi - lo > tol || low * _sign < peak / 2) continue;
+		if (run && i <= re) re = i + FLAT_WINDOW;
+		else
+		{
+			rs = i;
+			re = i + FLAT_WINDOW;
+			run = true;
+		}
+		if (re - rs > bl)
+		{
+			bs = rs;
+			bl = re - rs;
+		}
+	}
+}
+
+/**
+ * Insertion sort, the flat portion is short and mostly in order
+ */
+void HX711_Checkweigher::sort(int32_t *v, uint16_t n)
+{
+	for (uint16_t i = 1; i < n; i++)
+	{
+		int32_t x = v[i];
+		uint16_t j = i;
+		for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+		v[j] = x;
+	}
+}
+
+HX711_Item HX711_Checkweigher::getItem()
+{
+	HX711_Item item = {};
+	if (_qHead == _qTail) return item;
+	item = _queue[_qTail];
+	_qTail = (_qTail + 1) % HX711_ITEM_QUEUE;
+	return item;
+}
+
+/**
+ * Tracked zero of the empty belt [g]
+ */
+float HX711_Checkweigher::getZero()
+{
+	return _scale.get_m() * (_zero16 / 16.0) + _scale.get_b();
+}
+
+/**
+ * Noise of the empty belt, standard deviation [g]
+ */
+float HX711_Checkweigher::getNoise()
+{
+	return 1.25 * _mad16 / 16.0 * fabs(_scale.get_m());
+}
+
+void HX711_Checkweigher::print(const HX711_Item &item)
+{
+	char buf[96];
+	char w[12], e[12];
+	dtostrf(item.weight, 1, 2, w);
+	dtostrf(item.stdErr, 1, 2, e);
+	snprintf_P(buf, sizeof(buf), PSTR("\r\nitem %u: %s +- %s g, quality %u, flat %u of %u samples%s "),
+		item.number, w, e, item.quality, item.flat, item.samples, item.overflow ? ", overflow" : "");
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
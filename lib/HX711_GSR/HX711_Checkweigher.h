@@ -0,0 +1,101 @@
+/**
+ * Header       HX711_Checkweigher.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      In-motion weighing of items passing the cell on a conveyor.
+ *              onSample() runs on the per-sample path (the sample handler
+ *              of HX711_GSR). While the belt is empty it tracks the zero
+ *              and the noise (mean absolute deviation) of the empty belt
+ *              from the samples within the tolerance below.
+ *              An item enters when the weight reaches the enter level and
+ *              leaves when it falls below half of it; its samples are kept
+ *              in a buffer of HX711_ITEM_SAMPLES (64 on AVR: 0.8 s at 80 SPS).
+ *              When the item has left, the flat portion of the pulse is
+ *              picked: the longest run of samples in which every 4
+ *              consecutive ones lie within 5 noise sigmas (at least
+ *              maxError); if the item has not settled the tolerance is
+ *              doubled up to 3 times, failing that the samples above half
+ *              the peak are taken (quality 0). The weight is the interquartile mean of the flat
+ *              portion, robust against the bounce of the item and the
+ *              ramps; its standard error follows from the interquartile
+ *              range. The quality (0 .. 100) falls with the standard error
+ *              relative to maxError and with a flat portion shorter than
+ *              8 samples, it is halved if the item overflowed the buffer.
+ *              Results wait in a queue of 4 for the loop.
+ *              The belt must be empty at start(), the first 32 samples
+ *              give the zero.
+ *              The evaluation sorts the flat portion in place, about 1 ms
+ *              for 64 samples on the Uno, well within one conversion.
+ *
+ * Constructor  scale        the HX711_GSR whose calibration converts samples
+ */
+#ifndef _HX711_CHECKWEIGHER_H_
+#define _HX711_CHECKWEIGHER_H_
+#include "HX711_GSR.h"
+
+#ifndef HX711_ITEM_SAMPLES
+    #ifdef __AVR__
+        #define HX711_ITEM_SAMPLES 64
+    #else
+        #define HX711_ITEM_SAMPLES 256
+    #endif
+#endif
+constexpr uint8_t HX711_ITEM_QUEUE = 4;
+
+struct HX711_Item
+{
+    float    weight;          // [g]
+    float    stdErr;          // standard error of the weight [g]
+    uint32_t timestamp;       // middle of the flat portion [us]
+    uint16_t number;
+    uint16_t samples;         // samples of the whole pulse
+    uint16_t flat;            // samples of the flat portion
+    uint8_t  quality;         // 0 .. 100
+    bool     overflow;        // pulse longer than the buffer
+};
+
+class HX711_Checkweigher
+{
+    public:
+        HX711_Checkweigher(HX711_GSR &scale) : _scale(scale) {}
+
+        void     start(float enterLevel, float maxError);
+        void     stop() { _running = false; }
+        bool     isRunning() { return _running; }
+        void     onSample(int32_t raw, uint32_t timestamp);
+        bool     available() { return _qHead != _qTail; }
+        HX711_Item getItem();
+        uint16_t getItems() { return _number; }
+        uint16_t getLost() { return _lost; }
+        float    getZero();
+        float    getNoise();
+        void     print(const HX711_Item &item);
+
+    private:
+        void     evaluate();
+        int32_t  tolerance();
+        void     findFlat(int32_t tol, int32_t peak, uint16_t &bs, uint16_t &bl);
+        void     sort(int32_t *v, uint16_t n);
+
+        HX711_GSR &_scale;
+        int32_t  _buf[HX711_ITEM_SAMPLES];
+        HX711_Item _queue[HX711_ITEM_QUEUE];
+        uint8_t  _qHead = 0;
+        uint8_t  _qTail = 0;
+        uint16_t _n = 0;
+        uint16_t _pulse = 0;                    // samples of the pulse, also beyond the buffer
+        uint16_t _number = 0;
+        uint16_t _lost = 0;                     // results dropped, queue full
+        int32_t  _zero16 = 0;                   // zero of the empty belt [digits * 16]
+        int32_t  _mad16 = 0;                    // its mean absolute deviation [digits * 16]
+        int32_t  _enter = 0;                    // enter level [digits], leave at half of it
+        int32_t  _minTol = 0;                   // maxError [digits]
+        int8_t   _sign = 1;                     // of the slope, loads are positive
+        float    _maxError = 1.0f;
+        uint32_t _tFirst = 0;
+        uint32_t _tLast = 0;
+        bool     _inItem = false;
+        uint8_t  _warmup = 0;                   // samples of the zero at the start
+        bool     _running = false;
+};
+#endif
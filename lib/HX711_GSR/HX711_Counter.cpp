@@ -0,0 +1,136 @@
+/**
+ * Class        HX711_Counter.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Piece counting in the raw domain, see HX711_Counter.h
+ */
+#include "HX711_Counter.h"
+#include "HX711_Profile.h"
+
+HX711_Counter::HX711_Counter(HX711_GSR &scale, uint8_t window) : _scale(scale)
+{
+	_window = window < 1 ? 1 : window > HX711_COUNT_WINDOW ? HX711_COUNT_WINDOW : window;
+}
+
+/**
+ * Per-sample path: slide the filter, average, count, start a refinement
+ */
+void HX711_Counter::onSample(int32_t raw, uint32_t timestamp)
+{
+	(void)timestamp;
+	_sum += raw - (_filled == _window ? _ring[_head] : 0);
+	_ring[_head] = raw;
+	_head = (_head + 1) % _window;
+	if (_filled < _window) _filled++;
+
+	if (_acqN > 0)
+	{
+		_acqSum += raw;
+		if (raw < _acqMin) _acqMin = raw;
+		if (raw > _acqMax) _acqMax = raw;
+		if (++_acqN > HX711_COUNT_AVERAGE) finish();
+	}
+	if (_filled < _window || _pieces == 0) return;
+
+	int64_t num = tared() * _pieces;
+	int64_t den = (int64_t)_unit * _window;
+	_count = divRound(num, den);
+	if (!_autoRefine || _acqN > 0 || _count <= _pieces || _count > 2L * _pieces || _count > 0xFFFF) return;
+	int64_t rem = num - _count * den;			// fraction * den
+	if (rem < 0) rem = -rem;
+	if (rem * 10 > 3 * (den < 0 ? -den : den) || !isStable()) return;
+	acquire(_count, true);
+}
+
+/**
+ * Start averaging the next HX711_COUNT_AVERAGE samples, pieces 0 tares
+ */
+bool HX711_Counter::acquire(uint16_t pieces, bool refine)
+{
+	if (_acqN > 0) return false;
+	_acqSum = 0;
+	_acqMin = INT32_MAX;
+	_acqMax = INT32_MIN;
+	_acqPieces = pieces;
+	_acqRefine = refine;
+	_acqN = 1;
+	return true;
+}
+
+/**
+ * The average is taken if the load was stable, a refinement only if it
+ * still rounds to the count it was started with
+ */
+void HX711_Counter::finish()
+{
+	_acqN = 0;
+	_failed = (_acqMax - _acqMin) * fabs(_scale.get_m()) > _stableGrams;
+	if (_failed) return;
+	if (_acqPieces == 0)
+	{
+		_zero = _acqSum;
+		_count = 0;
+		return;
+	}
+	int32_t unit = _acqSum - _zero;
+	if (_acqRefine && divRound((int64_t)unit * _pieces, _unit) != _acqPieces) return;
+	_failed = unit == 0;
+	if (_failed) return;
+	_unit = unit;
+	_refinements = _acqRefine ? _refinements + 1 : 0;
+	_pieces = _acqPieces;
+	_count = _pieces;
+}
+
+/**
+ * num / den rounded half away from zero
+ */
+int32_t HX711_Counter::divRound(int64_t num, int64_t den)
+{
+	if (den < 0)
+	{
+		num = -num;
+		den = -den;
+	}
+	return num >= 0 ? (int32_t)((num + den / 2) / den) : -(int32_t)((-num + den / 2) / den);
+}
+
+/**
+ * All samples of the window within the stability band
+ */
+bool HX711_Counter::isStable()
+{
+	if (_filled < _window) return false;
+	int32_t lo = _ring[0], hi = _ring[0];
+	for (uint8_t i = 1; i < _window; i++)
+	{
+		if (_ring[i] < lo) lo = _ring[i];
+		if (_ring[i] > hi) hi = _ring[i];
+	}
+	return (hi - lo) * fabs(_scale.get_m()) <= _stableGrams;
+}
+
+float HX711_Counter::getCountReal()
+{
+	return _pieces ? (float)tared() * _pieces / ((float)_unit * _window) : 0.0f;
+}
+
+/**
+ * Mean weight of one piece [g]
+ */
+float HX711_Counter::getUnitWeight()
+{
+	return _pieces ? _scale.get_m() * _unit / ((double)_pieces * HX711_COUNT_AVERAGE) : 0.0f;
+}
+
+void HX711_Counter::print()
+{
+	char buf[88];
+	char u[14];
+	dtostrf(getUnitWeight(), 1, 5, u);
+	snprintf_P(buf, sizeof(buf), PSTR("\rcount %ld pcs %c, unit %s g from %u pcs, %u refinements "),
+		(long)_count, isStable() ? ' ' : '~', u, _pieces, _refinements);
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
@@ -0,0 +1,83 @@
+/**
+ * Header       HX711_Counter.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Piece counting by weight. Everything stays in raw digits:
+ *              the count filter is a sliding sum over the last window
+ *              samples, updated with every sample, and the unit weight is
+ *              kept as the ratio of two integers, the tared sum of the
+ *              sample pieces and their number. So neither the 0.1 g rounding
+ *              of getWeight() nor float rounding limits the resolution of
+ *              light parts. The count is the rounded quotient, computed in
+ *              64-bit integers on every sample.
+ *              tare() and sample() average the next HX711_COUNT_AVERAGE
+ *              samples (6.4 s at 10 SPS), 2 times less noise than the
+ *              window of 16; they fail if the load is not stable meanwhile.
+ *              With auto refine on, a stable count between the reference
+ *              count and its double, within 0.3 pieces of a whole number,
+ *              is averaged the same way and becomes the new reference if it
+ *              still rounds to the same count: the unit weight is averaged
+ *              over more and more pieces while they are added.
+ *              Stable means all samples lie within the stability band
+ *              (0.2 g by default).
+ *
+ * Constructor  scale        the HX711_GSR whose calibration converts digits
+ * arguments    window       samples of the count filter, 1 .. 16
+ */
+#ifndef _HX711_COUNTER_H_
+#define _HX711_COUNTER_H_
+#include "HX711_GSR.h"
+
+constexpr uint8_t HX711_COUNT_WINDOW  = 16;
+constexpr uint8_t HX711_COUNT_AVERAGE = 64;
+
+class HX711_Counter
+{
+    public:
+        HX711_Counter(HX711_GSR &scale, uint8_t window = HX711_COUNT_WINDOW);
+
+        void     onSample(int32_t raw, uint32_t timestamp);
+        bool     tare() { return acquire(0, false); }
+        bool     sample(uint16_t pieces) { return pieces > 0 && acquire(pieces, false); }
+        void     clear() { _pieces = _refinements = 0; _count = 0; _acqN = 0; }
+        bool     isBusy() { return _acqN > 0; }
+        bool     hasFailed() { return _failed; }
+        void     setAutoRefine(bool on) { _autoRefine = on; }
+        void     setStability(float grams) { _stableGrams = grams; }
+        bool     isStable();
+        bool     isReady() { return _pieces > 0; }
+        int32_t  getCount() { return _count; }
+        float    getCountReal();
+        float    getUnitWeight();
+        uint16_t getReference() { return _pieces; }
+        uint16_t getRefinements() { return _refinements; }
+        void     print();
+
+    private:
+        bool     acquire(uint16_t pieces, bool refine);
+        void     finish();
+        int64_t  tared() { return (int64_t)_sum * HX711_COUNT_AVERAGE - (int64_t)_zero * _window; }
+        int32_t  divRound(int64_t num, int64_t den);
+
+        HX711_GSR &_scale;
+        int32_t  _ring[HX711_COUNT_WINDOW];
+        uint8_t  _window;
+        uint8_t  _head = 0;
+        uint8_t  _filled = 0;
+        int32_t  _sum = 0;                      // of the window [digits * window]
+        int32_t  _zero = 0;                     // tare [digits * average]
+        int32_t  _unit = 0;                     // tared reference pieces, same unit
+        int32_t  _acqSum = 0;                   // averaging for tare, sample and refine
+        int32_t  _acqMin = 0;
+        int32_t  _acqMax = 0;
+        uint8_t  _acqN = 0;                     // samples so far, 0 = idle
+        uint16_t _acqPieces = 0;                // 0 = tare
+        bool     _acqRefine = false;
+        bool     _failed = false;
+        uint16_t _pieces = 0;                   // reference count, 0 = no unit weight
+        uint16_t _refinements = 0;
+        int32_t  _count = 0;
+        float    _stableGrams = 0.2f;
+        bool     _autoRefine = true;
+};
+#endif
@@ -0,0 +1,21 @@
+/**
+ * Class        HX711_Crc.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      CRC-16/CCITT, see HX711_Crc.h
+ */
+#include "HX711_Crc.h"
+
+uint16_t HX711_Crc::update(uint16_t crc, uint8_t b)
+{
+	crc ^= (uint16_t)b << 8;
+	for (uint8_t k = 0; k < 8; k++) crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+	return crc;
+}
+
+uint16_t HX711_Crc::of(const void *p, uint16_t n, uint16_t crc)
+{
+	const uint8_t *b = (const uint8_t *)p;
+	while (n--) crc = update(crc, *b++);
+	return crc;
+}
@@ -0,0 +1,22 @@
+/**
+ * Header       HX711_Crc.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      CRC-16/CCITT (start 0xFFFF, polynomial 0x1021, MSB first,
+ *              no final xor) of the binary frames, capture dumps and log
+ *              blocks. update() adds one byte, so a frame can be checked 
+ *              while it is written; of() runs over a buffer.
+ */
+#ifndef _HX711_CRC_H_
+#define _HX711_CRC_H_
+#include <Arduino.h>
+
+constexpr uint16_t HX711_CRC_INIT = 0xFFFF;
+
+class HX711_Crc
+{
+    public:
+        static uint16_t update(uint16_t crc, uint8_t b);
+        static uint16_t of(const void *p, uint16_t n, uint16_t crc = HX711_CRC_INIT);
+};
+#endif
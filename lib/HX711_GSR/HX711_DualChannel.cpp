@@ -0,0 +1,113 @@
+/**
+ * Class        HX711_DualChannel.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Alternating channel A / channel B acquisition, 
+ *              see HX711_DualChannel.h
+ */
+#include "HX711_DualChannel.h"
+
+void HX711_DualChannel::start()
+{
+	_a.sum = _a.n = _a.samples = 0;
+	_b.sum = _b.n = _b.samples = 0;
+	_a.fresh = _b.fresh = false;
+	_discarded = 0;
+	_primed    = false;
+	_selected  = &_a;
+	_startedAt = millis();
+	_running   = true;
+}
+
+/**
+ * Back to single channel operation with the channel A setting
+ */
+void HX711_DualChannel::stop()
+{
+	_scale.set_chnGain(_a.chnGain);
+	_running = false;
+}
+
+/**
+ * Read the next conversion if one is ready. The value belongs to the 
+ * channel selected at the previous readout; the pulses of this readout 
+ * select the channel of the next conversion: the same one while it is
+ * still settling, the other one after a valid sample.
+ */
+bool HX711_DualChannel::update()
+{
+	if (!_running || !_scale.isReady()) return false;
+
+	Channel *conv = _selected;
+	bool valid = _primed && _sinceSwitch >= _discard;
+	Channel *next = valid ? (conv == &_a ? &_b : &_a) : conv;
+
+	uint32_t recoveries = _scale.get_health().recoveries;
+	_scale.set_chnGain(next->chnGain);
+	int32_t v = _scale.getRawValue();
+	HX711_STATUS status = _scale.get_status();
+	if (status == HX711_STATUS::TIMEOUT || status == HX711_STATUS::POWERED_DOWN || 
+		_scale.get_health().recoveries != recoveries)
+	{
+		_primed = false;		// a recovery restarts the HX711 on CHN_A_128
+		_selected = &_a;
+		_sinceSwitch = 0;
+		return false;
+	}
+
+	_sinceSwitch = _primed && next == conv ? _sinceSwitch + 1 : 0;
+	_selected = next;
+	if (!valid)
+	{
+		if (_primed) _discarded++;
+		_primed = true;			// the conversion in progress uses next
+		return false;
+	}
+
+	conv->samples++;
+	conv->sum += v;
+	if (++conv->n < _nbr) return false;
+	conv->raw   = conv->sum / _nbr;
+	conv->sum   = 0;
+	conv->n     = 0;
+	conv->fresh = true;
+	return true;
+}
+
+bool HX711_DualChannel::available(char chn)
+{
+	return ch(chn).fresh;
+}
+
+int32_t HX711_DualChannel::getRawValue(char chn)
+{
+	Channel &c = ch(chn);
+	c.fresh = false;
+	return c.raw;
+}
+
+/**
+ * Weight of the last reading of chn with the channel's own calibration
+ */
+double HX711_DualChannel::getWeight(char chn)
+{
+	Channel &c = ch(chn);
+	c.fresh = false;
+	if (c.vref == c.v0) return 0.0;
+	double w = (double)c.wref * (double)(c.raw - c.v0) / (double)(c.vref - c.v0);
+	return round(10.0 * w) / 10.0;
+}
+
+void HX711_DualChannel::setCalibration(char chn, int32_t v0, int32_t vref, int32_t wref)
+{
+	Channel &c = ch(chn);
+	c.v0   = v0;
+	c.vref = vref;
+	c.wref = wref;
+}
+
+float HX711_DualChannel::getSampleRate(char chn)
+{
+	uint32_t ms = millis() - _startedAt;
+	return ms ? 1000.0f * ch(chn).samples / ms : 0.0f;
+}
@@ -0,0 +1,73 @@
+/**
+ * Header       HX711_DualChannel.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Two load cells on one HX711, one on channel A (gain 128), 
+ *              the other on channel B (gain 32), sampled alternately.
+ *              The pulses after a readout select the channel of the next
+ *              conversion, so each value read was converted with the channel
+ *              selected one readout earlier. The pipeline is tracked here:
+ *              every value goes to the channel it was converted with, and
+ *              the first discard conversions after a channel change are
+ *              thrown away while the digital filter of the HX711 settles.
+ *              Each channel has its own calibration and averages nbr 
+ *              samples. update() must be called from loop(), it never 
+ *              blocks. The datasheet gives 4 conversions of settling after
+ *              a channel change, so the default discard is 3: each channel
+ *              gets an eighth of the conversion rate (1.25 SPS at 10 SPS,
+ *              10 SPS at 80 SPS). Fewer discards are faster but mix the
+ *              other channel into the value.
+ * 
+ * Constructor  scale        the HX711_GSR to drive
+ * arguments    nbr          samples averaged per channel reading
+ *              discard      conversions dropped after a channel change
+ */
+#ifndef _HX711_DUAL_CHANNEL_H_
+#define _HX711_DUAL_CHANNEL_H_
+#include "HX711_GSR.h"
+
+class HX711_DualChannel
+{
+    public:
+        HX711_DualChannel(HX711_GSR &scale, uint8_t nbr, uint8_t discard = 3) :
+            _scale(scale), _nbr(nbr), _discard(discard) {}
+
+        void     start();
+        void     stop();
+        bool     isRunning() { return _running; }
+        bool     update();              // true when a channel completed a reading
+        bool     available(char chn);   // new reading of 'A' or 'B', cleared by getRawValue()
+        int32_t  getRawValue(char chn);
+        double   getWeight(char chn);
+        void     setCalibration(char chn, int32_t v0, int32_t vref, int32_t wref);
+        float    getSampleRate(char chn);   // valid samples per second since start()
+        uint32_t getSamples(char chn) { return ch(chn).samples; }
+        uint32_t getDiscarded() { return _discarded; }
+        void     setDiscard(uint8_t discard) { _discard = discard; }
+
+    private:
+        struct Channel
+        {
+            CHN_GAIN chnGain;
+            int32_t  v0, vref, wref;
+            int32_t  sum;
+            uint8_t  n;
+            int32_t  raw;
+            uint32_t samples;
+            bool     fresh;
+        };
+        Channel &ch(char chn) { return chn == 'B' ? _b : _a; }
+
+        HX711_GSR &_scale;
+        uint8_t  _nbr;
+        uint8_t  _discard;
+        bool     _running = false;
+        bool     _primed  = false;     // channel of the conversion in progress is known
+        Channel *_selected = nullptr;  // channel selected at the last readout
+        uint8_t  _sinceSwitch = 0;     // conversions read since the selection changed
+        uint32_t _startedAt = 0;
+        uint32_t _discarded = 0;
+        Channel  _a = { CHN_GAIN::CHN_A_128, 0, 0, -1, 0, 0, 0, 0, false };
+        Channel  _b = { CHN_GAIN::CHN_B_32,  0, 0, -1, 0, 0, 0, 0, false };
+};
+#endif
@@ -10,13 +10,38 @@
  * Remarks      To calibrate the scale only two measuremnts with two  
  *              different weights are needed 
  * 
+ *              ESP8266: all waiting loops yield(), the clocking code sits in
+ *              IRAM and runs with interrupts disabled. The longest stretch 
+ *              without yield() is one readout, about 120 us (27 pulses of 
+ *              2 + 2 us), far below the 3.2 s soft watchdog and the few ms 
+ *              the WiFi stack tolerates.
+ * 
  * References   https://github.com/bogde/HX711 
  *              https://github.com/aguegu/ardulibs/blob/master/hx711/hx711.cpp
  *              https://cdn.sparkfun.com/datasheets/Sensors/ForceFlex/hx711_english.pdf 
  */
 #include "HX711_GSR.h"
+#include "HX711_Profile.h"
+#include "HX711_Timestamp.h"
+#if defined(ESP8266) || defined(SIM_ESP8266)
+#define HX711_ESP_BACKEND
+#elif defined(__AVR__) || defined(ARDUINO_SIM)
+#include <avr/sleep.h>
+#define HAVE_SLEEP_WAIT
+#endif
+
+#ifdef HX711_ESP_BACKEND
+#define HX711_IRAM  IRAM_ATTR		// clocking runs from IRAM, no flash cache miss stretches a pulse
+#else
+#define HX711_IRAM
+#endif
+
+constexpr uint16_t SETTLE_MS = 400;	// settling time after power up at 10 SPS
+constexpr int32_t  RANGE_UP   = 7549747;	// 90 % of full scale at gain 128: switch to 64
+constexpr int32_t  RANGE_DOWN = 3355443;	// 40 % of full scale at gain 64 (80 % at 128): back to 128
+constexpr uint8_t  RANGE_SETTLE = 3;		// conversions after a gain change before the 4th is valid
 
-uint8_t readByte(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) 
+HX711_IRAM uint8_t readByte(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) 
 {
     uint8_t value = 0;
 
@@ -34,21 +59,111 @@ uint8_t readByte(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
     return value;
 }
 
+#ifdef HAVE_SLEEP_WAIT
 /**
- * Read the raw value from the HX711
+ * DOUT falling edge, its only purpose is to wake the MCU
  */
-int32_t HX711_GSR::getRawValue()
+static HX711_IRAM void doutFalling() {}
+#endif
+
+/**
+ * Wait until the HX711 is ready (DOUT LOW), at most _timeoutMs
+ * BUSY   spins on digitalRead()
+ * SLEEP  idles the MCU until the DOUT falling edge or the next Timer0 tick 
+ *        (millis() keeps counting), DOUT must be an external interrupt pin
+ * The busy wait yields, on the ESP8266 this feeds the soft watchdog and 
+ * lets the WiFi stack run (on AVR yield() is empty).
+ * Returns false on timeout
+ */
+bool HX711_GSR::waitReady()
 {
-	// HX711 is ready when pinDout goes LOW
-	while (digitalRead(_pinDOUT) != LOW) {}
+	uint32_t t0 = millis();
+	bool ready = true;
+#ifdef HAVE_SLEEP_WAIT
+	int8_t irq = digitalPinToInterrupt(_pinDOUT);
+	if (_waitMode == WAIT_MODE::SLEEP && irq != NOT_AN_INTERRUPT)
+	{
+		attachInterrupt(irq, doutFalling, FALLING);
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		for (;;)
+		{
+			noInterrupts();
+			if (digitalRead(_pinDOUT) == LOW)
+			{
+				interrupts();
+				break;
+			}
+			if (millis() - t0 >= _timeoutMs)
+			{
+				interrupts();
+				ready = false;
+				break;
+			}
+			sleep_enable();
+			interrupts();	// sei is followed by sleep before any ISR runs, no wake-up is lost
+			sleep_cpu();
+			sleep_disable();
+		}
+		detachInterrupt(irq);
+		return ready;
+	}
+#endif
+	while (digitalRead(_pinDOUT) != LOW) 
+	{
+		if (millis() - t0 >= _timeoutMs) return false;
+		yield();
+	}
+	return ready;
+}
+
+/**
+ * True when a conversion is ready to be read without waiting
+ */
+bool HX711_GSR::isReady()
+{
+	return digitalRead(_pinDOUT) == LOW;
+}
 
+/**
+ * Clock out one sample which is ready and select channel 
+ * and gain of the next conversion
+ * On the ESP8266 interrupts are disabled while clocking: a WiFi interrupt
+ * inside a HIGH pulse could stretch it beyond 60 us and power the HX711 
+ * down. This blocks for about 120 us. On AVR interrupts stay enabled, the
+ * ISRs are short and the UART must not lose received bytes.
+ */
+HX711_IRAM int32_t HX711_GSR::readSample()
+{
 	int32_t value = 0;
 	uint8_t bytes[3] = { 0 };
 
+#ifdef HX711_ESP_BACKEND
+	noInterrupts();
+#endif
+
 	// read 3 bytes, highest byte first
 	for (uint8_t i = 0; i < 3; i++)
 		bytes[2 - i] = readByte(_pinDOUT, _pinPD_SCK, MSBFIRST);
 
+    // convert 24-bit 2's complement into 32- bit 2's complement
+	value = (int8_t)bytes[2]; // C guarantees the sign extension
+	value =  value << 16 | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[0]; 
+
+	// auto ranging: this sample was converted with the gain the last readout
+	// selected, decide now so the pulses below already select the new one
+	_convGain = _chn_gain;
+	if (_autoRange)
+	{
+		int32_t a = value < 0 ? -value : value;
+		if (_chn_gain == CHN_GAIN::CHN_A_128 && a >= RANGE_UP) _chn_gain = CHN_GAIN::CHN_A_64;
+		else if (_chn_gain == CHN_GAIN::CHN_A_64 && a <= RANGE_DOWN) _chn_gain = CHN_GAIN::CHN_A_128;
+		if (_chn_gain != _convGain)
+		{
+			_range.changes++;
+			_rangeSettle = RANGE_SETTLE;	// the next conversion uses the new gain
+		}
+	}
+
 	// select channel and the gain for the next reading
 	for (uint8_t i = 0; i < (uint8_t)_chn_gain; i++) 
 	{
@@ -57,13 +172,241 @@ int32_t HX711_GSR::getRawValue()
 		digitalWrite(_pinPD_SCK, LOW);
 		delayMicroseconds(2);				// stretch pulse for safety
 	}
+#ifdef HX711_ESP_BACKEND
+	interrupts();
+#endif
+	return value;
+}
 
-    // convert 24-bit 2's complement into 32- bit 2's complement
-	value = (int8_t)bytes[2]; // C guarantees the sign extension
-	value =  value << 16 | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[0]; 
+/**
+ * Read the raw value from the HX711
+ * The wait for DOUT is bounded by the timeout. After maxTimeouts consecutive
+ * timeouts the HX711 is power cycled and the read is retried once. On failure
+ * the last good value is returned, get_status() tells what happened.
+ * After an outage or a recovery the HX711 restarts, samples converted during
+ * its settling time are discarded.
+ */
+int32_t HX711_GSR::getRawValue()
+{
+	if (_poweredDown)
+	{
+		_status = HX711_STATUS::POWERED_DOWN;
+		publish(_lastValue);
+		return _lastValue;
+	}
+
+	int32_t  value;
+	uint32_t ts;
+	for (;;)
+	{
+		// HX711 is ready when pinDout goes LOW
+		PROFILE_START(t);
+		bool ready = waitReady();
+		if (!ready)
+		{
+			_health.timeouts++;
+			if (++_consecutiveTimeouts >= _maxTimeouts)
+			{
+				recover();
+				ready = waitReady();
+				if (!ready) _health.timeouts++;
+			}
+			if (!ready)
+			{
+				_status = HX711_STATUS::TIMEOUT;
+				publish(_lastValue);
+				return _lastValue;
+			}
+		}
+		PROFILE_LAP(ProfileStage::READY_WAIT, t);
+		ts = HX711_Timestamp::take();
+		bool rangeSettling = _rangeSettle > 0;
+		if (rangeSettling) _rangeSettle--;
+		value = readSample();
+		HX711_Timestamp::arm();
+		PROFILE_LAP(ProfileStage::CLOCK_OUT, t);
+
+		if (_consecutiveTimeouts > 0)		// chip is back after an outage
+		{
+			_consecutiveTimeouts = 0;
+			_settleUntil = millis() + SETTLE_MS;
+			_settling = true;
+		}
+		if (_settling && (int32_t)(millis() - _settleUntil) < 0)
+		{
+			_health.discarded++;
+			continue;
+		}
+		_settling = false;
+		// settling conversions after a range change, or the clipped sample which caused it
+		if (rangeSettling || (_chn_gain != _convGain && (value == 0x7FFFFF || value == -0x800000)))
+		{
+			_range.lost++;
+			continue;
+		}
+		break;
+	}
+
+	_health.reads++;
+	_status = HX711_STATUS::OK;
+	if (value == 0x7FFFFF)
+	{
+		_health.saturatedHigh++;
+		_status = HX711_STATUS::SATURATED;
+	}
+	else if (value == -0x800000)
+	{
+		_health.saturatedLow++;
+		_status = HX711_STATUS::SATURATED;
+	}
+	if (_autoRange && _convGain == CHN_GAIN::CHN_A_64)
+		value = (int32_t)lround(value * _rangeRatio);	// in units of gain 128
+	_lastValue = value;
+	updateJitter(ts);
+	_timestamp = ts;
+	publish(value);
+	if (_sampleHandler) _sampleHandler(value, ts);
 	return value;
 }
 
+/**
+ * Readers in another context (ISR, task) get a consistent copy 
+ * without blocking the acquisition
+ */
+void HX711_GSR::publish(int32_t raw)
+{
+	_latest.write({ raw, _weight, _timestamp, _status });
+}
+
+HX711_Sample HX711_GSR::get_latest()
+{
+	return _latest.read();
+}
+
+/**
+ * Start hardware timestamping of the conversions (see HX711_Timestamp.h),
+ * call from setup() after the core has configured the timers
+ */
+void HX711_GSR::startTimestamps()
+{
+	HX711_Timestamp::begin(_pinDOUT);
+	HX711_Timestamp::arm();
+}
+
+/**
+ * Conversion time [us] of the last sample
+ */
+uint32_t HX711_GSR::get_timestamp()
+{
+	return _timestamp;
+}
+
+/**
+ * Mean conversion time [us] of the samples of the last average
+ */
+uint32_t HX711_GSR::get_avgTimestamp()
+{
+	return _avgTimestamp;
+}
+
+/**
+ * The handler sees every valid sample, this is the streaming path
+ */
+void HX711_GSR::setSampleHandler(HX711_SampleHandler handler)
+{
+	_sampleHandler = handler;
+}
+
+/**
+ * Intervals longer than 1 s are idle gaps between 
+ * measurements, not conversion jitter
+ */
+void HX711_GSR::updateJitter(uint32_t timestamp)
+{
+	uint32_t dt = timestamp - _timestamp;
+	if (_timestamp == 0 || dt > 1000000UL) return;
+	HX711_Jitter &j = _jitter;
+	if (j.n == 0 || dt < j.min) j.min = dt;
+	if (dt > j.max) j.max = dt;
+	j.n++;
+	double d = dt - j.mean;
+	j.mean += d / j.n;
+	j.m2 += d * (dt - j.mean);
+}
+
+const HX711_Jitter &HX711_GSR::get_jitter()
+{
+	return _jitter;
+}
+
+void HX711_GSR::resetJitter()
+{
+	memset(&_jitter, 0, sizeof(_jitter));
+}
+
+void HX711_GSR::printJitter()
+{
+	char buf[96];
+	double sd = _jitter.n > 1 ? sqrt(_jitter.m2 / (_jitter.n - 1)) : 0.0;
+	snprintf_P(buf, sizeof(buf), PSTR("sample interval [us]: n %lu, min %lu, max %lu, mean %.1f, std %.1f "),
+		(unsigned long)_jitter.n, (unsigned long)_jitter.min, (unsigned long)_jitter.max, _jitter.mean, sd);
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
+/**
+ * Power cycle the HX711 through PD_SCK, e.g. after it stopped responding
+ */
+void HX711_GSR::recover()
+{
+	powerdown();
+	delayMicroseconds(100);		// HIGH for more than 60 us
+	powerup();
+	_health.recoveries++;
+	_settleUntil = millis() + SETTLE_MS;
+	_settling = true;
+}
+
+HX711_STATUS HX711_GSR::get_status()
+{
+	return _status;
+}
+
+uint16_t HX711_GSR::set_timeout(uint16_t timeoutMs)
+{
+	_timeoutMs = timeoutMs;
+	return _timeoutMs;
+}
+
+uint8_t HX711_GSR::set_maxTimeouts(uint8_t maxTimeouts)
+{
+	_maxTimeouts = maxTimeouts;
+	return _maxTimeouts;
+}
+
+const HX711_Health &HX711_GSR::get_health()
+{
+	return _health;
+}
+
+void HX711_GSR::resetHealth()
+{
+	memset(&_health, 0, sizeof(_health));
+}
+
+void HX711_GSR::printHealth()
+{
+	char buf[128];
+	snprintf_P(buf, sizeof(buf), PSTR("reads %lu, timeouts %lu, recoveries %lu, discarded %lu, saturated high %lu, low %lu "),
+		(unsigned long)_health.reads, (unsigned long)_health.timeouts, (unsigned long)_health.recoveries,
+		(unsigned long)_health.discarded,
+		(unsigned long)_health.saturatedHigh, (unsigned long)_health.saturatedLow);
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
 /**
  * Set channel and gain
  */
@@ -73,6 +416,21 @@ CHN_GAIN HX711_GSR::set_chnGain(CHN_GAIN chnGain)
 	return _chn_gain;
 }
 
+/**
+ * Select how to wait for a conversion, SLEEP falls back 
+ * to BUSY where it is not supported
+ */
+WAIT_MODE HX711_GSR::set_waitMode(WAIT_MODE waitMode)
+{
+	_waitMode = waitMode;
+	return _waitMode;
+}
+
+WAIT_MODE HX711_GSR::get_waitMode()
+{
+	return _waitMode;
+}
+
 int32_t HX711_GSR::set_v0(int32_t v0)
 {
 	_v0 = v0;
@@ -107,6 +465,7 @@ void HX711_GSR::powerdown()
 {
 	digitalWrite(_pinPD_SCK, LOW);
 	digitalWrite(_pinPD_SCK, HIGH);
+	_poweredDown = true;
 }
 
 /**
@@ -115,24 +474,96 @@ void HX711_GSR::powerdown()
 void HX711_GSR::powerup()
 {
 	digitalWrite(_pinPD_SCK, LOW);
+	_poweredDown = false;
+	if (_autoRange) _chn_gain = CHN_GAIN::CHN_A_128;	// the chip restarts with it
+}
+
+/**
+ * Auto ranging on channel A: near the limits of gain 128 switch to gain 64,
+ * back below 80 % of the range of gain 128. Values at gain 64 are scaled to
+ * units of gain 128, so one calibration serves both and the weight stays 
+ * continuous. The 3 conversions after a change are discarded while the
+ * chip settles, the 4th is valid (datasheet: 4 conversions).
+ */
+bool HX711_GSR::set_autoRange(bool on)
+{
+	_autoRange = on;
+	// the next conversion still has the old gain, then gain 128 settles
+	_rangeSettle = on && _chn_gain != CHN_GAIN::CHN_A_128 ? RANGE_SETTLE + 1 : 0;
+	_chn_gain = CHN_GAIN::CHN_A_128;
+	return _autoRange;
+}
+
+bool HX711_GSR::get_autoRange()
+{
+	return _autoRange;
+}
+
+/**
+ * Measures the ratio of the gains with a load which fits both ranges
+ */
+double HX711_GSR::calibrateRange(uint8_t nbr)
+{
+	bool autoRange = _autoRange;
+	_autoRange = false;
+	_chn_gain = CHN_GAIN::CHN_A_64;
+	getRawValue();					// selects gain 64 for the next conversion
+	for (uint8_t i = 0; i < RANGE_SETTLE; i++) getRawValue();
+	int32_t v64 = getAverageValue(nbr);
+	_chn_gain = CHN_GAIN::CHN_A_128;
+	getRawValue();
+	for (uint8_t i = 0; i < RANGE_SETTLE; i++) getRawValue();
+	int32_t v128 = getAverageValue(nbr);
+	if (_status == HX711_STATUS::OK && v64 != 0) _rangeRatio = (double)v128 / v64;
+	set_autoRange(autoRange);
+	return _rangeRatio;
+}
+
+const HX711_Range &HX711_GSR::get_range()
+{
+	return _range;
+}
+
+void HX711_GSR::printRange()
+{
+	char buf[96];
+	char r[12];
+	dtostrf(_rangeRatio, 1, 4, r);
+	snprintf_P(buf, sizeof(buf), PSTR("gain %u, range changes %lu, samples lost %lu, ratio 128/64 %s "),
+		_chn_gain == CHN_GAIN::CHN_A_64 ? 64 : 128, (unsigned long)_range.changes, (unsigned long)_range.lost, r);
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
 }
 
 /**
  * Averages nbr readings
- * Measurement is done nonblocking every 100 ms
+ * Measurement is done nonblocking every 150 ms. The interval is measured
+ * from the previous reading, so a yield() or an interrupt which makes the 
+ * loop miss a millisecond does not delay the next reading.
+ * Stops early when the HX711 does not respond (see get_status())
  */
 int32_t HX711_GSR::getAverageValue(uint8_t nbr)
 {
 	int32_t v = 0;
 	uint8_t  i = 0;
+	uint32_t tLast = millis() - 150;
+	uint32_t t0 = 0, dtSum = 0;		// mean timestamp = t0 + dtSum / i
 	
 	do
 	{
-		if (millis() % 150 == 0)
+		if (millis() - tLast >= 150)
 		{
+			tLast = millis();
 			v += getRawValue();
+			if (_status == HX711_STATUS::TIMEOUT || _status == HX711_STATUS::POWERED_DOWN)
+				return i ? (v - _lastValue) / i : _lastValue;
+			if (i == 0) t0 = _timestamp;
+			dtSum += _timestamp - t0;
 			i++;
+			_avgTimestamp = t0 + dtSum / i;
 		}
+		yield();
 	} while (i < nbr);
 	return v / nbr;
 }
@@ -142,7 +573,8 @@ int32_t HX711_GSR::getAverageValue(uint8_t nbr)
  */
 int32_t HX711_GSR::setZero(uint8_t nbr)
 {
-	_v0 = getAverageValue(nbr);
+	int32_t v0 = getAverageValue(nbr);
+	if (_status == HX711_STATUS::OK) _v0 = v0;
 	return _v0;
 }
 
@@ -152,7 +584,9 @@ int32_t HX711_GSR::setZero(uint8_t nbr)
  */
 double HX711_GSR::calibrate(uint8_t nbr)
 {
-	_vref = getAverageValue(nbr);
+	int32_t vref = getAverageValue(nbr);
+	if (_status != HX711_STATUS::OK) return _m;
+	_vref = vref;
 	_m = (double)_gramsRefWeight / double(_vref - _v0);
 	_b = -_gramsRefWeight * (double)_v0 / (double)(_vref - _v0);
 	return _m; 
@@ -164,11 +598,23 @@ double HX711_GSR::calibrate(uint8_t nbr)
 double HX711_GSR::getWeight(uint8_t nbr)
 {
 	int32_t v = getAverageValue(nbr);
-	double w = (double)_gramsRefWeight * (double)(v - _v0) / (double)(_vref - _v0);
-	w = round(10.0 * w) / 10.0; 
+	PROFILE_START(t);
+	double w = toWeight(v);
+	PROFILE_LAP(ProfileStage::FILTER, t);
+	_weight = (float)w;
+	_latest.write({ v, _weight, _avgTimestamp, _status });
 	return w;
 }
 
+/**
+ * Converts a raw value into grams, rounded to 0.1 g
+ */
+double HX711_GSR::toWeight(int32_t v)
+{
+	double w = (double)_gramsRefWeight * (double)(v - _v0) / (double)(_vref - _v0);
+	return round(10.0 * w) / 10.0; 
+}
+
 int32_t HX711_GSR::get_wref()
 {
 	return _gramsRefWeight;
@@ -215,6 +661,8 @@ CHN_GAIN HX711_GSR::get_chnGain()
 void HX711_GSR::printEquation()
 {
 	char buf[64];
-	snprintf(buf, sizeof(buf), "weight = %.9f * v %+9.4f ", _m, _b);
+	snprintf_P(buf, sizeof(buf), PSTR("weight = %.9f * v %+9.4f "), _m, _b);
+	PROFILE_START(t);
 	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
 }
\ No newline at end of file
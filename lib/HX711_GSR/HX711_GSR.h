@@ -12,8 +12,51 @@
 #ifndef _HX711_GSR_H_
 #define _HX711_GSR_H_
 #include <Arduino.h>
+#include "HX711_Snapshot.h"
 
 enum class CHN_GAIN  { NO_CHN, CHN_A_128, CHN_B_32, CHN_A_64 };
+enum class WAIT_MODE { BUSY, SLEEP };   // how getRawValue() waits for DOUT
+enum class HX711_STATUS { OK, TIMEOUT, SATURATED, POWERED_DOWN };
+
+// health counters, queryable over the CLI
+struct HX711_Health
+{
+    uint32_t reads;
+    uint32_t timeouts;        // DOUT did not go LOW within the timeout
+    uint32_t recoveries;      // power cycles through PD_SCK after consecutive timeouts
+    uint32_t discarded;       // samples converted while settling after an outage
+    uint32_t saturatedHigh;   // reads of 0x7FFFFF
+    uint32_t saturatedLow;    // reads of 0x800000
+};
+
+// automatic gain ranging between CHN_A_128 and CHN_A_64
+struct HX711_Range
+{
+    uint32_t changes;         // switches in either direction
+    uint32_t lost;            // samples discarded because of a switch
+};
+
+// statistics of the interval between successive sample timestamps [us]
+struct HX711_Jitter
+{
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    double   mean;
+    double   m2;              // sum of squared deviations (Welford)
+};
+
+// latest acquisition result, published through a seqlock (HX711_Snapshot.h)
+struct HX711_Sample
+{
+    int32_t      raw;         // last raw value, the average after getWeight()
+    float        weight;      // last filtered weight [g] from getWeight()
+    uint32_t     timestamp;   // conversion time of raw [us]
+    HX711_STATUS status;
+};
+
+// called for every valid sample with its conversion time [us]
+typedef void (*HX711_SampleHandler)(int32_t value, uint32_t timestamp);
 
 class HX711_GSR
 {
@@ -28,11 +71,13 @@ class HX711_GSR
             digitalWrite(_pinPD_SCK, LOW);   // go to normal operation
         }
 
+    bool    isReady();
     int32_t getRawValue();
     int32_t getAverageValue(uint8_t nbr);
     int32_t setZero(uint8_t nbr);
     double  calibrate(uint8_t nbr);
     double  getWeight(uint8_t nbr);
+    double  toWeight(int32_t v);
     int32_t getMaxLoad();
     int32_t get_v0();
     int32_t set_v0(int32_t v0);
@@ -42,6 +87,28 @@ class HX711_GSR
     int32_t set_wref(int32_t grammRefWeight);
     CHN_GAIN get_chnGain();
     CHN_GAIN set_chnGain(CHN_GAIN chnGain);
+    WAIT_MODE get_waitMode();
+    WAIT_MODE set_waitMode(WAIT_MODE waitMode);
+    HX711_STATUS get_status();
+    uint16_t set_timeout(uint16_t timeoutMs);
+    uint8_t  set_maxTimeouts(uint8_t maxTimeouts);
+    const HX711_Health &get_health();
+    void    resetHealth();
+    void    printHealth();
+    void    recover();
+    void    startTimestamps();
+    uint32_t get_timestamp();
+    uint32_t get_avgTimestamp();
+    void    setSampleHandler(HX711_SampleHandler handler);
+    const HX711_Jitter &get_jitter();
+    void    resetJitter();
+    void    printJitter();
+    HX711_Sample get_latest();
+    bool    set_autoRange(bool on);
+    bool    get_autoRange();
+    double  calibrateRange(uint8_t nbr);
+    const HX711_Range &get_range();
+    void    printRange();
     double  get_m();
     double  get_b();
     void    calculateCoefficients();
@@ -50,10 +117,36 @@ class HX711_GSR
     void    printEquation();
 
     private:
+        bool     waitReady();
+        int32_t  readSample();
+        void     updateJitter(uint32_t timestamp);
+        void     publish(int32_t raw);
+
         uint8_t  _pinDOUT;
         uint8_t  _pinPD_SCK;
         int32_t  _gramsMaxLoad;
         CHN_GAIN _chn_gain = CHN_GAIN::CHN_A_128;
+        WAIT_MODE _waitMode = WAIT_MODE::BUSY;
+        HX711_STATUS _status = HX711_STATUS::OK;
+        HX711_Health _health = { 0, 0, 0, 0, 0, 0 };
+        uint16_t _timeoutMs   = 1000;   // > 400 ms settling time after power up
+        uint8_t  _maxTimeouts = 2;      // consecutive timeouts before recovery
+        uint8_t  _consecutiveTimeouts = 0;
+        bool     _poweredDown = false;
+        bool     _settling = false;
+        uint32_t _settleUntil = 0;
+        int32_t  _lastValue = 0;
+        uint32_t _timestamp = 0;
+        uint32_t _avgTimestamp = 0;
+        HX711_SampleHandler _sampleHandler = nullptr;
+        HX711_Jitter _jitter = { 0, 0, 0, 0.0, 0.0 };
+        HX711_Snapshot<HX711_Sample> _latest;
+        float    _weight = 0.0f;
+        bool     _autoRange = false;
+        uint8_t  _rangeSettle = 0;     // conversions still settling after a gain change
+        CHN_GAIN _convGain = CHN_GAIN::CHN_A_128;   // gain of the sample just read
+        double   _rangeRatio = 2.0;                  // gain 128 / gain 64
+        HX711_Range _range = { 0, 0 };
         int32_t  _v0   = 0;
         int32_t  _vref = 0;
         int32_t  _gramsRefWeight = -1;
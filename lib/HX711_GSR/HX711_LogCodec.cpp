@@ -0,0 +1,249 @@
+/**
+ * Class        HX711_LogCodec.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Delta, zigzag and varint or Rice coded sample blocks, see
+ *              HX711_LogCodec.h
+ */
+#include "HX711_LogCodec.h"
+#include "HX711_Crc.h"
+
+constexpr uint8_t  LOG_MAGIC[2] = { 'H', 'L' };
+constexpr uint8_t  RICE_ESCAPE  = 32;       // unary length that escapes to 32 bits
+constexpr uint16_t PAYLOAD_BITS = HX711_LOG_PAYLOAD * 8;
+constexpr uint8_t  LOG_MAX_MISSED = 255;     // lost samples within a block
+
+/**
+ * Add a sample, true if this completed a block: it did not fit any more,
+ * came faster than the samples before or after too many lost ones; it 
+ * starts the next block then
+ */
+bool HX711_LogCodec::put(int32_t raw, uint32_t timestamp)
+{
+	bool completed = false;
+	if (_count > 0)
+	{
+		uint32_t dt = timestamp - _lastTs;
+		uint32_t missed = 0;
+		bool slower = dt >= _minDt - (_minDt >> 2);
+		if (_minDt == 0 || (slower && dt < _minDt)) _minDt = dt;
+		else if (dt > _minDt + (_minDt >> 1)) missed = (dt + (_minDt >> 1)) / _minDt - 1;
+		if (missed) _gaps++;
+		int32_t  d = raw - _last;
+		uint32_t zz = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+		if (slower && missed <= LOG_MAX_MISSED && _count < 0xFFFF && append(zz, missed))
+		{
+			_last = raw;
+			_lastTs = timestamp;
+			_zzSum += zz;
+			_count++;
+			_samples++;
+			return false;
+		}
+		close();
+		completed = true;
+	}
+	memset(_cur, 0, sizeof(_cur));
+	_bits = 0;
+	_zzSum = 0;
+	_minDt = 0;								// learnt anew, the rate may have changed
+	_firstRaw = _last = raw;
+	_first = _lastTs = timestamp;
+	_count = 1;
+	_samples++;
+	return completed;
+}
+
+/**
+ * Complete the block under way, e.g. before a shutdown
+ */
+bool HX711_LogCodec::flush()
+{
+	if (_count == 0) return false;
+	close();
+	_count = 0;
+	return true;
+}
+
+/**
+ * Code the lost samples, if any, and one zigzag value if both fit into 
+ * the payload. Lost samples are a code that never occurs otherwise:
+ *   VARINT  0x80 0x00 (a zero with a needless continuation), count
+ *   RICE    the escape, a 1 bit, 8 bits count; a value that escapes
+ *           has a 0 bit before its 32 bits
+ */
+bool HX711_LogCodec::append(uint32_t v, uint32_t missed)
+{
+	if (_coding == LOG_CODING::VARINT)
+	{
+		uint8_t n = 1;
+		for (uint32_t t = v >> 7; t; t >>= 7) n++;
+		if (_bits + 8 * (n + (missed ? 3 : 0)) > PAYLOAD_BITS) return false;
+		if (missed)
+		{
+			writeBits(0x8000, 16);
+			writeBits(missed, 8);
+		}
+		for (; n > 1; n--, v >>= 7) writeBits((v & 0x7F) | 0x80, 8);
+		writeBits(v, 8);
+		return true;
+	}
+	uint32_t q = v >> _k;
+	uint16_t len = q < RICE_ESCAPE ? q + 1 + _k : RICE_ESCAPE + 33;
+	if (missed) len += RICE_ESCAPE + 9;
+	if (_bits + len > PAYLOAD_BITS) return false;
+	if (missed)
+	{
+		writeBits(0xFFFFFFFF, RICE_ESCAPE);
+		writeBits(0x100 | missed, 9);
+	}
+	if (q >= RICE_ESCAPE)
+	{
+		writeBits(0xFFFFFFFF, RICE_ESCAPE);
+		writeBits(0, 1);
+		writeBits(v, 32);
+		return true;
+	}
+	for (; q >= 8; q -= 8) writeBits(0xFF, 8);
+	writeBits((1UL << q) - 1, q);
+	writeBits(0, 1);
+	writeBits(v & ((1UL << _k) - 1), _k);
+	return true;
+}
+
+/**
+ * The n low bits of v into the payload, most significant first
+ */
+void HX711_LogCodec::writeBits(uint32_t v, uint8_t n)
+{
+	while (n > 0)
+	{
+		uint8_t *b = _cur + HX711_LOG_HEADER + (_bits >> 3);
+		uint8_t free = 8 - (_bits & 7);
+		uint8_t take = n < free ? n : free;
+		uint8_t chunk = (v >> (n - take)) & ((1U << take) - 1);
+		*b |= chunk << (free - take);
+		_bits += take;
+		n -= take;
+	}
+}
+
+/**
+ * Header and CRC, hand the block over, choose k for the next one
+ */
+void HX711_LogCodec::close()
+{
+	uint16_t bytes = (_bits + 7) >> 3;
+	memcpy(_cur, LOG_MAGIC, 2);
+	_cur[2] = (uint8_t)_coding;
+	_cur[3] = _coding == LOG_CODING::RICE ? _k : 0;
+	memcpy(_cur + 4, &_sequence, 4);
+	memcpy(_cur + 8, &_first, 4);
+	memcpy(_cur + 12, &_lastTs, 4);
+	memcpy(_cur + 16, &_firstRaw, 4);
+	memcpy(_cur + 20, &_count, 2);
+	memcpy(_cur + 22, &bytes, 2);
+	uint16_t crc = HX711_Crc::of(_cur, HX711_LOG_BLOCK - 2);
+	memcpy(_cur + HX711_LOG_BLOCK - 2, &crc, 2);
+	if (_ready) _overruns++;
+	memcpy(_done, _cur, HX711_LOG_BLOCK);
+	_ready = true;
+	_sequence++;
+	if (_count > 1)
+	{
+		uint32_t t = _zzSum / (_count - 1) * 11 / 16;		// mean * ln 2
+		for (_k = 0; _k < 24 && (t >> (_k + 1)); _k++);
+	}
+}
+
+/**
+ * Header of a block, false if magic or CRC are wrong
+ */
+bool HX711_LogCodec::info(const uint8_t *block, HX711_LogInfo &info)
+{
+	uint16_t crc;
+	memcpy(&crc, block + HX711_LOG_BLOCK - 2, 2);
+	if (memcmp(block, LOG_MAGIC, 2) != 0 || block[2] > (uint8_t)LOG_CODING::RICE || crc != HX711_Crc::of(block, HX711_LOG_BLOCK - 2)) return false;
+	info.coding = (LOG_CODING)block[2];
+	info.k = block[3];
+	memcpy(&info.sequence, block + 4, 4);
+	memcpy(&info.first, block + 8, 4);
+	memcpy(&info.last, block + 12, 4);
+	memcpy(&info.count, block + 20, 2);
+	memcpy(&info.bytes, block + 22, 2);
+	return info.count > 0 && info.bytes <= HX711_LOG_PAYLOAD;
+}
+
+/**
+ * Unpack up to max samples, timestamps may be nullptr.
+ * Returns the number of samples, 0 if the block is broken.
+ */
+uint16_t HX711_LogCodec::decode(const uint8_t *block, int32_t *raw, uint32_t *timestamp, uint16_t max)
+{
+	HX711_LogInfo h;
+	if (!info(block, h) || h.count > max) return 0;
+	const uint8_t *p = block + HX711_LOG_HEADER;
+	uint16_t bits = h.bytes * 8, pos = 0;
+	auto bit = [&]() -> uint32_t { uint32_t b = p[pos >> 3] >> (7 - (pos & 7)) & 1; pos++; return b; };
+	auto read = [&](uint8_t n) -> uint32_t { uint32_t v = 0; while (n--) v = v << 1 | bit(); return v; };
+
+	memcpy(&raw[0], block + 16, 4);
+	uint32_t slot = 0;							// sample intervals from the first
+	if (timestamp) timestamp[0] = 0;
+	for (uint16_t i = 1; i < h.count; )
+	{
+		uint32_t v = 0;
+		bool gap = false;
+		if (h.coding == LOG_CODING::VARINT)
+		{
+			if (pos + 16 <= bits && p[pos >> 3] == 0x80 && p[(pos >> 3) + 1] == 0x00)
+			{
+				if (pos + 24 > bits) return 0;
+				v = p[(pos >> 3) + 2];
+				pos += 24;
+				gap = true;
+			}
+			else for (uint8_t shift = 0; ; shift += 7)
+			{
+				if (pos + 8 > bits || shift > 28) return 0;
+				uint8_t b = p[pos >> 3];
+				pos += 8;
+				v |= (uint32_t)(b & 0x7F) << shift;
+				if (!(b & 0x80)) break;
+			}
+		}
+		else
+		{
+			uint32_t q = 0;
+			while (q < RICE_ESCAPE && pos < bits && bit()) q++;
+			if (q == RICE_ESCAPE)
+			{
+				if (pos + 1 > bits) return 0;
+				gap = bit();
+				if (pos + (gap ? 8 : 32) > bits) return 0;
+				v = read(gap ? 8 : 32);
+			}
+			else
+			{
+				if (pos + h.k > bits) return 0;
+				v = q << h.k | read(h.k);
+			}
+		}
+		if (gap)
+		{
+			slot += v;
+			continue;
+		}
+		slot++;
+		raw[i] = raw[i - 1] + (int32_t)((v >> 1) ^ (0 - (v & 1)));
+		if (timestamp) timestamp[i] = slot;
+		i++;
+	}
+	if (timestamp)
+	{
+		uint32_t span = h.last - h.first;
+		for (uint16_t i = 0; i < h.count; i++)
+			timestamp[i] = h.first + (slot ? (uint32_t)((uint64_t)span * timestamp[i] / slot) : 0);
+	}
+	return h.count;
+}
@@ -0,0 +1,90 @@
+/**
+ * Header       HX711_LogCodec.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Compressed blocks of raw samples for long recordings.
+ *              put() takes the sample stream and packs it into blocks of
+ *              HX711_LOG_BLOCK bytes, one flash page, so a logger writes
+ *              whole pages only. A block holds a header with sequence
+ *              number, the timestamps of its first and last sample and the
+ *              first raw value, then the differences to the previous
+ *              sample, zigzag mapped (0, -1, 1, -2 .. -> 0, 1, 2, 3 ..) and
+ *              coded either
+ *                VARINT  7 bits per byte, the high bit continues
+ *                RICE    value >> k unary, then its k low bits; k follows
+ *                        the mean of the previous block, values of 32 or
+ *                        more times 2^k escape to 32 bits
+ *              and a CRC-16 at the end. The timestamps in between are
+ *              interpolated, the samples of a block are evenly spaced: an
+ *              interval above 1.5 times the shortest one means lost
+ *              conversions, their number is coded in the block, up to 255;
+ *              a shorter interval or a longer gap closes the block.
+ *              The completed block waits in a second buffer until take(),
+ *              a block completed before is overwritten and counted.
+ *              decode() checks and unpacks a block, also on the host.
+ *
+ * Constructor  coding       LOG_CODING::VARINT or LOG_CODING::RICE
+ */
+#ifndef _HX711_LOGCODEC_H_
+#define _HX711_LOGCODEC_H_
+#include <Arduino.h>
+
+constexpr uint16_t HX711_LOG_BLOCK   = 256;
+constexpr uint8_t  HX711_LOG_HEADER  = 24;
+constexpr uint16_t HX711_LOG_PAYLOAD = HX711_LOG_BLOCK - HX711_LOG_HEADER - 2;
+
+enum class LOG_CODING : uint8_t { VARINT, RICE };
+
+// header of a block, little endian
+struct HX711_LogInfo
+{
+    LOG_CODING coding;
+    uint8_t  k;               // Rice parameter
+    uint32_t sequence;
+    uint32_t first;           // timestamp of the first sample [us]
+    uint32_t last;            // timestamp of the last sample [us]
+    uint16_t count;
+    uint16_t bytes;           // payload used
+};
+
+class HX711_LogCodec
+{
+    public:
+        HX711_LogCodec(LOG_CODING coding = LOG_CODING::RICE) : _coding(coding) {}
+
+        bool     put(int32_t raw, uint32_t timestamp);
+        bool     flush();
+        bool     available() { return _ready; }
+        const uint8_t *take() { _ready = false; return _done; }
+        uint32_t getBlocks() { return _sequence; }
+        uint32_t getSamples() { return _samples; }
+        uint32_t getOverruns() { return _overruns; }
+        uint32_t getGaps() { return _gaps; }
+
+        static bool     info(const uint8_t *block, HX711_LogInfo &info);
+        static uint16_t decode(const uint8_t *block, int32_t *raw, uint32_t *timestamp, uint16_t max);
+
+    private:
+        bool     append(uint32_t v, uint32_t missed);
+        void     writeBits(uint32_t v, uint8_t n);
+        void     close();
+
+        LOG_CODING _coding;
+        uint8_t  _cur[HX711_LOG_BLOCK];
+        uint8_t  _done[HX711_LOG_BLOCK];
+        uint16_t _bits = 0;                     // payload bits used
+        uint16_t _count = 0;
+        uint8_t  _k = 8;                        // Rice parameter of this block
+        uint32_t _zzSum = 0;                    // of the zigzag values, for the next k
+        int32_t  _firstRaw = 0;
+        int32_t  _last = 0;
+        uint32_t _first = 0;
+        uint32_t _lastTs = 0;
+        uint32_t _minDt = 0;                    // shortest interval [us]
+        uint32_t _sequence = 0;
+        uint32_t _samples = 0;
+        uint32_t _overruns = 0;
+        uint32_t _gaps = 0;
+        bool     _ready = false;
+};
+#endif
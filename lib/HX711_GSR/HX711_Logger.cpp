@@ -0,0 +1,102 @@
+/**
+ * Class        HX711_Logger.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Compressed raw sample log on LittleFS, see HX711_Logger.h
+ */
+#include "HX711_Logger.h"
+#include "HX711_Profile.h"
+#if defined(ESP8266)
+
+static const char LOG_DIR[] = "/log";
+
+void HX711_Logger::path(char *buf, uint32_t nbr)
+{
+	snprintf(buf, 24, "%s/%08lu.hxl", LOG_DIR, (unsigned long)nbr);
+}
+
+/**
+ * Mount the file system and continue after the newest file.
+ * maxBytes 0 takes 90 % of the file system.
+ */
+bool HX711_Logger::begin(uint32_t maxBytes)
+{
+	_mounted = LittleFS.begin();
+	if (!_mounted) return false;
+	FSInfo fs;
+	LittleFS.info(fs);
+	_maxBytes = maxBytes ? maxBytes : fs.totalBytes / 10 * 9;
+	LittleFS.mkdir(LOG_DIR);
+	_oldest = 0;
+	_next = 1;
+	Dir dir = LittleFS.openDir(LOG_DIR);
+	while (dir.next())
+	{
+		uint32_t nbr = strtoul(dir.fileName().c_str(), nullptr, 10);
+		if (nbr == 0) continue;
+		if (_oldest == 0 || nbr < _oldest) _oldest = nbr;
+		if (nbr >= _next) _next = nbr + 1;
+	}
+	if (_oldest == 0) _oldest = _next;
+	return true;
+}
+
+/**
+ * Write the block under way and close the file
+ */
+void HX711_Logger::stop()
+{
+	_running = false;
+	_codec.flush();
+	update();
+	if (_file) _file.close();
+}
+
+/**
+ * Loop: append a completed block, true if one was written
+ */
+bool HX711_Logger::update()
+{
+	if (!_codec.available()) return false;
+	if ((!_file || _file.size() + HX711_LOG_BLOCK > HX711_LOG_FILE) && !openNext())
+	{
+		_codec.take();
+		_errors++;
+		return false;
+	}
+	if (_file.write(_codec.take(), HX711_LOG_BLOCK) != HX711_LOG_BLOCK) _errors++;
+	else _written++;
+	return true;
+}
+
+/**
+ * Start the next file, remove the oldest ones while the log is too large
+ */
+bool HX711_Logger::openNext()
+{
+	char name[24];
+	if (_file) _file.close();
+	FSInfo fs;
+	LittleFS.info(fs);
+	while (fs.usedBytes + HX711_LOG_FILE > _maxBytes && _oldest < _next)
+	{
+		path(name, _oldest++);
+		LittleFS.remove(name);
+		LittleFS.info(fs);
+	}
+	path(name, _next++);
+	_file = LittleFS.open(name, "a");
+	return (bool)_file;
+}
+
+void HX711_Logger::print()
+{
+	char buf[96];
+	snprintf_P(buf, sizeof(buf), PSTR("\rlog %lu blocks, %lu samples, files %lu .. %lu, %lu gaps, %lu lost blocks, %lu errors "),
+		(unsigned long)_written, (unsigned long)_codec.getSamples(), (unsigned long)_oldest, (unsigned long)(_next - 1),
+		(unsigned long)_codec.getGaps(), (unsigned long)_codec.getOverruns(), (unsigned long)_errors);
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+#endif
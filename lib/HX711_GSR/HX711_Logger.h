@@ -0,0 +1,60 @@
+/**
+ * Header       HX711_Logger.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Raw sample log on the LittleFS of the ESP8266 (D1 mini).
+ *              onSample() runs on the per-sample path and only codes the
+ *              sample into the block under way (HX711_LogCodec), update()
+ *              in the loop appends a completed block, one 256 byte flash
+ *              page, to the current file. Files of HX711_LOG_FILE bytes
+ *              are numbered /log/00000001.hxl on; when the log would exceed
+ *              maxBytes the oldest file is removed, so the log holds the
+ *              most recent days. At 1.3 to 1.8 bytes per sample 2 MB hold
+ *              some 4 hours at 80 SPS or 1.5 days at 10 SPS (see the README).
+ *              The timestamps are micros() and wrap after 71 minutes, a
+ *              reader unwraps them from block to block.
+ *              Flash writes block the loop for a few ms, longer when a
+ *              sector has to be erased; the HX711 holds one conversion, a
+ *              longer stall loses samples and the codec starts a new block.
+ *
+ * Constructor  coding       LOG_CODING::VARINT or LOG_CODING::RICE
+ */
+#ifndef _HX711_LOGGER_H_
+#define _HX711_LOGGER_H_
+#if defined(ESP8266)
+#include <LittleFS.h>
+#include "HX711_LogCodec.h"
+
+constexpr uint32_t HX711_LOG_FILE = 64 * 1024UL;
+
+class HX711_Logger
+{
+    public:
+        HX711_Logger(LOG_CODING coding = LOG_CODING::RICE) : _codec(coding) {}
+
+        bool     begin(uint32_t maxBytes = 0);
+        void     start() { _running = _mounted; }
+        void     stop();
+        bool     isRunning() { return _running; }
+        void     onSample(int32_t raw, uint32_t timestamp) { if (_running) _codec.put(raw, timestamp); }
+        bool     update();
+        uint32_t getWritten() { return _written; }
+        uint32_t getErrors() { return _errors; }
+        void     print();
+
+    private:
+        bool     openNext();
+        void     path(char *buf, uint32_t nbr);
+
+        HX711_LogCodec _codec;
+        File     _file;
+        uint32_t _maxBytes = 0;
+        uint32_t _oldest = 0;                   // number of the oldest file
+        uint32_t _next = 1;                     // number of the next file
+        uint32_t _written = 0;                  // blocks
+        uint32_t _errors = 0;
+        bool     _mounted = false;
+        bool     _running = false;
+};
+#endif
+#endif
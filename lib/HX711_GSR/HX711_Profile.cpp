@@ -0,0 +1,50 @@
+/**
+ * Class        HX711_Profile.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Accumulators of the hot path instrumentation, see HX711_Profile.h
+ */
+#include "HX711_Profile.h"
+
+HX711_Profile::Stats HX711_Profile::_stats[(uint8_t)ProfileStage::NBR_STAGES];
+
+static const char stageNames[][11] PROGMEM = { "ready_wait", "clock_out", "filter", "serial_out" };
+
+void HX711_Profile::add(ProfileStage stage, uint32_t us)
+{
+	Stats &s = _stats[(uint8_t)stage];
+	if (s.n == 0 || us < s.min) s.min = us > 0xFFFF ? 0xFFFF : us;
+	if (us > s.max) s.max = us;
+	s.n++;
+	s.sumMs += us / 1000;
+	s.sumUs += us % 1000;
+	if (s.sumUs >= 1000)
+	{
+		s.sumMs++;
+		s.sumUs -= 1000;
+	}
+}
+
+void HX711_Profile::reset()
+{
+	memset(_stats, 0, sizeof(_stats));
+}
+
+/**
+ * One line per stage: count, min, max, mean [us] and total [ms]
+ */
+void HX711_Profile::print()
+{
+	char buf[72];
+	char name[11];
+	Serial.print(F("\nstage            n      min      max     mean   total[ms]\n"));
+	for (uint8_t i = 0; i < (uint8_t)ProfileStage::NBR_STAGES; i++)
+	{
+		const Stats &s = _stats[i];
+		uint32_t mean = s.n ? (uint32_t)(((uint64_t)s.sumMs * 1000 + s.sumUs) / s.n) : 0;
+		strcpy_P(name, stageNames[i]);
+		snprintf_P(buf, sizeof(buf), PSTR("%-10s %7lu %8u %8lu %8lu %10lu\n"), 
+			name, (unsigned long)s.n, s.min, (unsigned long)s.max, (unsigned long)mean, (unsigned long)s.sumMs);
+		Serial.print(buf);
+	}
+}
@@ -0,0 +1,56 @@
+/**
+ * Header       HX711_Profile.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Lightweight instrumentation of the hot path stages. Each stage 
+ *              accumulates count, min, max and sum of its duration in us 
+ *              taken with micros(). Build with -DHX711_PROFILE to enable it,
+ *              otherwise all macros compile to nothing.
+ * 
+ *              Stages  READY_WAIT  waiting for DOUT to go LOW
+ *                      CLOCK_OUT   clocking out 24 bits + gain pulses
+ *                      FILTER      averaging / conversion to weight
+ *                      SERIAL_OUT  blocking in Serial.print
+ * 
+ * Overhead     A lap costs one micros() call (~3.6 us on the Uno) and one
+ *              accumulate (~4 us). getRawValue() takes 3 stamps and 2 laps 
+ *              per sample, about 20 us: 0.02 % of the 100 ms sample time at 
+ *              10 SPS and 0.16 % of 12.5 ms at 80 SPS, well below 2 %.
+ *              RAM: 16 bytes per stage. Sums overflow after ~49 days.
+ */
+#ifndef _HX711_PROFILE_H_
+#define _HX711_PROFILE_H_
+#include <Arduino.h>
+
+enum class ProfileStage { READY_WAIT, CLOCK_OUT, FILTER, SERIAL_OUT, NBR_STAGES };
+
+class HX711_Profile
+{
+    public:
+        struct Stats
+        {
+            uint32_t n;
+            uint16_t min;    // us, saturates at 65535
+            uint32_t max;
+            uint32_t sumMs;  // sum split in ms and us keeps the accumulate cheap
+            uint16_t sumUs;
+        };
+
+        static void add(ProfileStage stage, uint32_t us);
+        static void reset();
+        static void print();  // dump all stages to Serial
+        static const Stats &get(ProfileStage stage) { return _stats[(uint8_t)stage]; }
+
+    private:
+        static Stats _stats[(uint8_t)ProfileStage::NBR_STAGES];
+};
+
+#ifdef HX711_PROFILE
+    #define PROFILE_START(t)        uint32_t t = micros()
+    #define PROFILE_LAP(stage, t)   do { uint32_t _now = micros(); HX711_Profile::add(stage, _now - t); t = _now; } while (0)
+#else
+    #define PROFILE_START(t)        do {} while (0)
+    #define PROFILE_LAP(stage, t)   do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * Class        HX711_Rate.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Sliding window regression of the weight over time, 
+ *              see HX711_Rate.h
+ */
+#include "HX711_Rate.h"
+#include "HX711_Crc.h"
+#include "HX711_Profile.h"
+
+constexpr uint32_t MAX_GAP_US  = 1000000UL;   // restart the window after this gap
+constexpr uint32_t MAX_SPAN_US = 1UL << 24;   // keeps the 64-bit sums from overflow
+constexpr uint8_t  FRAME_SYNC  = 0xA8;
+
+void HX711_Rate::setWindow(uint8_t window)
+{
+	_window = window < 3 ? 3 : window > HX711_RATE_MAX ? HX711_RATE_MAX : window;
+	reset();
+}
+
+void HX711_Rate::reset()
+{
+	_n = _head = 0;
+	_sx = _sy = _sxx = _sxy = _syy = 0;
+	_dirty = true;
+}
+
+/**
+ * Per-sample path: drop the oldest sample when the window is full, 
+ * move the origin to the new oldest one, add the new sample
+ */
+void HX711_Rate::add(int32_t raw, uint32_t timestamp)
+{
+	_samples++;
+	if (_n > 0 && timestamp - _t[(_head + _n - 1) % HX711_RATE_MAX] > MAX_GAP_US) reset();
+	while (_n > 0 && (_n >= _window || timestamp - _origin >= MAX_SPAN_US))
+	{
+		int64_t x = (int64_t)(_t[_head] - _origin);
+		int64_t y = _y[_head];
+		_sx  -= x;
+		_sy  -= y;
+		_sxx -= x * x;
+		_sxy -= x * y;
+		_syy -= y * y;
+		_head = (_head + 1) % HX711_RATE_MAX;
+		_n--;
+		// sums over x - d for the new origin
+		int64_t d = _n ? (int64_t)(_t[_head] - _origin) : 0;
+		_sxx -= 2 * d * _sx - (int64_t)_n * d * d;
+		_sxy -= d * _sy;
+		_sx  -= (int64_t)_n * d;
+		_origin += (uint32_t)d;
+	}
+	if (_n == 0) _origin = timestamp;
+
+	uint8_t i = (_head + _n) % HX711_RATE_MAX;
+	_t[i] = timestamp;
+	_y[i] = raw;
+	_n++;
+	int64_t x = (int64_t)(timestamp - _origin);
+	_sx  += x;
+	_sy  += raw;
+	_sxx += x * x;
+	_sxy += x * raw;
+	_syy += (int64_t)raw * raw;
+	_dirty = true;
+}
+
+/**
+ * Slope and its standard error from the sums, done once per new sample
+ * and only when asked for
+ */
+void HX711_Rate::compute()
+{
+	_dirty = false;
+	_slope = _se = 0.0f;
+	if (_n < 3) return;
+	double n   = _n;
+	double sxx = (double)(_n * _sxx - _sx * _sx);	// n * Sxx, exact in the integer domain
+	double sxy = (double)(_n * _sxy - _sx * _sy);
+	double syy = (double)(_n * _syy - _sy * _sy);
+	if (sxx <= 0.0) return;
+	double b   = sxy / sxx;
+	double res = (syy - b * sxy) / n;				// residual sum of squares
+	_slope = b;
+	_se    = res > 0.0 ? sqrt(res / (n - 2) / (sxx / n)) : 0.0;
+}
+
+float HX711_Rate::getRate()
+{
+	if (_dirty) compute();
+	return _slope * _scale.get_m() * 1e6;
+}
+
+float HX711_Rate::getUncertainty()
+{
+	if (_dirty) compute();
+	return _se * fabs(_scale.get_m()) * 1e6;
+}
+
+void HX711_Rate::print()
+{
+	char buf[64];
+	char r[12], u[12];
+	dtostrf(getRate(), 1, 2, r);
+	dtostrf(getUncertainty(), 1, 2, u);
+	snprintf_P(buf, sizeof(buf), PSTR("\rrate = %s +- %s g/s (%u samples) "), r, u, _n);
+	Serial.print(buf);
+}
+
+/**
+ * Binary frame of 16 bytes, little endian:
+ *   uint8    0xA8 sync
+ *   uint8    samples in the window, fewer than 3: no estimate yet
+ *   uint32   timestamp of the newest sample [ms]
+ *   float    rate, uncertainty [g/s]
+ *   uint16   CRC-16/CCITT (0xFFFF, 0x1021) of the 14 bytes before
+ */
+void HX711_Rate::writeFrame()
+{
+	uint8_t  f[16];
+	uint32_t ms = _n ? _t[(_head + _n - 1) % HX711_RATE_MAX] / 1000 : 0;
+	float    v[2] = { getRate(), getUncertainty() };
+	f[0] = FRAME_SYNC;
+	f[1] = _n;
+	memcpy(f + 2, &ms, 4);
+	memcpy(f + 6, v, 8);
+	uint16_t crc = HX711_Crc::of(f, 14);
+	memcpy(f + 14, &crc, 2);
+	PROFILE_START(t);
+	for (uint8_t i = 0; i < sizeof(f); i++) Serial.write(f[i]);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
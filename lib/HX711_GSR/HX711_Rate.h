@@ -0,0 +1,65 @@
+/**
+ * Header       HX711_Rate.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Flow rate [g/s] from the timestamped sample stream by a 
+ *              linear regression over the last window samples. add() runs
+ *              on the per-sample path and costs the same for every sample:
+ *              the regression sums are kept in 64-bit integers of raw 
+ *              digits and us relative to the oldest sample of the window,
+ *              the leaving sample is subtracted and the origin moved with
+ *              closed formulas, so the sums stay exact however long it runs.
+ *              The uncertainty is the standard error of the slope from the
+ *              residuals of the fit. A gap of more than 1 s between two 
+ *              samples restarts the window. print() shows the estimate
+ *              as text, writeFrame() sends it as binary frame for every
+ *              sample.
+ * 
+ * Constructor  scale        the HX711_GSR whose calibration converts digits
+ * arguments    window       samples in the regression, 3 .. HX711_RATE_MAX
+ *                           (16 on AVR, 32 elsewhere)
+ */
+#ifndef _HX711_RATE_H_
+#define _HX711_RATE_H_
+#include "HX711_GSR.h"
+
+#ifndef HX711_RATE_MAX
+    #ifdef __AVR__
+        #define HX711_RATE_MAX 16
+    #else
+        #define HX711_RATE_MAX 32
+    #endif
+#endif
+
+class HX711_Rate
+{
+    public:
+        HX711_Rate(HX711_GSR &scale, uint8_t window) : _scale(scale) { setWindow(window); }
+
+        void    setWindow(uint8_t window);
+        void    reset();
+        void    add(int32_t raw, uint32_t timestamp);
+        bool    isValid() { return _n >= 3; }
+        float   getRate();              // [g/s]
+        float   getUncertainty();       // standard error of the rate [g/s]
+        uint32_t getSamples() { return _samples; }
+        void    print();
+        void    writeFrame();
+
+    private:
+        void    compute();
+
+        HX711_GSR &_scale;
+        uint8_t  _window = 16;
+        uint8_t  _n = 0;                // samples in the window
+        uint8_t  _head = 0;             // index of the oldest sample
+        int32_t  _y[HX711_RATE_MAX];    // raw values
+        uint32_t _t[HX711_RATE_MAX];    // timestamps [us]
+        uint32_t _origin = 0;           // timestamp of the oldest sample, x = t - origin
+        int64_t  _sx = 0, _sy = 0, _sxx = 0, _sxy = 0, _syy = 0;
+        bool     _dirty = true;
+        float    _slope = 0.0f;         // [digits/us]
+        float    _se = 0.0f;
+        uint32_t _samples = 0;
+};
+#endif
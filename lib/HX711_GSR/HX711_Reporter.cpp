@@ -0,0 +1,127 @@
+/**
+ * Class        HX711_Reporter.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Deadband, stability and heartbeat reporting, see
+ *              HX711_Reporter.h
+ */
+#include "HX711_Reporter.h"
+#include "HX711_Crc.h"
+#include "HX711_Profile.h"
+
+constexpr uint8_t FRAME_SYNC = 0xA5;
+
+/**
+ * deadband and stability band [g], heartbeat [s], 0 = none
+ */
+void HX711_Reporter::start(float deadband, uint16_t heartbeat, float stability)
+{
+	float m = fabs(_scale.get_m());
+	_deadband = m > 0.0f ? (int32_t)(deadband * HX711_REPORT_FILTER / m) : 0;
+	_band = m > 0.0f ? (int32_t)(stability * HX711_REPORT_FILTER / m) : 0;
+	_heartbeat = heartbeat * 1000000UL;
+	_head = _filled = _quiet = _pending = 0;
+	_sum = 0;
+	_stable = false;
+	_reports = _samples = 0;
+	_running = true;
+}
+
+/**
+ * Per-sample path, constant time
+ */
+void HX711_Reporter::onSample(int32_t raw, uint32_t timestamp)
+{
+	if (!_running) return;
+	_sum += raw - (_filled == HX711_REPORT_FILTER ? _ring[_head] : 0);
+	_ring[_head] = raw;
+	_head = (_head + 1) % HX711_REPORT_FILTER;
+	_timestamp = timestamp;
+	_samples++;
+	if (_filled < HX711_REPORT_FILTER)
+	{
+		_filled++;
+		if (_filled < HX711_REPORT_FILTER) return;
+		_anchor = _sum;
+		_sent = _sum;
+		_sentAt = timestamp;
+		_pending |= REPORT_MOVE;				// the first value
+		return;
+	}
+
+	if (labs(_sum - _anchor) > _band)
+	{
+		_anchor = _sum;
+		_quiet = 0;
+		if (_stable)
+		{
+			_stable = false;
+			_pending |= REPORT_STABILITY;
+		}
+	}
+	else if (_quiet < HX711_REPORT_SETTLE && ++_quiet == HX711_REPORT_SETTLE)
+	{
+		_stable = true;
+		_pending |= REPORT_STABILITY;
+	}
+	if (labs(_sum - _sent) > _deadband || _deadband == 0) _pending |= REPORT_MOVE;
+	if (_heartbeat && timestamp - _sentAt >= _heartbeat) _pending |= REPORT_HEARTBEAT;
+	if (_pending)
+	{
+		_sent = _sum;
+		_sentAt = timestamp;
+	}
+}
+
+/**
+ * The latest report, clears the pending reasons
+ */
+HX711_Report HX711_Reporter::getReport()
+{
+	HX711_Report r;
+	r.weight = _scale.get_m() * _sum / HX711_REPORT_FILTER + _scale.get_b();
+	r.timestamp = _timestamp;
+	r.flags = _pending | (_stable ? REPORT_STABLE : 0);
+	_pending = 0;
+	_reports++;
+	return r;
+}
+
+/**
+ * One line: time [ms], weight [g] with 0.1 g, S stable or M moving
+ *   123456 250.3 S
+ */
+void HX711_Reporter::printText(const HX711_Report &r)
+{
+	char buf[32];
+	char w[12];
+	dtostrf(r.weight, 1, 1, w);
+	snprintf_P(buf, sizeof(buf), PSTR("%lu %s %c\r\n"), (unsigned long)(r.timestamp / 1000), w,
+		r.flags & REPORT_STABLE ? 'S' : 'M');
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
+/**
+ * Binary frame of 12 bytes, little endian:
+ *   uint8    0xA5 sync
+ *   uint8    flags, REPORT_...
+ *   uint32   timestamp [ms]
+ *   float    weight [g]
+ *   uint16   CRC-16/CCITT (0xFFFF, 0x1021) of the 10 bytes before
+ */
+void HX711_Reporter::writeFrame(const HX711_Report &r)
+{
+	uint8_t  f[12];
+	uint32_t ms = r.timestamp / 1000;
+	f[0] = FRAME_SYNC;
+	f[1] = r.flags;
+	memcpy(f + 2, &ms, 4);
+	memcpy(f + 6, &r.weight, 4);
+	uint16_t crc = HX711_Crc::of(f, 10);
+	memcpy(f + 10, &crc, 2);
+	PROFILE_START(t);
+	for (uint8_t i = 0; i < sizeof(f); i++) Serial.write(f[i]);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
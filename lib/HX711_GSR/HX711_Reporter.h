@@ -0,0 +1,81 @@
+/**
+ * Header       HX711_Reporter.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Change-only reporting: instead of every reading only what
+ *              tells the host something new is sent. onSample() runs on the
+ *              per-sample path and filters by a sliding mean over the last
+ *              8 samples. A report is due when the mean moves more than the
+ *              deadband from the last reported value, when the load becomes
+ *              stable or starts moving, and as heartbeat when nothing was
+ *              sent for the heartbeat period, so the host can tell a still
+ *              load from a dead link.
+ *              Stable means the mean has stayed within the stability band
+ *              of where it settled for 16 samples.
+ *              Deadband and band are converted to digits once in start(),
+ *              the per-sample path compares integers only. A deadband of 0
+ *              reports every sample.
+ *              The loop takes the latest report with getReport(), if it
+ *              falls behind, reports are merged, the newest value wins and
+ *              the reasons add up. A report is sent as text line or as
+ *              binary frame, see printText() and writeFrame().
+ *
+ * Constructor  scale        the HX711_GSR whose calibration converts digits
+ */
+#ifndef _HX711_REPORTER_H_
+#define _HX711_REPORTER_H_
+#include "HX711_GSR.h"
+
+constexpr uint8_t HX711_REPORT_FILTER = 8;
+constexpr uint8_t HX711_REPORT_SETTLE = 16;
+
+// reasons of a report, the stable flag is bit 7
+constexpr uint8_t REPORT_MOVE      = 0x01;
+constexpr uint8_t REPORT_STABILITY = 0x02;
+constexpr uint8_t REPORT_HEARTBEAT = 0x04;
+constexpr uint8_t REPORT_STABLE    = 0x80;
+
+struct HX711_Report
+{
+    float    weight;          // mean of the last 8 samples [g]
+    uint32_t timestamp;       // of the newest sample [us]
+    uint8_t  flags;           // REPORT_...
+};
+
+class HX711_Reporter
+{
+    public:
+        HX711_Reporter(HX711_GSR &scale) : _scale(scale) {}
+
+        void     start(float deadband, uint16_t heartbeat, float stability = 0.5f);
+        void     stop() { _running = false; }
+        bool     isRunning() { return _running; }
+        void     onSample(int32_t raw, uint32_t timestamp);
+        bool     available() { return _pending != 0; }
+        HX711_Report getReport();
+        uint32_t getReports() { return _reports; }
+        uint32_t getSamples() { return _samples; }
+        void     printText(const HX711_Report &r);
+        void     writeFrame(const HX711_Report &r);
+
+    private:
+        HX711_GSR &_scale;
+        int32_t  _ring[HX711_REPORT_FILTER];
+        uint8_t  _head = 0;
+        uint8_t  _filled = 0;
+        int32_t  _sum = 0;                      // [digits * 8]
+        int32_t  _sent = 0;                     // last reported sum
+        int32_t  _anchor = 0;                   // sum where the load settled
+        int32_t  _deadband = 0;                 // [digits * 8]
+        int32_t  _band = 0;                     // stability band, same unit
+        uint32_t _heartbeat = 0;                // [us]
+        uint32_t _sentAt = 0;
+        uint32_t _timestamp = 0;
+        uint32_t _reports = 0;
+        uint32_t _samples = 0;
+        uint8_t  _quiet = 0;                    // samples within the band
+        uint8_t  _pending = 0;                  // reasons not yet taken
+        bool     _stable = false;
+        bool     _running = false;
+};
+#endif
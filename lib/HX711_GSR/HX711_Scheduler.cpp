@@ -0,0 +1,121 @@
+/**
+ * Class        HX711_Scheduler.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Duty-cycled sampling with powerdown() / powerup(), 
+ *              see HX711_Scheduler.h
+ */
+#include "HX711_Scheduler.h"
+#include "HX711_Timestamp.h"
+
+void HX711_Scheduler::start()
+{
+	uint32_t now = millis();
+	_startedAt = now;
+	_awakeMs   = 0;
+	_discarded = 0;
+	_timeouts  = 0;
+	_maxWakeLatencyMs = 0;
+	_dueAt = now;
+	wake(now);
+}
+
+/**
+ * Leave the HX711 powered up for normal operation
+ */
+void HX711_Scheduler::stop()
+{
+	if (_state == State::SLEEPING) _scale.powerup();
+	else if (_state != State::STOPPED) _awakeMs += millis() - _wokeAt;
+	_state = State::STOPPED;
+}
+
+/**
+ * Power up now, whenever the wake was due
+ */
+void HX711_Scheduler::wake(uint32_t now)
+{
+	_scale.powerup();
+	_wokeAt = now;
+	_wokeUs = HX711_Timestamp::now();
+	_lastSampleAt = now;
+	_sum   = 0;
+	_n     = 0;
+	_state = State::SETTLING;
+}
+
+void HX711_Scheduler::sleep(uint32_t now)
+{
+	_awakeMs += now - _wokeAt;
+	_scale.powerdown();
+	_state = State::SLEEPING;
+}
+
+/**
+ * Advance the state machine, returns true when a new reading is available
+ * or the chip did not deliver in time, getStatus() tells which
+ */
+bool HX711_Scheduler::update()
+{
+	uint32_t now = millis();
+	switch (_state)
+	{
+		case State::STOPPED:
+			return false;
+
+		case State::SLEEPING:
+			if (now - _dueAt >= _intervalMs)
+			{
+				uint32_t late = now - _dueAt;
+				_dueAt += late - late % _intervalMs;	// skip wakes missed entirely
+				wake(now);
+			}
+			return false;
+
+		case State::SETTLING:
+		case State::MEASURING:
+			if (!_scale.isReady())
+			{
+				uint32_t limit = _timeoutMs + (_state == State::SETTLING ? _settleMs : 0);
+				if (now - _lastSampleAt < limit) return false;
+				_timeouts++;			// disconnected or hung, try again at the next interval
+				_status = HX711_STATUS::TIMEOUT;
+				sleep(now);
+				return true;
+			}
+			{
+				int32_t v = _scale.getRawValue();
+				now = millis();
+				_lastSampleAt = now;
+				if (_state == State::SETTLING)
+				{
+					if (_scale.get_timestamp() - _wokeUs < 1000UL * _settleMs)
+					{
+						_discarded++;			// converted before the chip had settled
+						return false;
+					}
+					_wakeLatencyMs = now - _wokeAt;
+					if (_wakeLatencyMs > _maxWakeLatencyMs) _maxWakeLatencyMs = _wakeLatencyMs;
+					_state = State::MEASURING;
+				}
+				_sum += v;
+				if (++_n < _nbr) return false;
+			}
+			_raw = _sum / _nbr;
+			_status = HX711_STATUS::OK;
+			sleep(now);
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Share of the time since start() the HX711 was powered up
+ */
+float HX711_Scheduler::getDutyCycle()
+{
+	uint32_t now = millis();
+	uint32_t awake = _awakeMs;
+	if (_state == State::SETTLING || _state == State::MEASURING) awake += now - _wokeAt;
+	return now == _startedAt ? 1.0f : (float)awake / (float)(now - _startedAt);
+}
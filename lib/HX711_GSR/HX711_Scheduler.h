@@ -0,0 +1,85 @@
+/**
+ * Header       HX711_Scheduler.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Duty-cycled low power sampling. Between measurement bursts the
+ *              HX711 is powered down. At every interval it is powered up,
+ *              the conversions during the settling time after wake are 
+ *              discarded, then nbr samples are averaged into one reading and
+ *              the chip goes back to power down. update() must be called 
+ *              from loop(), it never blocks.
+ * 
+ *              The wakes follow a fixed schedule that does not drift when
+ *              loop() is late, but settling, latency and duty cycle count
+ *              from the actual power up: a wake that comes late still
+ *              discards the conversions of the whole settling time.
+ *              The scheduler reports the achieved duty cycle (share of time
+ *              the HX711 was powered up) and the latency from wake to the 
+ *              first valid sample.
+ * 
+ *              If no conversion is ready within the timeout while the chip
+ *              is powered up (after the settling time when it has just been
+ *              woken), e.g. because it is disconnected, the burst is given
+ *              up: the chip is powered down, update() returns true with
+ *              getStatus() TIMEOUT and the next interval tries again.
+ * 
+ * Constructor  scale        the HX711_GSR to drive
+ * arguments    intervalMs   time between two readings, e.g. 10000
+ *              nbr          samples averaged per reading
+ *              settleMs     settling time after power up, 400 ms at 10 SPS,
+ *                           50 ms at 80 SPS (datasheet)
+ */
+#ifndef _HX711_SCHEDULER_H_
+#define _HX711_SCHEDULER_H_
+#include "HX711_GSR.h"
+
+class HX711_Scheduler
+{
+    public:
+        HX711_Scheduler(HX711_GSR &scale, uint32_t intervalMs, uint8_t nbr, uint16_t settleMs = 400) :
+            _scale(scale), _intervalMs(intervalMs), _nbr(nbr), _settleMs(settleMs) {}
+
+        void     start();
+        void     stop();
+        bool     isRunning() { return _state != State::STOPPED; }
+        bool     update();              // true when a new reading is available or the chip timed out
+        int32_t  getRawValue() { return _raw; }
+        double   getWeight() { return _scale.toWeight(_raw); }
+        void     setInterval(uint32_t intervalMs) { _intervalMs = intervalMs; }
+        uint32_t getInterval() { return _intervalMs; }
+        void     setSettleTime(uint16_t settleMs) { _settleMs = settleMs; }
+        void     setTimeout(uint16_t timeoutMs) { _timeoutMs = timeoutMs; }
+        HX711_STATUS getStatus() { return _status; }            // OK or TIMEOUT for the last update() == true
+        uint32_t getTimeouts() { return _timeouts; }
+        float    getDutyCycle();        // 0..1
+        uint16_t getWakeLatency() { return _wakeLatencyMs; }     // last wake to first valid sample [ms]
+        uint16_t getMaxWakeLatency() { return _maxWakeLatencyMs; }
+        uint32_t getDiscarded() { return _discarded; }           // warm-up samples thrown away
+
+    private:
+        enum class State { STOPPED, SLEEPING, SETTLING, MEASURING };
+        void     wake(uint32_t now);
+        void     sleep(uint32_t now);
+
+        HX711_GSR &_scale;
+        uint32_t _intervalMs;
+        uint8_t  _nbr;
+        uint16_t _settleMs;
+        uint16_t _timeoutMs  = 1000;
+        State    _state = State::STOPPED;
+        HX711_STATUS _status = HX711_STATUS::OK;
+        uint32_t _dueAt      = 0;       // millis() the last wake was scheduled for
+        uint32_t _wokeAt     = 0;       // millis() of the last power up
+        uint32_t _wokeUs     = 0;       // the same in the time base of the sample timestamps
+        uint32_t _lastSampleAt = 0;     // millis() of the last wake or conversion
+        uint32_t _startedAt  = 0;
+        uint32_t _awakeMs    = 0;       // total time powered up
+        int32_t  _sum        = 0;
+        uint8_t  _n          = 0;
+        int32_t  _raw        = 0;
+        uint16_t _wakeLatencyMs    = 0;
+        uint16_t _maxWakeLatencyMs = 0;
+        uint32_t _discarded  = 0;
+        uint32_t _timeouts   = 0;
+};
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Header       HX711_Snapshot.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Seqlock register which publishes a value of type T from one
+ *              producer (e.g. an ISR) to readers in another context.
+ *              On an 8-bit MCU a multi-byte value read while an ISR writes it
+ *              can be torn; the seqlock avoids this without disabling
+ *              interrupts: the producer makes the sequence odd, writes and
+ *              makes it even again, a reader copies the value and retries
+ *              when the sequence was odd or has changed meanwhile.
+ *              The producer never waits. A reader must not interrupt the
+ *              producer (e.g. an ISR reading what loop() writes), it would
+ *              spin forever on the odd sequence, use tryRead() there.
+ *              HX711_GSR publishes the latest sample through it,
+ *              HX711_Timestamp the DOUT edge its ISR captured.
+ *
+ * Usage        HX711_Snapshot<HX711_Sample> latest;
+ *              latest.write(s);             // producer
+ *              HX711_Sample s = latest.read(); // reader
+ */
+#ifndef _HX711_SNAPSHOT_H_
+#define _HX711_SNAPSHOT_H_
+#include <Arduino.h>
+
+#ifdef ARDUINO_SIM
+    // host: producer and reader may be threads on different cores
+    #include <atomic>
+    typedef std::atomic<uint32_t> HX711_SeqCount;
+    #define HX711_SNAPSHOT_FENCE() std::atomic_thread_fence(std::memory_order_seq_cst)
+#else
+    // single core MCU: a byte is read atomically, only the compiler may reorder
+    typedef volatile uint8_t HX711_SeqCount;
+    #define HX711_SNAPSHOT_FENCE() __asm__ __volatile__("" ::: "memory")
+#endif
+
+template <typename T> class HX711_Snapshot
+{
+    public:
+        // inlined, so an ISR in IRAM (ESP8266) never calls into flash
+        __attribute__((always_inline)) void write(const T &value)
+        {
+            uint8_t s = _seq;
+            _seq = (uint8_t)(s + 1);        // odd: write in progress
+            HX711_SNAPSHOT_FENCE();
+            _data = value;
+            HX711_SNAPSHOT_FENCE();
+            _seq = (uint8_t)(s + 2);
+        }
+
+        // false if the producer was writing, value is then undefined
+        bool tryRead(T &value) const
+        {
+            uint8_t s = _seq;
+            if (s & 1) return false;
+            HX711_SNAPSHOT_FENCE();
+            value = _data;
+            HX711_SNAPSHOT_FENCE();
+            return (uint8_t)_seq == s;
+        }
+
+        T read() const
+        {
+            T value;
+            while (! tryRead(value)) _retries++;
+            return value;
+        }
+
+        uint8_t get_sequence() const { return _seq; }
+        uint32_t get_retries() const { return _retries; }
+
+    private:
+        HX711_SeqCount _seq{0};
+        T _data{};
+        mutable uint32_t _retries = 0;
+};
+#endif
@@ -0,0 +1,137 @@
+/**
+ * Class        HX711_Summary.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Windowed summary statistics, see HX711_Summary.h
+ */
+#include "HX711_Summary.h"
+#include "HX711_Crc.h"
+#include "HX711_Profile.h"
+
+constexpr uint8_t  FRAME_SYNC = 0xA6;
+constexpr uint8_t  FRAME_RAW  = 0x80;       // window byte: values in digits
+constexpr uint32_t PERIOD_MAX = 3600000UL;  // [ms], us timestamps wrap after 71 min
+
+/**
+ * Another window length [ms], returns its index or -1
+ */
+int8_t HX711_Summary::add(uint32_t periodMs)
+{
+	if (_nbr >= HX711_SUMMARY_MAX || periodMs == 0 || periodMs > PERIOD_MAX) return -1;
+	Window &w = _win[_nbr];
+	w.period = periodMs * 1000UL;
+	w.n = 0;
+	w.ready = w.started = false;
+	return _nbr++;
+}
+
+/**
+ * Per-sample path, constant time per window
+ */
+void HX711_Summary::onSample(int32_t raw, uint32_t timestamp)
+{
+	for (uint8_t i = 0; i < _nbr; i++)
+	{
+		Window &w = _win[i];
+		if (w.n > 0 && timestamp - w.start >= w.period)
+		{
+			close(w);
+			w.start += (timestamp - w.start) / w.period * w.period;
+		}
+		if (w.n == 0)
+		{
+			if (!w.started) w.start = timestamp;
+			w.started = true;
+			w.ref = w.min = w.max = raw;
+			w.sum = w.sumSq = 0;
+		}
+		int32_t d = raw - w.ref;
+		w.sum += d;
+		w.sumSq += (int64_t)d * d;
+		if (raw < w.min) w.min = raw;
+		if (raw > w.max) w.max = raw;
+		w.n++;
+	}
+}
+
+void HX711_Summary::close(Window &w)
+{
+	if (w.ready) _overruns++;
+	float n = w.n;
+	float sum = (float)w.sum;
+	w.done.start = w.start;
+	w.done.n = w.n;
+	w.done.min = w.min;
+	w.done.max = w.max;
+	w.done.mean = w.ref + sum / n;
+	w.done.std = w.n > 1 ? sqrt(fmax(((float)w.sumSq - sum * sum / n) / (n - 1.0f), 0.0f)) : 0.0f;
+	w.ready = true;
+	w.n = 0;
+}
+
+/**
+ * The record of the last closed window, takes it
+ */
+HX711_Stats HX711_Summary::getStats(uint8_t w)
+{
+	if (w >= _nbr) return HX711_Stats{};
+	_win[w].ready = false;
+	return _win[w].done;
+}
+
+/**
+ * Digits to grams unless raw, offset false for a difference
+ */
+float HX711_Summary::toOutput(float v, bool offset)
+{
+	if (_raw) return v;
+	return _scale.get_m() * v + (offset ? _scale.get_b() : 0.0f);
+}
+
+/**
+ * One line: window, start [ms], n, mean, min, max, std [g or digits]
+ *   S1 120000 4800 250.31 249.72 250.93 0.201
+ */
+void HX711_Summary::printText(uint8_t w, const HX711_Stats &s)
+{
+	char buf[96];
+	char v[4][14];
+	float lo = toOutput(s.min, true), hi = toOutput(s.max, true);
+	uint8_t dec = _raw ? 1 : 2;
+	dtostrf(toOutput(s.mean, true), 1, dec, v[0]);
+	dtostrf(lo < hi ? lo : hi, 1, dec, v[1]);
+	dtostrf(lo < hi ? hi : lo, 1, dec, v[2]);
+	dtostrf(fabs(toOutput(s.std, false)), 1, dec + 1, v[3]);
+	snprintf_P(buf, sizeof(buf), PSTR("S%u %lu %lu %s %s %s %s\r\n"), w, (unsigned long)(s.start / 1000), (unsigned long)s.n, 
+		v[0], v[1], v[2], v[3]);
+	PROFILE_START(t);
+	Serial.print(buf);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
+/**
+ * Binary frame of 28 bytes, little endian:
+ *   uint8    0xA6 sync
+ *   uint8    window, bit 7 set if the values are digits
+ *   uint32   start [ms]
+ *   uint32   n
+ *   float    mean, min, max, std [g or digits]
+ *   uint16   CRC-16/CCITT (0xFFFF, 0x1021) of the 26 bytes before
+ */
+void HX711_Summary::writeFrame(uint8_t w, const HX711_Stats &s)
+{
+	uint8_t  f[28];
+	uint32_t ms = s.start / 1000;
+	float    lo = toOutput(s.min, true), hi = toOutput(s.max, true);
+	float    v[4] = { toOutput(s.mean, true), lo < hi ? lo : hi, lo < hi ? hi : lo, (float)fabs(toOutput(s.std, false)) };
+	f[0] = FRAME_SYNC;
+	f[1] = w | (_raw ? FRAME_RAW : 0);
+	memcpy(f + 2, &ms, 4);
+	memcpy(f + 6, &s.n, 4);
+	memcpy(f + 10, v, 16);
+	uint16_t crc = HX711_Crc::of(f, 26);
+	memcpy(f + 26, &crc, 2);
+	PROFILE_START(t);
+	for (uint8_t i = 0; i < sizeof(f); i++) Serial.write(f[i]);
+	PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
@@ -0,0 +1,83 @@
+/**
+ * Header       HX711_Summary.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Summary statistics over fixed time windows instead of every
+ *              sample: count, mean, min, max and standard deviation per
+ *              second, per minute or any period up to one hour, for up to
+ *              HX711_SUMMARY_MAX window lengths side by side.
+ *              onSample() runs on the per-sample path and updates each
+ *              window in constant time and memory: min, max and the sums of
+ *              the samples and their squares, taken relative to the first
+ *              sample of the window in 64-bit integers, so they are exact
+ *              and the variance does not cancel out. Windows are aligned to
+ *              the first sample and follow each other without gaps; a window
+ *              without samples is skipped.
+ *              When a window closes, its record waits for the loop until the
+ *              next one closes, an unread record is overwritten and counted.
+ *              Records hold raw digits, they are sent in grams or, with
+ *              setRaw(true), in digits, as text line or binary frame.
+ *              About 64 bytes per window on the Uno.
+ *
+ * Constructor  scale        the HX711_GSR whose calibration converts digits
+ */
+#ifndef _HX711_SUMMARY_H_
+#define _HX711_SUMMARY_H_
+#include "HX711_GSR.h"
+
+#ifndef HX711_SUMMARY_MAX
+    #define HX711_SUMMARY_MAX 3
+#endif
+
+// closed window in raw digits
+struct HX711_Stats
+{
+    uint32_t start;           // timestamp of the window start [us]
+    uint32_t n;               // samples, 288000 in an hour at 80 SPS
+    int32_t  min;
+    int32_t  max;
+    float    mean;
+    float    std;             // sample standard deviation, 0 for n < 2
+};
+
+class HX711_Summary
+{
+    public:
+        HX711_Summary(HX711_GSR &scale) : _scale(scale) {}
+
+        int8_t   add(uint32_t periodMs);
+        void     clear() { _nbr = 0; }
+        void     setRaw(bool raw) { _raw = raw; }
+        void     onSample(int32_t raw, uint32_t timestamp);
+        uint8_t  getWindows() { return _nbr; }
+        uint32_t getPeriod(uint8_t w) { return w < _nbr ? _win[w].period / 1000 : 0; }
+        bool     available(uint8_t w) { return w < _nbr && _win[w].ready; }
+        HX711_Stats getStats(uint8_t w);
+        uint16_t getOverruns() { return _overruns; }
+        void     printText(uint8_t w, const HX711_Stats &s);
+        void     writeFrame(uint8_t w, const HX711_Stats &s);
+
+    private:
+        struct Window
+        {
+            uint32_t period;          // [us]
+            uint32_t start;           // [us]
+            int32_t  ref;             // first sample, origin of the sums
+            int64_t  sum;             // of raw - ref
+            int64_t  sumSq;
+            int32_t  min, max;
+            uint32_t n;
+            bool     ready;           // done not yet taken
+            bool     started;
+            HX711_Stats done;
+        };
+        void     close(Window &w);
+        float    toOutput(float v, bool offset);
+
+        HX711_GSR &_scale;
+        Window   _win[HX711_SUMMARY_MAX];
+        uint8_t  _nbr = 0;
+        uint16_t _overruns = 0;
+        bool     _raw = false;
+};
+#endif
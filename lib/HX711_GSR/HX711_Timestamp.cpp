@@ -0,0 +1,160 @@
+/**
+ * Class        HX711_Timestamp.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Hardware timestamps of the DOUT ready edge, see HX711_Timestamp.h
+ */
+#include "HX711_Timestamp.h"
+#include "HX711_Snapshot.h"
+
+// an edge captured by the ISR, published to take() through a seqlock
+struct HX711_Capture
+{
+	uint32_t at;					// [us] or CPU cycles on the ESP8266
+	bool     valid;					// false from arm() until the edge
+};
+
+#if defined(__AVR__) && defined(HX711_ICP1)
+
+static volatile uint32_t t1Overflows = 0;	// a tick is 0.5 us, an overflow 32768 us
+static volatile bool     armed = false;
+static HX711_Snapshot<HX711_Capture> capture;
+
+ISR(TIMER1_OVF_vect)
+{
+	t1Overflows++;
+}
+
+ISR(TIMER1_CAPT_vect)
+{
+	if (!armed) return;
+	uint16_t icr = ICR1;
+	uint32_t ovf = t1Overflows;
+	if ((TIFR1 & _BV(TOV1)) && icr < 0x8000) ovf++;	// overflow pending, not yet counted
+	capture.write({ ovf << 15 | icr >> 1, true });
+	armed = false;
+}
+
+/**
+ * Timer1 in us: the overflows count units of 2^15 us, so the result
+ * wraps at 2^32 us like micros() and differences stay valid
+ */
+static uint32_t micros1()
+{
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t t = TCNT1;
+	uint32_t ovf = t1Overflows;
+	if ((TIFR1 & _BV(TOV1)) && t < 0x8000) ovf++;
+	SREG = sreg;
+	return ovf << 15 | t >> 1;
+}
+
+void HX711_Timestamp::begin(uint8_t pinDOUT)
+{
+	(void)pinDOUT;
+	pinMode(8, INPUT);				// ICP1
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11);				// normal mode, clk/8, capture on falling edge
+	TIFR1  = _BV(ICF1) | _BV(TOV1);
+	TIMSK1 = _BV(ICIE1) | _BV(TOIE1);
+}
+
+/**
+ * The ISR cannot run meanwhile, so it and arm() never write the 
+ * capture at the same time
+ */
+void HX711_Timestamp::arm()
+{
+	uint8_t sreg = SREG;
+	cli();
+	TIFR1 = _BV(ICF1);				// forget edges of the data bits
+	capture.write({ 0, false });
+	armed = true;
+	SREG = sreg;
+}
+
+uint32_t HX711_Timestamp::now()
+{
+	return micros1();
+}
+
+/**
+ * Interrupts stay enabled, the read retries if the ISR wrote meanwhile
+ */
+uint32_t HX711_Timestamp::take()
+{
+	armed = false;
+	HX711_Capture c = capture.read();
+	return c.valid ? c.at : micros1();
+}
+
+#elif defined(ESP8266)
+
+static volatile bool     armed = false;
+static HX711_Snapshot<HX711_Capture> capture;
+
+static IRAM_ATTR void doutEdge()
+{
+	if (!armed) return;
+	capture.write({ ESP.getCycleCount(), true });
+	armed = false;
+}
+
+void HX711_Timestamp::begin(uint8_t pinDOUT)
+{
+	attachInterrupt(digitalPinToInterrupt(pinDOUT), doutEdge, FALLING);
+}
+
+void HX711_Timestamp::arm()
+{
+	noInterrupts();
+	capture.write({ 0, false });
+	armed = true;
+	interrupts();
+}
+
+uint32_t HX711_Timestamp::now()
+{
+	return micros();
+}
+
+/**
+ * The cycle counter wraps after 53 s at 80 MHz, the age of the 
+ * capture is always far shorter. Only the two clocks are read with
+ * interrupts off, the capture comes through the seqlock.
+ */
+uint32_t HX711_Timestamp::take()
+{
+	armed = false;
+	HX711_Capture c = capture.read();
+	noInterrupts();
+	uint32_t t = micros();
+	uint32_t cycles = ESP.getCycleCount();
+	interrupts();
+	if (c.valid) t -= (cycles - c.at) / ESP.getCpuFreqMHz();
+	return t;
+}
+
+#else
+
+void HX711_Timestamp::begin(uint8_t pinDOUT)
+{
+	(void)pinDOUT;
+}
+
+void HX711_Timestamp::arm()
+{
+}
+
+uint32_t HX711_Timestamp::now()
+{
+	return micros();
+}
+
+uint32_t HX711_Timestamp::take()
+{
+	return micros();
+}
+
+#endif
@@ -0,0 +1,33 @@
+/**
+ * Header       HX711_Timestamp.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Time of the DOUT falling edge, i.e. the instant the HX711 
+ *              finished a conversion, in us
+ *              - AVR with -DHX711_ICP1: Timer1 input capture. DOUT must also 
+ *                be wired to ICP1 (PIN 8). Timer1 runs at clk/8 (0.5 us), a
+ *                32-bit count of its overflows extends it to a time in us
+ *                that wraps at 2^32 like micros(). Timer1 PWM (PIN 9, 10)
+ *                is no longer available.
+ *              - ESP8266: the CPU cycle counter is latched in a DOUT falling
+ *                edge interrupt (IRAM)
+ *              - otherwise: micros() when DOUT is seen LOW by the wait loop
+ *              All times are in the time base of now().
+ * 
+ *              arm() after each readout, since the data bits toggle DOUT too;
+ *              take() when DOUT is LOW returns the captured edge or, when the
+ *              conversion was already finished at arm(), the current time.
+ */
+#ifndef _HX711_TIMESTAMP_H_
+#define _HX711_TIMESTAMP_H_
+#include <Arduino.h>
+
+class HX711_Timestamp
+{
+    public:
+        static void     begin(uint8_t pinDOUT);
+        static void     arm();
+        static uint32_t take();
+        static uint32_t now();
+};
+#endif
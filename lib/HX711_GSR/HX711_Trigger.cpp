@@ -0,0 +1,133 @@
+/**
+ * Class        HX711_Trigger.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Setpoint outputs with in-flight learning for filling 
+ *              control, see HX711_Trigger.h
+ */
+#include "HX711_Trigger.h"
+#include "HX711_Timestamp.h"
+
+constexpr uint8_t FINAL_SAMPLES = 8;	// averaged for the final weight
+
+/**
+ * Add a setpoint [g] driving pin, which is set to safeLevel until start(),
+ * returns its index or -1 if all are used
+ */
+int8_t HX711_Trigger::add(float setpoint, float hysteresis, uint8_t pin, uint8_t safeLevel, bool activeHigh)
+{
+	if (_nbr >= HX711_MAX_TRIGGERS) return -1;
+	Trigger &t = _t[_nbr];
+	memset(&t, 0, sizeof(t));
+	t.setpoint   = setpoint;
+	t.hysteresis = hysteresis;
+	t.pin        = pin;
+	t.safeLevel  = safeLevel;
+	t.activeHigh = activeHigh;
+	t.settleMs   = 1000;
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, safeLevel);
+	return _nbr++;
+}
+
+void HX711_Trigger::setLearning(uint8_t i, bool on, float gain, uint16_t settleMs)
+{
+	if (i >= _nbr) return;
+	_t[i].gain = on ? gain : 0.0f;
+	_t[i].settleMs = settleMs;
+}
+
+void HX711_Trigger::start()
+{
+	for (uint8_t i = 0; i < _nbr; i++)
+	{
+		_t[i].n = 0;
+		output(_t[i], false, 0);
+	}
+	memset(&_latency, 0, sizeof(_latency));
+	_running = true;
+}
+
+/**
+ * Every pin goes to its safe level
+ */
+void HX711_Trigger::stop()
+{
+	_running = false;
+	for (uint8_t i = 0; i < _nbr; i++)
+	{
+		_t[i].active = _t[i].safeLevel == (_t[i].activeHigh ? HIGH : LOW);
+		_t[i].n = 0;
+		digitalWrite(_t[i].pin, _t[i].safeLevel);
+	}
+}
+
+/**
+ * Set the pin, the latency counts from the conversion to the pin change
+ */
+void HX711_Trigger::output(Trigger &t, bool active, uint32_t timestamp)
+{
+	t.active = active;
+	digitalWrite(t.pin, active == t.activeHigh ? HIGH : LOW);
+	if (timestamp == 0) return;
+	uint32_t lat = HX711_Timestamp::now() - timestamp;
+	if (_latency.n == 0 || lat < _latency.min) _latency.min = lat;
+	if (lat > _latency.max) _latency.max = lat;
+	_latency.sum += lat;
+	_latency.n++;
+}
+
+/**
+ * Per-sample path: compare, switch, learn. A multiply-add per sample
+ * and setpoint, no division, no averaging.
+ */
+void HX711_Trigger::onSample(int32_t raw, uint32_t timestamp)
+{
+	if (!_running) return;
+	float w = _scale.get_m() * raw + _scale.get_b();
+	for (uint8_t i = 0; i < _nbr; i++)
+	{
+		Trigger &t = _t[i];
+		float cut = t.setpoint - t.inflight;
+		if (!t.active && w >= cut)
+		{
+			output(t, true, timestamp);
+			t.cutAt = timestamp;
+			t.sum = 0.0f;
+			t.n = t.gain > 0.0f ? 1 : 0;
+			t.cycles++;
+		}
+		else if (t.active && w < cut - t.hysteresis)
+		{
+			output(t, false, timestamp);
+			t.n = 0;				// removed before the weight settled
+		}
+		else if (t.n > 0 && timestamp - t.cutAt >= 1000UL * t.settleMs)
+		{
+			t.sum += w;
+			if (t.n++ < FINAL_SAMPLES) continue;
+			t.final = t.sum / FINAL_SAMPLES;
+			t.inflight += t.gain * (t.final - t.setpoint);
+			t.n = 0;
+		}
+	}
+}
+
+void HX711_Trigger::print()
+{
+	char buf[96];
+	char sp[12], fl[12], fi[12];
+	for (uint8_t i = 0; i < _nbr; i++)
+	{
+		dtostrf(_t[i].setpoint, 1, 1, sp);
+		dtostrf(_t[i].inflight, 1, 1, fl);
+		dtostrf(_t[i].final, 1, 1, fi);
+		snprintf_P(buf, sizeof(buf), PSTR("\r\nsetpoint %s g: in flight %s g, last final %s g, cycles %u "), 
+			sp, fl, fi, _t[i].cycles);
+		Serial.print(buf);
+	}
+	snprintf_P(buf, sizeof(buf), PSTR("\r\nsample to pin [us]: n %lu, min %lu, max %lu, mean %lu "),
+		(unsigned long)_latency.n, (unsigned long)_latency.min, (unsigned long)_latency.max,
+		(unsigned long)(_latency.n ? _latency.sum / _latency.n : 0));
+	Serial.print(buf);
+}
@@ -0,0 +1,85 @@
+/**
+ * Header       HX711_Trigger.h
+ * Author       loadCell project contributors
+ * 
+ * Purpose      Setpoint outputs for filling control. onSample() runs on the
+ *              per-sample path (the sample handler of HX711_GSR), so a 
+ *              setpoint switches its pin one conversion after the weight 
+ *              crossed it instead of after a whole average.
+ *              A trigger becomes active when the weight reaches
+ *              setpoint - inflight and inactive again below that level
+ *              minus the hysteresis (the next container is on the scale).
+ *              inflight is the material still falling when the valve
+ *              closes. With learning on, the final weight settleMs after 
+ *              the cutoff is averaged over 8 samples, and inflight is 
+ *              corrected by gain * (final - setpoint) for the next fill.
+ *              The time from the conversion (sample timestamp) to the pin
+ *              change is recorded as latency.
+ *              Each pin has a safe level, driven by add() and stop(): for a
+ *              valve that closes when the setpoint is reached it is the
+ *              active level, so a stopped fill never leaves it open.
+ * 
+ * Constructor  scale        the HX711_GSR whose calibration converts samples
+ */
+#ifndef _HX711_TRIGGER_H_
+#define _HX711_TRIGGER_H_
+#include "HX711_GSR.h"
+
+constexpr uint8_t HX711_MAX_TRIGGERS = 4;
+
+struct HX711_Latency
+{
+    uint32_t n;
+    uint32_t min;             // [us]
+    uint32_t max;
+    uint32_t sum;
+};
+
+class HX711_Trigger
+{
+    public:
+        HX711_Trigger(HX711_GSR &scale) : _scale(scale) {}
+
+        int8_t   add(float setpoint, float hysteresis, uint8_t pin, uint8_t safeLevel, bool activeHigh = true);
+        void     clear() { _nbr = 0; }
+        void     setSetpoint(uint8_t i, float setpoint) { if (i < _nbr) _t[i].setpoint = setpoint; }
+        void     setLearning(uint8_t i, bool on, float gain = 0.5f, uint16_t settleMs = 1000);
+        void     setInflight(uint8_t i, float grams) { if (i < _nbr) _t[i].inflight = grams; }
+        float    getInflight(uint8_t i) { return i < _nbr ? _t[i].inflight : 0.0f; }
+        float    getLastFinal(uint8_t i) { return i < _nbr ? _t[i].final : 0.0f; }
+        uint16_t getCycles(uint8_t i) { return i < _nbr ? _t[i].cycles : 0; }
+        bool     isActive(uint8_t i) { return i < _nbr && _t[i].active; }
+        void     start();
+        void     stop();
+        bool     isRunning() { return _running; }
+        void     onSample(int32_t raw, uint32_t timestamp);
+        const HX711_Latency &getLatency() { return _latency; }
+        void     print();
+
+    private:
+        struct Trigger
+        {
+            float    setpoint;
+            float    hysteresis;
+            float    inflight;        // [g] subtracted from the setpoint
+            float    gain;            // learning rate, 0 = off
+            float    final;           // last settled weight after a cutoff
+            float    sum;
+            uint32_t cutAt;           // timestamp of the cutoff [us]
+            uint16_t settleMs;
+            uint16_t cycles;
+            uint8_t  pin;
+            uint8_t  safeLevel;       // HIGH or LOW while stopped
+            uint8_t  n;               // samples of the final weight, 0 = not learning
+            bool     activeHigh;
+            bool     active;
+        };
+        void     output(Trigger &t, bool active, uint32_t timestamp);
+
+        HX711_GSR &_scale;
+        Trigger  _t[HX711_MAX_TRIGGERS];
+        uint8_t  _nbr = 0;
+        bool     _running = false;
+        HX711_Latency _latency = { 0, 0, 0, 0 };
+};
+#endif
@@ -0,0 +1,316 @@
+/**
+ * Class        LoadCellPlatform.cpp
+ * Author       loadCell project contributors
+ *
+ * Purpose      Platform scale with up to 4 load cells on HX711 sharing
+ *              one PD_SCK line, see LoadCellPlatform.h
+ *
+ * Remarks      The readout clocks all chips at once and reads every DOUT
+ *              while PD_SCK is HIGH. With 4 cells on an Uno this keeps the
+ *              pulse at about 15 us, well below the 50 us limit.
+ */
+#include <EEPROM.h>
+#include "LoadCellPlatform.h"
+#if defined(ESP8266) || defined(SIM_ESP8266)
+#define HX711_ESP_BACKEND
+#endif
+
+constexpr uint8_t  PLATFORM_MAGIC = 0xA7;
+constexpr uint16_t SETTLE_MS = 400;     // settling time after power up at 10 SPS
+constexpr uint32_t SKEW_US   = 5000;    // realign the chips beyond this
+
+LoadCellPlatform::LoadCellPlatform(const uint8_t *pinsDOUT, uint8_t nbrCells, uint8_t pinPD_SCK) :
+	_nbrCells(nbrCells > PLATFORM_MAX_CELLS ? PLATFORM_MAX_CELLS : nbrCells), _pinPD_SCK(pinPD_SCK)
+{
+	memset(&_cal, 0, sizeof(_cal));
+	memset(_shift, 0, sizeof(_shift));
+	_cal.magic = PLATFORM_MAGIC;
+	_cal.nbrCells = _nbrCells;
+	for (uint8_t j = 0; j < _nbrCells; j++) _pinsDOUT[j] = pinsDOUT[j];
+}
+
+void LoadCellPlatform::begin()
+{
+	for (uint8_t j = 0; j < _nbrCells; j++) pinMode(_pinsDOUT[j], INPUT);
+	pinMode(_pinPD_SCK, OUTPUT);
+	sync();
+}
+
+/**
+ * Power cycle all HX711 together, they restart their conversions in the
+ * same instant. The samples of the settling time are discarded.
+ */
+void LoadCellPlatform::sync()
+{
+	digitalWrite(_pinPD_SCK, HIGH);		// powerdown when HIGH for more than 60 us
+	delayMicroseconds(100);
+	digitalWrite(_pinPD_SCK, LOW);
+	_settleUntil = millis() + SETTLE_MS;
+	_syncs++;
+}
+
+/**
+ * Wait until every DOUT is LOW, at most _timeoutMs.
+ * skew is the time from the first to the last chip being ready.
+ */
+bool LoadCellPlatform::waitReady(uint32_t &skew)
+{
+	uint32_t tStart = millis();
+	uint32_t tFirst = 0;
+	bool first = false;
+	for (;;)
+	{
+		uint8_t ready = 0;
+		for (uint8_t j = 0; j < _nbrCells; j++)
+			if (digitalRead(_pinsDOUT[j]) == LOW) ready++;
+		if (ready > 0 && !first)
+		{
+			tFirst = micros();
+			first = true;
+		}
+		if (ready == _nbrCells)
+		{
+			_timestamp = micros();
+			skew = _timestamp - tFirst;
+			return true;
+		}
+		if (millis() - tStart >= _timeoutMs) return false;
+		yield();
+	}
+}
+
+/**
+ * One sample of every cell, all from the same conversion. Returns false
+ * if a chip did not get ready within the timeout.
+ */
+bool LoadCellPlatform::read(int32_t *raw)
+{
+	for (;;)
+	{
+		uint32_t skew;
+		if (!waitReady(skew)) return false;
+
+		uint32_t v[PLATFORM_MAX_CELLS] = { 0 };
+#ifdef HX711_ESP_BACKEND
+		noInterrupts();
+#endif
+		for (uint8_t i = 0; i < 24; i++)		// MSB first
+		{
+			digitalWrite(_pinPD_SCK, HIGH);
+			delayMicroseconds(1);
+			for (uint8_t j = 0; j < _nbrCells; j++)
+				v[j] = v[j] << 1 | digitalRead(_pinsDOUT[j]);
+			digitalWrite(_pinPD_SCK, LOW);
+			delayMicroseconds(1);
+		}
+		digitalWrite(_pinPD_SCK, HIGH);			// 25th pulse: channel A, gain 128
+		delayMicroseconds(1);
+		digitalWrite(_pinPD_SCK, LOW);
+#ifdef HX711_ESP_BACKEND
+		interrupts();
+#endif
+
+		if (skew > _maxSkew) _maxSkew = skew;
+		if (skew > SKEW_US) sync();
+		if ((int32_t)(millis() - _settleUntil) < 0) continue;
+
+		// 24-bit 2's complement into 32-bit
+		for (uint8_t j = 0; j < _nbrCells; j++)
+			raw[j] = (int32_t)(v[j] << 8) >> 8;
+		return true;
+	}
+}
+
+bool LoadCellPlatform::getAverage(int32_t *avg, uint8_t nbr)
+{
+	int32_t sum[PLATFORM_MAX_CELLS] = { 0 };
+	int32_t raw[PLATFORM_MAX_CELLS];
+	for (uint8_t i = 0; i < nbr; i++)
+	{
+		if (!read(raw)) return false;
+		for (uint8_t j = 0; j < _nbrCells; j++) sum[j] += raw[j];
+	}
+	for (uint8_t j = 0; j < _nbrCells; j++) avg[j] = sum[j] / nbr;
+	return true;
+}
+
+/**
+ * Total weight and center of gravity of one sample, constant time
+ */
+PlatformReading LoadCellPlatform::process(const int32_t *raw)
+{
+	PlatformReading r = { 0.0f, 0.0f, 0.0f, _timestamp, HX711_STATUS::OK };
+	float mx = 0.0f, my = 0.0f;
+	for (uint8_t j = 0; j < _nbrCells; j++)
+	{
+		if (raw[j] == 0x7FFFFF || raw[j] == -0x800000) r.status = HX711_STATUS::SATURATED;
+		float w = _cal.gain[j] * (float)(raw[j] - _cal.zero[j]);
+		r.total += w;
+		mx += w * _cal.x[j];
+		my += w * _cal.y[j];
+	}
+	if (fabs(r.total) >= _minLoad)
+	{
+		r.x = mx / r.total;
+		r.y = my / r.total;
+	}
+	return r;
+}
+
+PlatformReading LoadCellPlatform::getReading(uint8_t nbr)
+{
+	int32_t avg[PLATFORM_MAX_CELLS];
+	if (!getAverage(avg, nbr))
+		return { 0.0f, 0.0f, 0.0f, _timestamp, HX711_STATUS::TIMEOUT };
+	return process(avg);
+}
+
+/**
+ * Zero of every cell with the platform empty
+ */
+bool LoadCellPlatform::tare(uint8_t nbr)
+{
+	int32_t avg[PLATFORM_MAX_CELLS];
+	if (!getAverage(avg, nbr)) return false;
+	for (uint8_t j = 0; j < _nbrCells; j++) _cal.zero[j] = avg[j];
+	return true;
+}
+
+/**
+ * Record the cell readings with the test weight placed near corner
+ */
+bool LoadCellPlatform::shiftTest(uint8_t corner, uint8_t nbr)
+{
+	int32_t avg[PLATFORM_MAX_CELLS];
+	if (corner >= _nbrCells || !getAverage(avg, nbr)) return false;
+	for (uint8_t j = 0; j < _nbrCells; j++) _shift[corner][j] = avg[j] - _cal.zero[j];
+	_shiftDone |= 1 << corner;
+	return true;
+}
+
+/**
+ * Solve the shift test equations for the corner gains by Gaussian
+ * elimination with partial pivoting. Fails if a corner is missing or
+ * the readings do not determine the gains (weight not moved).
+ */
+bool LoadCellPlatform::calibrate(float grams)
+{
+	const uint8_t n = _nbrCells;
+	if (_shiftDone != (1 << n) - 1) return false;
+
+	float a[PLATFORM_MAX_CELLS][PLATFORM_MAX_CELLS + 1];
+	float scale = 0.0f;
+	for (uint8_t i = 0; i < n; i++)
+		for (uint8_t j = 0; j < n; j++)
+			if (fabs((float)_shift[i][j]) > scale) scale = fabs((float)_shift[i][j]);
+	if (scale == 0.0f) return false;
+	for (uint8_t i = 0; i < n; i++)
+	{
+		for (uint8_t j = 0; j < n; j++) a[i][j] = _shift[i][j] / scale;
+		a[i][n] = 1.0f;
+	}
+
+	for (uint8_t k = 0; k < n; k++)
+	{
+		uint8_t p = k;
+		for (uint8_t i = k + 1; i < n; i++)
+			if (fabs(a[i][k]) > fabs(a[p][k])) p = i;
+		if (fabs(a[p][k]) < 1e-4f) return false;
+		if (p != k)
+			for (uint8_t j = k; j <= n; j++) { float t = a[k][j]; a[k][j] = a[p][j]; a[p][j] = t; }
+		for (uint8_t i = k + 1; i < n; i++)
+		{
+			float f = a[i][k] / a[k][k];
+			for (uint8_t j = k; j <= n; j++) a[i][j] -= f * a[k][j];
+		}
+	}
+	for (int8_t i = n - 1; i >= 0; i--)
+	{
+		float s = a[i][n];
+		for (uint8_t j = i + 1; j < n; j++) s -= a[i][j] * a[j][n];
+		a[i][n] = s / a[i][i];
+	}
+	for (uint8_t j = 0; j < n; j++) _cal.gain[j] = a[j][n] * grams / scale;
+	_shiftDone = 0;
+	return true;
+}
+
+void LoadCellPlatform::set_position(uint8_t cell, int16_t xMm, int16_t yMm)
+{
+	if (cell >= _nbrCells) return;
+	_cal.x[cell] = xMm;
+	_cal.y[cell] = yMm;
+}
+
+void LoadCellPlatform::set_gain(uint8_t cell, float gain)
+{
+	if (cell < _nbrCells) _cal.gain[cell] = gain;
+}
+
+float LoadCellPlatform::get_gain(uint8_t cell)
+{
+	return cell < _nbrCells ? _cal.gain[cell] : 0.0f;
+}
+
+int32_t LoadCellPlatform::get_zero(uint8_t cell)
+{
+	return cell < _nbrCells ? _cal.zero[cell] : 0;
+}
+
+/**
+ * Below this total the center of gravity is not computed
+ */
+float LoadCellPlatform::set_minLoad(float grams)
+{
+	_minLoad = grams;
+	return _minLoad;
+}
+
+uint8_t LoadCellPlatform::get_nbrCells()
+{
+	return _nbrCells;
+}
+
+/**
+ * Largest time between the first and the last chip being ready [us]
+ */
+uint32_t LoadCellPlatform::get_maxSkew()
+{
+	return _maxSkew;
+}
+
+uint16_t LoadCellPlatform::get_syncs()
+{
+	return _syncs;
+}
+
+/**
+ * Tare, gains and positions to EEPROM at addr (50 bytes on the Uno)
+ */
+void LoadCellPlatform::store(int addr)
+{
+	EEPROM.put(addr, _cal);
+}
+
+/**
+ * Load what store() saved, false if there is none for this number of cells
+ */
+bool LoadCellPlatform::restore(int addr)
+{
+	Calibration cal;
+	EEPROM.get(addr, cal);
+	if (cal.magic != PLATFORM_MAGIC || cal.nbrCells != _nbrCells) return false;
+	_cal = cal;
+	return true;
+}
+
+void LoadCellPlatform::printCalibration()
+{
+	char buf[80];
+	for (uint8_t j = 0; j < _nbrCells; j++)
+	{
+		snprintf_P(buf, sizeof(buf), PSTR("cell %u: zero %ld, gain %.6f g/digit, position %d/%d mm\n"),
+			j, (long)_cal.zero[j], _cal.gain[j], _cal.x[j], _cal.y[j]);
+		Serial.print(buf);
+	}
+}
@@ -0,0 +1,93 @@
+/**
+ * Header       LoadCellPlatform.h
+ * Author       loadCell project contributors
+ *
+ * Purpose      Platform scale with up to 4 load cells, one HX711 per cell.
+ *              All HX711 share the PD_SCK line, so they are powered up in
+ *              the same instant, convert in step and are clocked out
+ *              together: one sample holds the same conversion of every cell.
+ *              If the chips drift apart by more than SKEW_US they are
+ *              power cycled to realign them.
+ *
+ *              The cells differ in sensitivity. A shift test corrects this:
+ *              the same test weight is placed near each corner in turn,
+ *              which gives N equations  sum_j(gain_j * d_ij) = weight
+ *              for the N corner gains [g/digit] (d_ij is the tared reading
+ *              of cell j with the weight at corner i).
+ *              With the cell positions [mm] the center of gravity is
+ *              x = sum_j(w_j * x_j) / total, y likewise, w_j = gain_j * d_j.
+ *              process() does this for one sample in constant time.
+ *              Tare, gains and positions are persisted in EEPROM.
+ *
+ * Constructor  pinsDOUT     Data Out pin of each HX711, in corner order
+ * arguments    nbrCells     number of cells, 1 .. 4
+ *              pinPD_SCK    common Powerdown / Serial Clock pin
+ */
+#ifndef _LOADCELL_PLATFORM_H_
+#define _LOADCELL_PLATFORM_H_
+#include "HX711_GSR.h"
+
+constexpr uint8_t PLATFORM_MAX_CELLS = 4;
+
+struct PlatformReading
+{
+    float        total;       // [g]
+    float        x;           // center of gravity [mm], 0 below minLoad
+    float        y;
+    uint32_t     timestamp;   // time all cells were ready [us]
+    HX711_STATUS status;
+};
+
+class LoadCellPlatform
+{
+    public:
+        LoadCellPlatform(const uint8_t *pinsDOUT, uint8_t nbrCells, uint8_t pinPD_SCK);
+
+    void    begin();
+    void    sync();
+    bool    read(int32_t *raw);
+    PlatformReading process(const int32_t *raw);
+    PlatformReading getReading(uint8_t nbr);
+    bool    getAverage(int32_t *avg, uint8_t nbr);
+    bool    tare(uint8_t nbr);
+    bool    shiftTest(uint8_t corner, uint8_t nbr);
+    bool    calibrate(float grams);
+    void    set_position(uint8_t cell, int16_t xMm, int16_t yMm);
+    void    set_gain(uint8_t cell, float gain);
+    float   get_gain(uint8_t cell);
+    int32_t get_zero(uint8_t cell);
+    float   set_minLoad(float grams);
+    uint8_t get_nbrCells();
+    uint32_t get_maxSkew();
+    uint16_t get_syncs();
+    void    store(int addr);
+    bool    restore(int addr);
+    void    printCalibration();
+
+    private:
+        bool     waitReady(uint32_t &skew);
+
+        struct Calibration
+        {
+            uint8_t magic;
+            uint8_t nbrCells;
+            int32_t zero[PLATFORM_MAX_CELLS];
+            float   gain[PLATFORM_MAX_CELLS];   // [g/digit]
+            int16_t x[PLATFORM_MAX_CELLS];      // cell position [mm]
+            int16_t y[PLATFORM_MAX_CELLS];
+        };
+
+        uint8_t  _pinsDOUT[PLATFORM_MAX_CELLS];
+        uint8_t  _nbrCells;
+        uint8_t  _pinPD_SCK;
+        Calibration _cal;
+        int32_t  _shift[PLATFORM_MAX_CELLS][PLATFORM_MAX_CELLS];  // tared readings of the shift test
+        uint8_t  _shiftDone = 0;                // bit i: corner i measured
+        float    _minLoad = 10.0f;
+        uint16_t _timeoutMs = 1000;
+        uint32_t _settleUntil = 0;
+        uint32_t _timestamp = 0;
+        uint32_t _maxSkew = 0;
+        uint16_t _syncs = 0;
+};
+#endif
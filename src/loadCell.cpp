@@ -26,9 +26,59 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 #include "HX711_GSR.h"
+#include "HX711_Profile.h"
+
+// Optional modes. Each one takes SRAM for its buffers, all together do not
+// fit the 2 KB of the Uno, so they are built only with their flag, e.g.
+// -DHX711_MODE_FILL; -DHX711_ALL_MODES builds all of them. Sizes and the
+// set of the uno env: README, RAM Budget.
+#ifdef HX711_ALL_MODES
+#define HX711_MODE_DUTY           // d    duty-cycled weighing
+#define HX711_MODE_DUAL           // x    channel A and B alternating
+#define HX711_MODE_FILL           // f    setpoint trigger output
+#define HX711_MODE_RATE           // v    flow rate
+#define HX711_MODE_CAPTURE        // k K  peak and force curve capture
+#define HX711_MODE_CHECKWEIGHER   // n    in-motion weighing
+#define HX711_MODE_COUNTING       // q Q  piece counting
+#define HX711_MODE_REPORT         // t T  change-only output
+#define HX711_MODE_SUMMARY        // y Y  windowed statistics
+#endif
+
+#ifdef HX711_MODE_DUTY
+#include "HX711_Scheduler.h"
+#endif
+#ifdef HX711_MODE_DUAL
+#include "HX711_DualChannel.h"
+#endif
+#ifdef HX711_MODE_FILL
+#include "HX711_Trigger.h"
+#endif
+#ifdef HX711_MODE_RATE
+#include "HX711_Rate.h"
+#endif
+#ifdef HX711_MODE_CAPTURE
+#include "HX711_Capture.h"
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+#include "HX711_Checkweigher.h"
+#endif
+#ifdef HX711_MODE_COUNTING
+#include "HX711_Counter.h"
+#endif
+#ifdef HX711_MODE_REPORT
+#include "HX711_Reporter.h"
+#endif
+#ifdef HX711_MODE_SUMMARY
+#include "HX711_Summary.h"
+#endif
+#if defined(ESP8266)
+#include "HX711_Logger.h"
+#endif
 
 #define PIN_DOUT    3
 #define PIN_PD_SCK  2
+#define PIN_VALVE   4   // fill trigger output, HIGH closes the valve
+#define MENU_BANNER "\n------------------\n HX711 %ld kg scale\n------------------\n"
 #define CLR_LINE    "\r                                                                              \r"
 #define MAGIC_NBR   42  //init flag
 
@@ -41,11 +91,47 @@ constexpr uint8_t EEPROM_END      = ADDR_CHN_GAIN   + sizeof(uint8_t);
 constexpr uint8_t EEPROM_SiZE     = EEPROM_END - ADDR_INIT_FLAG;
 
 const uint32_t maxLoad = 1000;
-typedef struct { const char key; const char *txt; void (&action)(); } MenuItem;
+// Menu items live in flash (PROGMEM), texts included, so they cost no SRAM
+typedef struct { char key; char txt[40]; void (*action)(); } MenuItem;
 
 uint8_t initFlagEeprom = 0;
 
 HX711_GSR myScale(PIN_DOUT, PIN_PD_SCK, maxLoad);
+#ifdef HX711_MODE_DUTY
+HX711_Scheduler lowPower(myScale, 10000, 8);   // one reading every 10 s
+#endif
+#ifdef HX711_MODE_DUAL
+HX711_DualChannel dual(myScale, 4);            // cells on channel A and B
+#endif
+#ifdef HX711_MODE_FILL
+HX711_Trigger fillTrigger(myScale);            // setpoint output for filling
+#endif
+#ifdef HX711_MODE_RATE
+HX711_Rate flowRate(myScale, 16);              // g/s over the last 16 samples
+bool showRate = false;
+bool rateBinary = false;
+#endif
+#ifdef HX711_MODE_CAPTURE
+HX711_Capture peakCapture(myScale);            // force curve with pre-trigger history
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+HX711_Checkweigher checkweigher(myScale);      // items passing on a conveyor
+#endif
+#ifdef HX711_MODE_COUNTING
+HX711_Counter counter(myScale);                // pieces from the unit weight
+bool counting = false;
+#endif
+#ifdef HX711_MODE_REPORT
+HX711_Reporter reporter(myScale);              // change-only output
+bool reportBinary = false;
+#endif
+#ifdef HX711_MODE_SUMMARY
+HX711_Summary summary(myScale);                // mean/min/max/std per 1 s and 60 s
+bool summaryBinary = false;
+#endif
+#if defined(ESP8266)
+HX711_Logger logger;                           // compressed raw samples on LittleFS
+#endif
 
 void enterRefWeight();
 void setZero();
@@ -60,9 +146,49 @@ void powerUp();
 void storeCalibrationData();
 void showCalibrationData();
 void showEquation();
+void showProfile();
+void toggleSleepWait();
+void toggleAutoRange();
+#ifdef HX711_MODE_DUTY
+void toggleDutyCycle();
+#endif
+#ifdef HX711_MODE_DUAL
+void toggleDualChannel();
+#endif
+#ifdef HX711_MODE_FILL
+void toggleFillTrigger();
+#endif
+#ifdef HX711_MODE_RATE
+void toggleTextRate();
+void toggleFrameRate();
+#endif
+#ifdef HX711_MODE_CAPTURE
+void togglePeakCapture();
+void dumpCapture();
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+void toggleCheckweigher();
+#endif
+#ifdef HX711_MODE_COUNTING
+void toggleCounting();
+void samplePieces();
+#endif
+#ifdef HX711_MODE_REPORT
+void toggleTextReport();
+void toggleFrameReport();
+#endif
+#ifdef HX711_MODE_SUMMARY
+void toggleTextSummary();
+void toggleFrameSummary();
+#endif
+#if defined(ESP8266)
+void toggleLog();
+#endif
+void showHealth();
+void showJitter();
 void showMenu();
 
-MenuItem menu[] = 
+const MenuItem menu[] PROGMEM = 
 {
   { 'r', "[r] Enter reference weight [grams]",   enterRefWeight },
   { 'z', "[z] Set to 0 (Tare)",                  setZero },
@@ -72,27 +198,87 @@ MenuItem menu[] =
   { 'a', "[a] Set CHN_A_128",                    setChnA128 },
   { 'A', "[A] Set CHN_A_64",                     setChnA64 },
   { 'b', "[b] Set CHN_B_32",                     setChnB32 },
+  { 'o', "[o] Toggle auto ranging A128/A64",     toggleAutoRange },
   { 'p', "[p] Power down",                       powerDown },
   { 'u', "[u] Power up to normal mode",          powerUp },
+  { 'l', "[l] Toggle sleep until DOUT ready",    toggleSleepWait },
+#ifdef HX711_MODE_DUTY
+  { 'd', "[d] Toggle duty-cycled weighing (10s)", toggleDutyCycle },
+#endif
+#ifdef HX711_MODE_DUAL
+  { 'x', "[x] Toggle dual channel A/B weighing", toggleDualChannel },
+#endif
+#ifdef HX711_MODE_FILL
+  { 'f', "[f] Toggle fill trigger [setpoint g]", toggleFillTrigger },
+#endif
+#ifdef HX711_MODE_RATE
+  { 'v', "[v] Toggle flow rate text [g/s]",     toggleTextRate },
+  { 'V', "[V] Toggle flow rate binary [g/s]",   toggleFrameRate },
+#endif
+#ifdef HX711_MODE_CAPTURE
+  { 'k', "[k] Toggle peak capture [trigger g]",  togglePeakCapture },
+  { 'K', "[K] Dump captured curve (binary)",     dumpCapture },
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+  { 'n', "[n] Toggle in-motion weighing [min g]", toggleCheckweigher },
+#endif
+#ifdef HX711_MODE_COUNTING
+  { 'q', "[q] Toggle piece counting",            toggleCounting },
+  { 'Q', "[Q] Tare (Q0) or sample [pieces]",     samplePieces },
+#endif
+#ifdef HX711_MODE_REPORT
+  { 't', "[t] Toggle change-only text [0.1 g]",  toggleTextReport },
+  { 'T', "[T] Toggle change-only binary [0.1 g]", toggleFrameReport },
+#endif
+#ifdef HX711_MODE_SUMMARY
+  { 'y', "[y] Toggle 1 s / 60 s summary text",   toggleTextSummary },
+  { 'Y', "[Y] Toggle 1 s / 60 s summary binary", toggleFrameSummary },
+#endif
+#if defined(ESP8266)
+  { 'L', "[L] Toggle raw sample log (LittleFS)",  toggleLog },
+#endif
   { 'S', "[S] Store calibration data in EEPROM", storeCalibrationData },
   { 's', "[s] Show calibration data from EEPROM",showCalibrationData },
   { 'e', "[e] Show Equation",                    showEquation },
+  { 'h', "[h] Show HX711 health counters",       showHealth },
+  { 'j', "[j] Show and reset sample jitter",     showJitter },
+#ifdef HX711_PROFILE
+  { 'i', "[i] Show and reset profile counters",  showProfile },
+#endif
   { 'm', "[m] Show menu",                        showMenu },
 };
 constexpr uint8_t nbrMenuItems = sizeof(menu) / sizeof(menu[0]);
 
+/**
+ * Print to the serial monitor, time spent blocking is profiled
+ */
+template <typename... T> void print(T... args)
+{
+  PROFILE_START(t);
+  Serial.print(args...);
+  PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
+template <typename... T> void println(T... args)
+{
+  PROFILE_START(t);
+  Serial.println(args...);
+  PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+}
+
 /**
  * Executes the action assigned to the key
  */
 void doMenu()
 {
   char key = Serial.read();
-  Serial.print(CLR_LINE);
+  print(F(CLR_LINE));
   for (int i = 0; i < nbrMenuItems; i++)
   {
-    if (key == menu[i].key)
+    if (key == (char)pgm_read_byte(&menu[i].key))
     {
-      menu[i].action();
+      void (*action)() = (void (*)())pgm_read_ptr(&menu[i].action);
+      action();
       break;
     }
   } 
@@ -109,50 +295,582 @@ void enterRefWeight()
   }
   if (refWeight < myScale.getMaxLoad() / 10 || refWeight > myScale.getMaxLoad())
   {
-      snprintf(buf, sizeof(buf), "Value out of range, allowed: %ld .. %ld [grams] ", myScale.getMaxLoad() / 10, myScale.getMaxLoad());
-      Serial.print(buf);
+      snprintf_P(buf, sizeof(buf), PSTR("Value out of range, allowed: %ld .. %ld [grams] "), (long)myScale.getMaxLoad() / 10, (long)myScale.getMaxLoad());
+      print(buf);
       return;
   }
   myScale.set_wref(refWeight);
-  snprintf(buf, sizeof(buf), "Reference weight set to %ld ", myScale.get_wref());
-  Serial.print(buf);
+  snprintf_P(buf, sizeof(buf), PSTR("Reference weight set to %ld "), (long)myScale.get_wref());
+  print(buf);
 }
 
 void setChnA128()
 {
   myScale.set_chnGain(CHN_GAIN::CHN_A_128);
-  Serial.print("Set channel A with gain 128 ");
+  print(F("Set channel A with gain 128 "));
 }
 
 void setChnA64()
 {
   myScale.set_chnGain(CHN_GAIN::CHN_A_64);
-  Serial.print("Set channel A with gain 64 ");
+  print(F("Set channel A with gain 64 "));
 }
 
 void setChnB32()
 {
   myScale.set_chnGain(CHN_GAIN::CHN_B_32);
-  Serial.print("Set channel B with gain 32 ");
+  print(F("Set channel B with gain 32 "));
+}
+
+/**
+ * Switch between CHN_A_128 and CHN_A_64 automatically, shows the 
+ * range changes and the samples they cost
+ */
+void toggleAutoRange()
+{
+  myScale.set_autoRange(!myScale.get_autoRange());
+  print(myScale.get_autoRange() ? F("Auto ranging on, ") : F("Auto ranging off, "));
+  myScale.printRange();
 }
 
 void powerUp()
 {
   myScale.powerup();
-  Serial.print("Normal mode set");
+  print(F("Normal mode set"));
 }
 
 void powerDown()
 {
   myScale.powerdown();
-  Serial.print("Ppower down mode set ");
+  print(F("Power down mode set "));
+}
+
+/**
+ * Low power: idle the MCU until the HX711 has a sample ready
+ */
+void toggleSleepWait()
+{
+  if (myScale.get_waitMode() == WAIT_MODE::BUSY)
+  {
+    myScale.set_waitMode(WAIT_MODE::SLEEP);
+    print(F("Sleep until ready "));
+  }
+  else
+  {
+    myScale.set_waitMode(WAIT_MODE::BUSY);
+    print(F("Busy wait until ready "));
+  }
+}
+
+/**
+ * Duty cycle and dual channel switch power and gain of the HX711 on their
+ * own, the per-sample modes expect every conversion of channel A. Starting
+ * one side stops the other.
+ */
+bool chipOwned()
+{
+  bool owned = false;
+#ifdef HX711_MODE_DUTY
+  owned |= lowPower.isRunning();
+#endif
+#ifdef HX711_MODE_DUAL
+  owned |= dual.isRunning();
+#endif
+  return owned;
+}
+
+void releaseChip()
+{
+#ifdef HX711_MODE_DUTY
+  if (lowPower.isRunning()) lowPower.stop();
+#endif
+#ifdef HX711_MODE_DUAL
+  if (dual.isRunning()) dual.stop();
+#endif
+}
+
+void stopSampleModes()
+{
+#ifdef HX711_MODE_FILL
+  if (fillTrigger.isRunning()) fillTrigger.stop();    // closes the valve
+#endif
+#ifdef HX711_MODE_RATE
+  showRate = false;
+#endif
+#ifdef HX711_MODE_CAPTURE
+  if (peakCapture.isArmed()) peakCapture.disarm();
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+  checkweigher.stop();
+#endif
+#ifdef HX711_MODE_COUNTING
+  counting = false;
+#endif
+#ifdef HX711_MODE_REPORT
+  reporter.stop();
+#endif
+#ifdef HX711_MODE_SUMMARY
+  summary.clear();
+#endif
+#if defined(ESP8266)
+  if (logger.isRunning()) logger.stop();
+#endif
+}
+
+#ifdef HX711_MODE_DUTY
+/**
+ * Low power: HX711 is powered down between readings
+ */
+void toggleDutyCycle()
+{
+  if (lowPower.isRunning())
+  {
+    lowPower.stop();
+    print(F("Duty-cycled weighing stopped "));
+  }
+  else
+  {
+    releaseChip();
+    stopSampleModes();
+    lowPower.start();
+    print(F("Duty-cycled weighing started "));
+  }
+}
+
+/**
+ * Print a reading of the duty-cycled scheduler or that it timed out
+ */
+void printLowPowerReading()
+{
+  if (lowPower.getStatus() == HX711_STATUS::TIMEOUT)
+  {
+    print(F("\r\nHX711 not responding, retry at the next interval "));
+    return;
+  }
+  char buf[80];
+  char w[12];
+  dtostrf(lowPower.getWeight(), 1, 1, w);
+  snprintf_P(buf, sizeof(buf), PSTR("\r\nw = %s g, duty %u.%u %%, wake->valid %u ms, discarded %lu "), 
+    w, (unsigned)(lowPower.getDutyCycle() * 100), (unsigned)(lowPower.getDutyCycle() * 1000) % 10,
+    lowPower.getWakeLatency(), (unsigned long)lowPower.getDiscarded());
+  print(buf);
+}
+#endif
+
+#ifdef HX711_MODE_DUAL
+/**
+ * Alternate between channel A (calibrated as the single scale) and 
+ * channel B (raw values, calibrate it with dual.setCalibration())
+ */
+void toggleDualChannel()
+{
+  if (dual.isRunning())
+  {
+    dual.stop();
+    print(F("Dual channel weighing stopped "));
+  }
+  else
+  {
+    releaseChip();
+    stopSampleModes();
+    dual.setCalibration('A', myScale.get_v0(), myScale.get_vref(), myScale.get_wref());
+    dual.start();
+    print(F("Dual channel weighing started "));
+  }
+}
+
+/**
+ * Print the last readings of both channels and their sample rates
+ */
+void printDualReading()
+{
+  char buf[80];
+  char w[12];
+  dtostrf(dual.getWeight('A'), 1, 1, w);
+  long b = (long)dual.getRawValue('B');
+  snprintf_P(buf, sizeof(buf), PSTR("\rA = %s g, B = %ld, %u.%02u / %u.%02u SPS "), w, b,
+    (unsigned)dual.getSampleRate('A'), (unsigned)(dual.getSampleRate('A') * 100) % 100,
+    (unsigned)dual.getSampleRate('B'), (unsigned)(dual.getSampleRate('B') * 100) % 100);
+  print(buf);
+}
+#endif
+
+/**
+ * Every sample goes through the setpoint comparison
+ */
+void onSample(int32_t value, uint32_t timestamp)
+{
+  if (chipOwned()) return;              // channel B or a duty-cycle reading
+#ifdef HX711_MODE_FILL
+  fillTrigger.onSample(value, timestamp);
+#endif
+#ifdef HX711_MODE_RATE
+  flowRate.add(value, timestamp);
+#endif
+#ifdef HX711_MODE_CAPTURE
+  peakCapture.onSample(value, timestamp);
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+  checkweigher.onSample(value, timestamp);
+#endif
+#ifdef HX711_MODE_COUNTING
+  counter.onSample(value, timestamp);
+#endif
+#ifdef HX711_MODE_REPORT
+  reporter.onSample(value, timestamp);
+#endif
+#ifdef HX711_MODE_SUMMARY
+  summary.onSample(value, timestamp);
+#endif
+#if defined(ESP8266)
+  logger.onSample(value, timestamp);
+#endif
+}
+
+#ifdef HX711_MODE_CAPTURE
+/**
+ * Arm: the trigger level follows the key, e.g. k200. A quarter of the
+ * buffer holds the samples before the trigger. The loop reads every 
+ * conversion while armed and shows max, min and time of the peak when 
+ * the capture is done.
+ * Disarm: shows what was captured so far.
+ */
+void togglePeakCapture()
+{
+  if (peakCapture.isArmed())
+  {
+    peakCapture.print();
+    peakCapture.disarm();
+    return;
+  }
+  int32_t trigger = 0;
+  delay(2000);
+  while (Serial.available())
+  {
+    trigger = Serial.parseInt();
+  }
+  if (trigger == 0 || labs(trigger) > myScale.getMaxLoad())
+  {
+    char buf[64];
+    snprintf_P(buf, sizeof(buf), PSTR("Trigger out of range, allowed: +-1 .. %ld [grams] "), (long)myScale.getMaxLoad());
+    print(buf);
+    return;
+  }
+  releaseChip();
+  peakCapture.arm(trigger, HX711_CAPTURE_SIZE / 4, HX711_CAPTURE_SIZE - HX711_CAPTURE_SIZE / 4);
+  char buf[64];
+  snprintf_P(buf, sizeof(buf), PSTR("Peak capture armed, %u bytes RAM "), (unsigned)sizeof(peakCapture));
+  print(buf);
+}
+
+/**
+ * The curve as binary block, format see HX711_Capture::dump()
+ */
+void dumpCapture()
+{
+  peakCapture.dump();
+}
+#endif
+
+#ifdef HX711_MODE_RATE
+/**
+ * Sample continuously, show rate and uncertainty once per second as text
+ * or send a frame for every sample, see HX711_Rate::writeFrame()
+ */
+void toggleFlowRate(bool binary)
+{
+  showRate = !showRate;
+  if (showRate) releaseChip();
+  rateBinary = binary;
+  flowRate.reset();
+  print(showRate ? F("Flow rate on ") : F("Flow rate off "));
+}
+
+void toggleTextRate()
+{
+  toggleFlowRate(false);
+}
+
+void toggleFrameRate()
+{
+  toggleFlowRate(true);
+}
+#endif
+
+#ifdef HX711_MODE_FILL
+/**
+ * Start: the setpoint follows the key, e.g. f450. The valve output on
+ * PIN_VALVE switches from the sample path, the in-flight amount is learned.
+ * Stop: shows the learned in-flight amount and the sample to pin latency.
+ */
+void toggleFillTrigger()
+{
+  if (fillTrigger.isRunning())
+  {
+    fillTrigger.stop();
+    print(F("Fill trigger stopped "));
+    fillTrigger.print();
+    return;
+  }
+  int32_t setpoint = -1;
+  delay(2000);
+  while (Serial.available())
+  {
+    setpoint = Serial.parseInt();
+  }
+  if (setpoint <= 0 || setpoint > myScale.getMaxLoad())
+  {
+    char buf[64];
+    snprintf_P(buf, sizeof(buf), PSTR("Setpoint out of range, allowed: 1 .. %ld [grams] "), (long)myScale.getMaxLoad());
+    print(buf);
+    return;
+  }
+  if (fillTrigger.getCycles(0) == 0)       // keep what was learned on a restart
+  {
+    fillTrigger.clear();
+    fillTrigger.add(setpoint, setpoint / 5, PIN_VALVE, HIGH);   // closed while stopped
+    fillTrigger.setLearning(0, true);
+  }
+  releaseChip();
+  fillTrigger.setSetpoint(0, setpoint);
+  fillTrigger.start();
+  print(F("Fill trigger started "));
+}
+#endif
+
+#ifdef HX711_MODE_CHECKWEIGHER
+/**
+ * Start: items heavier than the level following the key, e.g. n20, are
+ * weighed in motion with a target error of 0.5 g, the belt must be empty.
+ * Every item is shown with its quality when it has left the cell.
+ * Stop: shows the tracked zero and the noise of the belt.
+ */
+void toggleCheckweigher()
+{
+  char buf[80];
+  if (checkweigher.isRunning())
+  {
+    checkweigher.stop();
+    char z[12], n[12];
+    dtostrf(checkweigher.getZero(), 1, 2, z);
+    dtostrf(checkweigher.getNoise(), 1, 3, n);
+    snprintf_P(buf, sizeof(buf), PSTR("In-motion weighing stopped, zero %s g, noise %s g "), z, n);
+    print(buf);
+    return;
+  }
+  int32_t level = -1;
+  delay(2000);
+  while (Serial.available())
+  {
+    level = Serial.parseInt();
+  }
+  if (level <= 0 || level > myScale.getMaxLoad())
+  {
+    snprintf_P(buf, sizeof(buf), PSTR("Level out of range, allowed: 1 .. %ld [grams] "), (long)myScale.getMaxLoad());
+    print(buf);
+    return;
+  }
+  releaseChip();
+  checkweigher.start(level, 0.5f);
+  print(F("In-motion weighing started "));
+}
+#endif
+
+#ifdef HX711_MODE_COUNTING
+/**
+ * Sample continuously and show the count once per second
+ */
+void toggleCounting()
+{
+  counting = !counting;
+  if (counting) releaseChip();
+  counter.clear();
+  print(counting ? F("Piece counting on, empty container: Q0, then n sample pieces: Qn ") : F("Piece counting off "));
+}
+
+/**
+ * Q0 tares the empty container, e.g. Q10 takes the 10 pieces on it as 
+ * sample for the unit weight. Both average 64 samples and fail if the
+ * load was not stable meanwhile.
+ */
+void samplePieces()
+{
+  int32_t pieces = -1;
+  delay(2000);
+  while (Serial.available())
+  {
+    pieces = Serial.parseInt();
+  }
+  if (!counting || pieces < 0 || pieces > 1000)
+  {
+    print(F("Turn on counting (q), then Q0 .. Q1000 "));
+    return;
+  }
+  if (pieces == 0 ? !counter.tare() : !counter.sample(pieces))
+  {
+    print(F("Busy, try again "));
+    return;
+  }
+  uint32_t start = millis();
+  while (counter.isBusy() && millis() - start < 10000)
+  {
+    if (myScale.isReady()) myScale.getRawValue();
+    yield();
+  }
+  if (counter.isBusy() || counter.hasFailed()) print(F("Not stable, try again "));
+  else if (pieces == 0) print(F("Container tared "));
+  else counter.print();
+}
+#endif
+
+#ifdef HX711_MODE_REPORT
+/**
+ * Start: reports when the weight moves by more than the deadband following
+ * the key in 0.1 g, e.g. t5 for 0.5 g, t0 reports every sample, when the 
+ * load gets stable or starts moving, and every 10 s as heartbeat.
+ * Stop: shows how many samples were reported.
+ */
+void toggleReport(bool binary)
+{
+  char buf[64];
+  if (reporter.isRunning())
+  {
+    reporter.stop();
+    snprintf_P(buf, sizeof(buf), PSTR("\r\nReported %lu of %lu samples "), 
+      (unsigned long)reporter.getReports(), (unsigned long)reporter.getSamples());
+    print(buf);
+    return;
+  }
+  int32_t deadband = -1;
+  delay(2000);
+  while (Serial.available())
+  {
+    deadband = Serial.parseInt();
+  }
+  if (deadband < 0 || deadband > 10L * myScale.getMaxLoad())
+  {
+    snprintf_P(buf, sizeof(buf), PSTR("Deadband out of range, allowed: 0 .. %ld [0.1 g] "), 10L * myScale.getMaxLoad());
+    print(buf);
+    return;
+  }
+  releaseChip();
+  reportBinary = binary;
+  reporter.start(deadband / 10.0f, 10);
+  print(F("\r\n"));
+}
+
+void toggleTextReport()
+{
+  toggleReport(false);
+}
+
+void toggleFrameReport()
+{
+  toggleReport(true);
+}
+#endif
+
+#ifdef HX711_MODE_SUMMARY
+/**
+ * Mean, min, max and standard deviation per second and per minute instead 
+ * of every sample, see HX711_Summary for the formats
+ */
+void toggleSummary(bool binary)
+{
+  if (summary.getWindows() > 0)
+  {
+    summary.clear();
+    char buf[48];
+    snprintf_P(buf, sizeof(buf), PSTR("\r\nSummary off, %u overruns "), summary.getOverruns());
+    print(buf);
+    return;
+  }
+  releaseChip();
+  summaryBinary = binary;
+  summary.add(1000);
+  summary.add(60000);
+  print(F("\r\n"));
+}
+
+void toggleTextSummary()
+{
+  toggleSummary(false);
+}
+
+void toggleFrameSummary()
+{
+  toggleSummary(true);
+}
+#endif
+
+#if defined(ESP8266)
+/**
+ * Records every raw sample, Rice coded, to /log on LittleFS; the oldest 
+ * files go when the file system is 90 % full, see HX711_Logger
+ */
+void toggleLog()
+{
+  if (logger.isRunning())
+  {
+    logger.stop();
+    print(F("\r\n"));
+    logger.print();
+    return;
+  }
+  static bool mounted = false;
+  if (!mounted && !(mounted = logger.begin()))
+  {
+    print(F("\r\nLittleFS mount failed "));
+    return;
+  }
+  releaseChip();
+  logger.start();
+  print(F("\r\nLogging raw samples "));
+}
+#endif
+
+/**
+ * Tells the user when the last measurement failed
+ */
+bool scaleResponds()
+{
+  switch (myScale.get_status())
+  {
+    case HX711_STATUS::TIMEOUT:
+      print(F("HX711 not responding, check wiring and power "));
+      return false;
+    case HX711_STATUS::POWERED_DOWN:
+      print(F("HX711 is powered down, press u "));
+      return false;
+    case HX711_STATUS::SATURATED:
+      print(F("Saturated! "));
+      return true;
+    default:
+      return true;
+  }
+}
+
+void showHealth()
+{
+  myScale.printHealth();
+}
+
+/**
+ * Statistics of the interval between the conversion timestamps
+ */
+void showJitter()
+{
+  myScale.printJitter();
+  myScale.resetJitter();
 }
 
 void setZero()
 {
   char buf[64];
-  snprintf(buf, sizeof(buf), "v0 = %ld ", myScale.setZero(32));
-  Serial.print(buf);
+  int32_t v0 = myScale.setZero(32);
+  if (!scaleResponds()) return;
+  snprintf_P(buf, sizeof(buf), PSTR("v0 = %ld "), (long)v0);
+  print(buf);
 }
 
 void calibrate()
@@ -160,36 +878,37 @@ void calibrate()
   char buf[64];
   if (myScale.get_wref() < 0)
   {
-    Serial.print("First enter reference weight! ");
+    print(F("First enter reference weight! "));
     return;
   }
   if (myScale.get_v0() == 0)
   {
-    Serial.print("First Set 0 (Tare) ");
+    print(F("First Set 0 (Tare) "));
     return;
   }
 
   double m = myScale.calibrate(16);
+  if (!scaleResponds()) return;
   if (fabs(myScale.get_m()) > 1.0)
   {
-    Serial.print("First Calibrate with Reference Weight ");
+    print(F("First Calibrate with Reference Weight "));
     return;
   }
-  snprintf(buf, sizeof(buf), "Calibrated: Weight = %.9f * v %+9.4f ", m, myScale.get_b());
-  Serial.print(buf);
+  snprintf_P(buf, sizeof(buf), PSTR("Calibrated: Weight = %.9f * v %+9.4f "), m, myScale.get_b());
+  print(buf);
 
 }
 
 void getWeight()
 {
   double w = myScale.getWeight(8);
-  Serial.print(w, 1);
+  if (scaleResponds()) print(w, 1);
 }
 
 void getValue()
 {
   uint32_t v = myScale.getAverageValue(16);
-  Serial.print(v);
+  if (scaleResponds()) print(v);
 }
 
 /**
@@ -203,7 +922,7 @@ void storeCalibrationData()
   EEPROM.put(ADDR_V0, myScale.get_v0());
   EEPROM.put(ADDR_VREF, myScale.get_vref());
   EEPROM.put(ADDR_CHN_GAIN, chnGain);
-  Serial.print("Calibration Data stored ");
+  print(F("Calibration Data stored "));
 }
 
 void showCalibrationData()
@@ -216,8 +935,8 @@ void showCalibrationData()
   EEPROM.get(ADDR_V0, v0);
   EEPROM.get(ADDR_VREF, vRef);
   EEPROM.get(ADDR_CHN_GAIN, c_g);
-  snprintf(buf, sizeof(buf), "initFlag = %u, wRef = %ld, vRef = %ld, v0 = %ld, chn_gain = %u ", magicNbr, wRef, vRef, v0, c_g);
-  Serial.print(buf);
+  snprintf_P(buf, sizeof(buf), PSTR("initFlag = %u, wRef = %ld, vRef = %ld, v0 = %ld, chn_gain = %u "), magicNbr, (long)wRef, (long)vRef, (long)v0, c_g);
+  print(buf);
 }
 
 void showEquation()
@@ -225,25 +944,63 @@ void showEquation()
   myScale.printEquation();
 }
 
+/**
+ * Dump the hot path counters and start a new measurement period
+ */
+void showProfile()
+{
+  HX711_Profile::print();
+  HX711_Profile::reset();
+}
+
 /**
  * Display menu on monitor
  */
 void showMenu()
 {
-  char buf[128];
-  snprintf(buf, sizeof(buf), "%s%s %ld%s%s", 
-  "\n------------------\n",
-  " HX711", 
-  myScale.getMaxLoad() / 1000,
-  " kg scale\n",
-  "------------------\n");
-  Serial.print(buf);
+  char buf[sizeof(MENU_BANNER) + 8];      // %ld takes up to 11 characters
+  snprintf_P(buf, sizeof(buf), PSTR(MENU_BANNER), (long)myScale.getMaxLoad() / 1000);
+  print(buf);
 
   for (int i = 0; i < nbrMenuItems; i++)
   {
-    Serial.println(menu[i].txt);
+    println((const __FlashStringHelper *)menu[i].txt);
+    yield();                              // one line at a time, however long the menu
   }
-  Serial.print("\nPress a key: ");
+  print(F("\nPress a key: "));
+}
+
+/**
+ * True while a mode needs every conversion of channel A read by the loop
+ */
+bool sampleModesRunning()
+{
+  bool running = false;
+#ifdef HX711_MODE_FILL
+  running |= fillTrigger.isRunning();
+#endif
+#ifdef HX711_MODE_RATE
+  running |= showRate;
+#endif
+#ifdef HX711_MODE_CAPTURE
+  running |= peakCapture.isArmed();
+#endif
+#ifdef HX711_MODE_CHECKWEIGHER
+  running |= checkweigher.isRunning();
+#endif
+#ifdef HX711_MODE_COUNTING
+  running |= counting;
+#endif
+#ifdef HX711_MODE_REPORT
+  running |= reporter.isRunning();
+#endif
+#ifdef HX711_MODE_SUMMARY
+  running |= summary.getWindows() > 0;
+#endif
+#if defined(ESP8266)
+  running |= logger.isRunning();
+#endif
+  return running;
 }
 
 void initScale()
@@ -265,6 +1022,12 @@ void initScale()
 void setup() 
 {
   Serial.begin(115200);
+  myScale.startTimestamps();
+  myScale.setSampleHandler(onSample);
+#ifdef HX711_MODE_FILL
+  pinMode(PIN_VALVE, OUTPUT);
+  digitalWrite(PIN_VALVE, HIGH);        // valve closed until a fill starts
+#endif
   initScale();
   showMenu();
 }
@@ -275,5 +1038,80 @@ void loop()
   {
     doMenu();
   }
+#ifdef HX711_MODE_DUTY
+  if (lowPower.update())
+  {
+    printLowPowerReading();
+  }
+#endif
+#if defined(ESP8266)
+  logger.update();                      // one flash page per call at most
+#endif
+  if (sampleModesRunning() && myScale.isReady())
+  {
+    myScale.getRawValue();              // the sample handler drives every per-sample consumer
+#ifdef HX711_MODE_CAPTURE
+    if (peakCapture.isDone())
+    {
+      print(F("\r\n"));
+      peakCapture.print();
+      peakCapture.disarm();             // keeps the data for the dump
+    }
+#endif
+  }
+#ifdef HX711_MODE_CHECKWEIGHER
+  while (checkweigher.available())
+  {
+    checkweigher.print(checkweigher.getItem());
+  }
+#endif
+#ifdef HX711_MODE_REPORT
+  if (reporter.available())
+  {
+    HX711_Report r = reporter.getReport();
+    if (reportBinary) reporter.writeFrame(r);
+    else reporter.printText(r);
+  }
+#endif
+#ifdef HX711_MODE_SUMMARY
+  for (uint8_t w = 0; w < summary.getWindows(); w++)
+  {
+    if (!summary.available(w)) continue;
+    HX711_Stats s = summary.getStats(w);
+    if (summaryBinary) summary.writeFrame(w, s);
+    else summary.printText(w, s);
+  }
+#endif
+#ifdef HX711_MODE_RATE
+  static uint32_t rateShownAt = 0, rateSamples = 0;
+  if (showRate && rateBinary)
+  {
+    if (flowRate.getSamples() != rateSamples)
+    {
+      rateSamples = flowRate.getSamples();
+      flowRate.writeFrame();
+    }
+  }
+  else if (showRate && millis() - rateShownAt >= 1000)
+  {
+    rateShownAt = millis();
+    PROFILE_START(t);
+    flowRate.print();
+    PROFILE_LAP(ProfileStage::SERIAL_OUT, t);
+  }
+#endif
+#ifdef HX711_MODE_COUNTING
+  static uint32_t countShownAt = 0;
+  if (counting && counter.isReady() && millis() - countShownAt >= 1000)
+  {
+    countShownAt = millis();
+    counter.print();
+  }
+#endif
+#ifdef HX711_MODE_DUAL
+  if (dual.update() && dual.available('A') && dual.available('B'))
+  {
+    printDualReading();
+  }
+#endif
 }
-
@@ -0,0 +1,62 @@
+"""
+Script       bench_compare.py
+Author       loadCell project contributors
+
+Purpose      Compares two benchmark result files (host or simavr) and 
+             flags every figure which changed by more than the threshold
+
+Usage        python tools/bench_compare.py BASE.json NEW.json [THRESHOLD_%]
+             exit code 1 if a time per call got slower than the threshold
+"""
+import json
+import sys
+
+
+# host timings depend on the machine, call counts are no results
+SKIP = ("host_ns_per_call", "calls", "f_cpu_mhz")
+# figures where more is worse
+COSTS = ("_per_call", "_ms", "mA", "mAh_per_day", "duty_cycle")
+
+
+def flatten(res, prefix=""):
+    flat = {}
+    for key, v in res.items():
+        if key in SKIP:
+            continue
+        if isinstance(v, dict):
+            flat.update(flatten(v, "%s%s." % (prefix, key)))
+        elif isinstance(v, (int, float)) and not isinstance(v, bool):
+            flat[prefix + key] = v
+    return flat
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    with open(sys.argv[1]) as f:
+        base = flatten(json.load(f))
+    with open(sys.argv[2]) as f:
+        new = flatten(json.load(f))
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 5.0
+
+    slower = False
+    print("%-44s %14s %14s %8s" % ("metric", "base", "new", "delta"))
+    for key in sorted(set(base) | set(new)):
+        b, n = base.get(key), new.get(key)
+        if b is None or n is None:
+            print("%-44s %14s %14s" % (key, b, n))
+            continue
+        delta = 100.0 * (n - b) / b if b else 0.0
+        flag = ""
+        if abs(delta) > threshold:
+            flag = " <--"
+            # more time or current is a regression, a higher sample rate is not
+            if key.endswith(COSTS):
+                slower = slower or delta > 0
+        print("%-44s %14.2f %14.2f %+7.1f%%%s" % (key, b, n, delta, flag))
+    return 1 if slower else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
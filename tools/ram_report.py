@@ -0,0 +1,70 @@
+"""
+Script       ram_report.py
+Author       loadCell project contributors
+
+Purpose      PlatformIO extra script which reports the static RAM usage
+             (.data, .rodata and .bss sections) of every object file after
+             the firmware is linked.
+             The figures are what each module takes from the 2 KB SRAM of the
+             Uno before the stack and the heap get their share, so buffers for
+             new filters can be budgeted.
+
+Usage        extra_scripts = post:tools/ram_report.py   (in platformio.ini)
+"""
+import os
+import subprocess
+
+Import("env")
+
+# sections of an object file which end up in RAM. On the AVR the linker
+# copies .rodata (string literals, const tables not in PROGMEM) into .data,
+# unnamed literals have no symbol, so sizes are taken per section, not from nm.
+RAM_SECTIONS = ((".data", "data"), (".rodata", "rodata"), (".bss", "bss"))
+
+
+def size_tool():
+    cc = env.subst("$CC")
+    return cc[:-3] + "size" if cc.endswith("gcc") else "size"
+
+
+def module_usage(size, obj):
+    usage = {"data": 0, "rodata": 0, "bss": 0}
+    try:
+        out = subprocess.check_output([size, "-A", obj],
+                                      stderr=subprocess.DEVNULL).decode()
+    except (OSError, subprocess.CalledProcessError):
+        return usage
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) < 2 or not parts[1].isdigit():
+            continue
+        for prefix, kind in RAM_SECTIONS:
+            # .data, .data.<symbol> with -fdata-sections, .rodata.str1.1, ...
+            if parts[0] == prefix or parts[0].startswith(prefix + "."):
+                usage[kind] += int(parts[1])
+    return usage
+
+
+def ram_report(source, target, env):
+    build_dir = env.subst("$BUILD_DIR")
+    size = size_tool()
+    rows = []
+    for root, _, files in os.walk(build_dir):
+        for f in files:
+            if f.endswith(".o"):
+                obj = os.path.join(root, f)
+                u = module_usage(size, obj)
+                if u["data"] or u["rodata"] or u["bss"]:
+                    rows.append((os.path.relpath(obj, build_dir), u["data"], u["rodata"], u["bss"]))
+    rows.sort(key=lambda r: r[1] + r[2] + r[3], reverse=True)
+
+    print("\nStatic RAM usage per module [bytes]")
+    print("%-50s %6s %6s %6s %6s" % ("module", "data", "rodata", "bss", "total"))
+    tot = [0, 0, 0]
+    for name, data, rodata, bss in rows:
+        print("%-50s %6d %6d %6d %6d" % (name, data, rodata, bss, data + rodata + bss))
+        tot = [tot[0] + data, tot[1] + rodata, tot[2] + bss]
+    print("%-50s %6d %6d %6d %6d\n" % ("TOTAL", tot[0], tot[1], tot[2], sum(tot)))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_report)
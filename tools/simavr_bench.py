@@ -0,0 +1,55 @@
+"""
+Script       simavr_bench.py
+Author       loadCell project contributors
+
+Purpose      PlatformIO extra script which adds the target "simbench": it runs
+             the benchmark firmware (bench/bench_avr.cpp) in simavr, collects
+             the JSON lines it prints on UART0 and writes them in the same
+             format as the host benchmark to bench_avr.json
+
+Usage        pio run -e uno_bench -t simbench
+"""
+import json
+import os
+import re
+import subprocess
+
+Import("env")
+
+F_CPU_MHZ = 16.0
+
+
+def simbench(source, target, env):
+    simavr = os.path.join(env.PioPlatform().get_package_dir("tool-simavr") or "", "bin", "simavr")
+    elf = env.subst("$BUILD_DIR/${PROGNAME}.elf")
+    cmd = [simavr, "-m", "atmega328p", "-f", "16000000", elf]
+    try:
+        out = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             timeout=900).stdout.decode(errors="replace")
+    except (OSError, subprocess.TimeoutExpired) as e:
+        print("simavr failed: %s" % e)
+        env.Exit(1)
+
+    functions = {}
+    for m in re.finditer(r"\{[^{}]*\}", out):
+        try:
+            rec = json.loads(m.group(0))
+        except ValueError:
+            continue
+        if "name" in rec:
+            cyc = rec["cycles_per_call"]
+            functions[rec.pop("name")] = {"calls": rec["calls"], "cycles_per_call": cyc,
+                                          "us_per_call": round(cyc / F_CPU_MHZ, 2)}
+    result = {"target": "simavr", "f_cpu_mhz": F_CPU_MHZ, "functions": functions}
+    path = os.path.join(env.subst("$PROJECT_DIR"), "bench_avr.json")
+    with open(path, "w") as f:
+        json.dump(result, f, indent=2)
+    print(json.dumps(result, indent=2))
+
+
+env.AddCustomTarget(
+    name="simbench",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions=simbench,
+    title="Benchmark in simavr",
+    description="Run bench/bench_avr.cpp in simavr and write bench_avr.json")